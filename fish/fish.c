@@ -5,9 +5,10 @@
 
 #define NULL 0
 #define WAIT 100
+#define TICK_NSEC 31250000      /* 32 Hz, the rate the rtc used to pace it at */
 uint8_t *vmem_base_addr;
 uint8_t *mp1_set_video_mode (void);
-void add_frames(uint8_t *, uint8_t *, int32_t);
+void add_frames(uint8_t *, uint8_t *);
 void ece391_memset(void* memory, char c, int n);
 int32_t ece391_memcpy(void* dest, const void* src, int32_t n);
 
@@ -22,7 +23,7 @@ static struct mp1_blink_struct blink_array[80*25];
 
 int main(void)
 {
-    int rtc_fd, ret_val, i, garbage;
+    int i;
     struct mp1_blink_struct blink_struct;
 
     ece391_memset(blink_array, 0, sizeof(struct mp1_blink_struct)*80*25);
@@ -31,16 +32,11 @@ int main(void)
         return -1;
     }
 
-    rtc_fd = ece391_open((uint8_t*)"rtc");
-
-    add_frames(file0, file1, rtc_fd);
-
-    ret_val = 32;
-    ret_val = ece391_write(rtc_fd, &ret_val, 4);
+    add_frames(file0, file1);
 
     for(i=0; i<WAIT; i++) {
-        ece391_read(rtc_fd, &garbage, 4);
-        mp1_rtc_tasklet(garbage);
+        ece391_nanosleep(0, TICK_NSEC);
+        mp1_rtc_tasklet(0);
     }
 
     blink_struct.on_char = 'I';
@@ -52,31 +48,29 @@ int main(void)
     mp1_ioctl((unsigned long)&blink_struct, RTC_ADD);
 
     for(i=0; i<WAIT; i++) {
-        ece391_read(rtc_fd, &garbage, 4);
-        mp1_rtc_tasklet(garbage);
+        ece391_nanosleep(0, TICK_NSEC);
+        mp1_rtc_tasklet(0);
     }
 
     mp1_ioctl((40 << 16 | (6*80+60)), RTC_SYNC);
 
     for(i=0; i<WAIT; i++) {
-        ece391_read(rtc_fd, &garbage, 4);
-        mp1_rtc_tasklet(garbage);
+        ece391_nanosleep(0, TICK_NSEC);
+        mp1_rtc_tasklet(0);
     }
 
     mp1_ioctl(6*80+60, RTC_REMOVE);
 
     for(i=0; i<WAIT; i++) {
-        ece391_read(rtc_fd, &garbage, 4);
-        mp1_rtc_tasklet(garbage);
+        ece391_nanosleep(0, TICK_NSEC);
+        mp1_rtc_tasklet(0);
     }
 
-    ece391_close(rtc_fd);
-
     return 0;
 }
 
 void
-add_frames(uint8_t *f0, uint8_t *f1, int32_t rtc_fd)
+add_frames(uint8_t *f0, uint8_t *f1)
 {
     int32_t row, col, offset = 40, eof0 = 0, eof1 = 0, num_bytes;
     int32_t fd0, fd1;
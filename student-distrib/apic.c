@@ -0,0 +1,174 @@
+#include "apic.h"
+#include "lib.h"
+#include "scheduler.h"
+
+// local apic timer rate after the divider, set once by apic_init
+uint32_t apic_khz = 0;
+
+/* lapic_read
+* INPUTS: reg - register offset
+* OUTPUTS: none
+* RETURN: the register
+* DESCRIPTION: local apic registers are 32 bit loads from the mapped page
+*/
+static uint32_t lapic_read(uint32_t reg){
+    return *(volatile uint32_t*)(LAPIC_BASE + reg);
+}
+
+/* lapic_write
+* INPUTS: reg - register offset, val
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: local apic registers are 32 bit stores to the mapped page
+*/
+static void lapic_write(uint32_t reg, uint32_t val){
+    *(volatile uint32_t*)(LAPIC_BASE + reg) = val;
+}
+
+/* apic_init
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: 0 if the local apic timer can drive the tick, -1 to stay on the pit
+* DESCRIPTION: enables the local apic with the 8259 still delivering through lint0, then counts the
+*              apic timer down over the pit channel 2 one shot. Needs tsc_khz to convert deadlines
+*/
+int32_t apic_init(void){
+    uint32_t eax, ebx, ecx, edx, flags, elapsed;
+
+    cpuid(1, &eax, &ebx, &ecx, &edx);
+    if (!(edx & CPUID_APIC) || tsc_khz == 0){
+        return -1;
+    }
+    wrmsr(MSR_APIC_BASE, LAPIC_BASE | APIC_BASE_ENABLE);
+    lapic_write(LAPIC_SVR, SVR_ENABLE | APIC_SPURIOUS_VECTOR);
+    lapic_write(LAPIC_LVT_LINT0, LVT_EXTINT);
+    lapic_write(LAPIC_TIMER_DIV, TIMER_DIV_16);
+    lapic_write(LAPIC_LVT_TIMER, LVT_MASKED | APIC_TIMER_VECTOR);
+
+    cli_and_save(flags);
+    lapic_write(LAPIC_TIMER_INIT, 0xFFFFFFFF);
+    pit_calibrate_wait();
+    elapsed = 0xFFFFFFFF - lapic_read(LAPIC_TIMER_CURR);
+    lapic_write(LAPIC_TIMER_INIT, 0);
+    restore_flags(flags);
+
+    apic_khz = elapsed / CALIBRATE_MS;
+    if (apic_khz == 0){
+        return -1;
+    }
+    lapic_write(LAPIC_LVT_TIMER, APIC_TIMER_VECTOR);       // one shot, unmasked
+    return 0;
+}
+
+/* apic_ap_init
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: the part of apic_init an application processor needs. The timer runs at the rate the boot
+*              cpu measured, and lint0 stays masked since only the boot cpu ever took the 8259
+*/
+void apic_ap_init(void){
+    wrmsr(MSR_APIC_BASE, LAPIC_BASE | APIC_BASE_ENABLE);
+    lapic_write(LAPIC_SVR, SVR_ENABLE | APIC_SPURIOUS_VECTOR);
+    lapic_write(LAPIC_LVT_LINT0, LVT_MASKED);
+    lapic_write(LAPIC_TIMER_DIV, TIMER_DIV_16);
+    lapic_write(LAPIC_TIMER_INIT, 0);
+    lapic_write(LAPIC_LVT_TIMER, APIC_TIMER_VECTOR);       // one shot, unmasked
+}
+
+/* apic_id
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: local apic id of the running cpu
+* DESCRIPTION: reads the id register
+*/
+uint32_t apic_id(void){
+    return lapic_read(LAPIC_ID) >> ICR_DEST_SHIFT;
+}
+
+/* apic_lint0_mask
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: stops passing the 8259 through, once the io apic delivers the isa irqs
+*/
+void apic_lint0_mask(void){
+    lapic_write(LAPIC_LVT_LINT0, LVT_MASKED);
+}
+
+/* apic_send_ipi
+* INPUTS: dest - local apic id of the target, icr - delivery mode and vector
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: sends an interprocessor interrupt and waits until the local apic has sent it, which is
+*              not the same as the target having taken it
+*/
+void apic_send_ipi(uint32_t dest, uint32_t icr){
+    uint32_t flags;
+
+    cli_and_save(flags);
+    lapic_write(LAPIC_ICR_HIGH, dest << ICR_DEST_SHIFT);
+    lapic_write(LAPIC_ICR_LOW, icr);         // writing the low word sends it
+    while (lapic_read(LAPIC_ICR_LOW) & ICR_PENDING);
+    restore_flags(flags);
+}
+
+/* apic_ipi_handler
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: the wakeup ipi only has to get its cpu out of hlt, the idle loop looks for work itself
+*/
+void apic_ipi_handler(void){
+    apic_eoi();
+}
+
+/* apic_eoi
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: ends the apic timer interrupt or an ipi, send_eoi ends the irqs
+*/
+void apic_eoi(void){
+    lapic_write(LAPIC_EOI, 0);
+}
+
+/* apic_timer_oneshot
+* INPUTS: cycles - tsc cycles from now
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: arms the apic timer to interrupt once after about that long, replacing any earlier
+*              arming. Past 32 bits of cycles it fires early and the caller arms it again
+*/
+void apic_timer_oneshot(uint64_t cycles){
+    uint32_t count;
+
+    if (cycles >> 32){
+        cycles = 0xFFFFFFFF;
+    }
+    count = udiv64_sat(cycles * apic_khz, tsc_khz);
+    if (count < 0xFFFFFFFF){
+        count++;        // round up, firing before the deadline costs a second interrupt
+    }
+    lapic_write(LAPIC_TIMER_INIT, count);
+}
+
+/* apic_timer_stop
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: cancels the armed one shot
+*/
+void apic_timer_stop(void){
+    lapic_write(LAPIC_TIMER_INIT, 0);
+}
+
+/* apic_timer_remaining
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: apic timer counts left before the one shot fires, 0 if none is armed
+* DESCRIPTION: reads the current count
+*/
+uint32_t apic_timer_remaining(void){
+    return lapic_read(LAPIC_TIMER_CURR);
+}
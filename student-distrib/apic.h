@@ -0,0 +1,53 @@
+#if !defined(APIC_H)
+#define APIC_H
+
+#include "types.h"
+
+#define LAPIC_BASE 0xFEE00000       // where the local apic registers are, mapped uncached by initialize_paging
+#define LAPIC_PDE (LAPIC_BASE >> 22)
+#define MSR_APIC_BASE 0x1B
+#define APIC_BASE_ENABLE (1 << 11)
+#define CPUID_APIC (1 << 9)         // leaf 1 edx
+
+// register offsets
+#define LAPIC_ID 0x20
+#define LAPIC_EOI 0xB0
+#define LAPIC_SVR 0xF0
+#define LAPIC_LVT_TIMER 0x320
+#define LAPIC_LVT_LINT0 0x350
+#define LAPIC_TIMER_INIT 0x380
+#define LAPIC_TIMER_CURR 0x390
+#define LAPIC_TIMER_DIV 0x3E0
+#define LAPIC_ICR_LOW 0x300
+#define LAPIC_ICR_HIGH 0x310
+
+#define SVR_ENABLE 0x100
+#define LVT_MASKED (1 << 16)
+#define LVT_EXTINT 0x700            // lint0 passes the 8259 through as before
+#define TIMER_DIV_16 0x3
+
+// interrupt command register
+#define ICR_INIT 0x4500             // init, level asserted
+#define ICR_STARTUP 0x4600          // startup, the vector is the 4 KB page to start in
+#define ICR_FIXED 0x4000
+#define ICR_PENDING (1 << 12)
+#define ICR_DEST_SHIFT 24
+
+#define APIC_TIMER_VECTOR 0x30      // right after the 8259 vectors
+#define APIC_IPI_VECTOR 0x31        // wakes a halted cpu, the handler only ends it
+#define APIC_SPURIOUS_VECTOR 0xFF
+
+extern uint32_t apic_khz;
+
+int32_t apic_init(void);
+void apic_ap_init(void);
+uint32_t apic_id(void);
+void apic_lint0_mask(void);
+void apic_send_ipi(uint32_t dest, uint32_t icr);
+void apic_ipi_handler(void);
+void apic_eoi(void);
+void apic_timer_oneshot(uint64_t cycles);
+void apic_timer_stop(void);
+uint32_t apic_timer_remaining(void);
+
+#endif
@@ -0,0 +1,42 @@
+#include "clock.h"
+#include "lib.h"
+#include "rtc.h"
+#include "scheduler.h"
+#include "timer.h"
+
+// a whole page of its own, nothing else of the kernel becomes readable through the user mapping
+static uint8_t time_page_frame[TIME_PAGE_SIZE] __attribute__((aligned(TIME_PAGE_SIZE)));
+time_page_t* const time_page = (time_page_t*)time_page_frame;
+
+/* clock_init
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: fills the time page with the tsc scale from pit_calibrate_tsc and the cmos date as the
+*              wall clock at the current tsc, then maps it for user programs
+*/
+void clock_init(void){
+    uint64_t hz = (uint64_t)tsc_khz * 1000;
+    uint64_t tsc;
+    uint32_t cycle_shift = 0, shift = 32;
+
+    if (tsc_khz != 0){
+        while (hz >> 32){
+            hz >>= 1;
+            cycle_shift++;
+        }
+        // largest shift whose multiplier still fits 32 bits
+        while (shift > 0 && udiv64_sat((uint64_t)NSEC_PER_SEC << shift, (uint32_t)hz) == 0xFFFFFFFF){
+            shift--;
+        }
+        time_page->base_sec = rtc_read_time();
+        tsc = rdtsc();
+        time_page->base_tsc_lo = (uint32_t)tsc;
+        time_page->base_tsc_hi = (uint32_t)(tsc >> 32);
+        time_page->cycle_shift = cycle_shift;
+        time_page->cycles_per_sec = (uint32_t)hz;
+        time_page->mult = udiv64_sat((uint64_t)NSEC_PER_SEC << shift, (uint32_t)hz);
+        time_page->shift = shift;
+    }
+    time_page_assign((uint32_t)time_page_frame);
+}
@@ -0,0 +1,26 @@
+#if !defined(CLOCK_H)
+#define CLOCK_H
+
+#include "types.h"
+#include "paging.h"
+
+#define TIME_PAGE_SIZE 4096
+
+// what user programs read the clocks from without a system call, mapped read-only into every process.
+// Written once by clock_init, ece391support.h has the user copy
+typedef struct __attribute__((packed)) time_page_struct
+{
+    uint32_t base_tsc_lo;
+    uint32_t base_tsc_hi;
+    uint32_t base_sec;          // unix time when the tsc read base_tsc
+    uint32_t cycle_shift;       // tsc cycles are shifted right by this first, so a second fits 32 bits
+    uint32_t cycles_per_sec;    // shifted cycles in a second, 0 if the tsc was never calibrated
+    uint32_t mult;              // nanoseconds = (shifted cycles below a second * mult) >> shift
+    uint32_t shift;
+} time_page_t;
+
+extern time_page_t* const time_page;
+
+void clock_init(void);
+
+#endif
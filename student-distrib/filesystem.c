@@ -1,8 +1,171 @@
 #include "filesystem.h"
+#include "spinlock.h"
 
 
 static int16_t read_directory_index;
 
+static uint8_t dentry_hash[DENTRY_HASH_SIZE];      // dentry index + 1 for each slot, 0 marks an empty slot
+uint32_t dentry_lookups = 0;
+uint32_t dentry_probes = 0;
+
+// one bit per data block and per inode, set when in use. Bits past the end of the file system stay set
+static uint32_t block_bitmap[FS_MAX_BLOCKS / 32];
+static uint32_t inode_bitmap[FS_MAX_INODES / 32];
+static uint32_t block_hint = 0;         // first bitmap word that may still have a free block
+uint32_t fs_blocks_free = 0;
+uint32_t fs_inodes_free = 0;
+
+// writers of the inodes, the directory and the free maps. A mutex, so a write copying many blocks leaves
+// interrupts on
+static mutex_t fs_lock = MUTEX_INIT("fs      ");
+
+// running programs with text mapped straight onto each inode's data blocks, writes would change their code
+static volatile uint32_t text_maps[FS_MAX_INODES];
+
+/* dentry_hash_name
+* INPUTS: fname
+* OUTPUTS: none
+* RETURN: FNV-1a hash of the first FILENAME_LEN characters of fname
+* SIDE EFFECTS: none
+*/
+static uint32_t dentry_hash_name(const int8_t* fname){
+    uint32_t hash = 2166136261U;       // FNV-1a offset basis
+    int i;
+    for(i = 0; i < FILENAME_LEN && fname[i] != '\0'; i++){     // names longer than 32 chars are truncated like in strncmp
+        hash ^= (uint8_t)fname[i];
+        hash *= 16777619U;             // FNV-1a prime
+    }
+    return hash;
+}
+
+/* dentry_index_insert
+* INPUTS: index
+* OUTPUTS: none
+* RETURN: none
+* SIDE EFFECTS: adds a directory entry to the open-addressed name index (linear probing)
+*/
+static void dentry_index_insert(uint32_t index){
+    uint32_t slot = dentry_hash_name(dentry_ptr[index].filename) & (DENTRY_HASH_SIZE - 1);
+    while(dentry_hash[slot] != 0){          // table is at least twice the dentry count so this always ends
+        slot = (slot + 1) & (DENTRY_HASH_SIZE - 1);
+    }
+    dentry_hash[slot] = index + 1;
+}
+
+/* dentry_index_build
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: none
+* SIDE EFFECTS: fills the name index with every directory entry
+*/
+static void dentry_index_build(void){
+    uint32_t i;
+    for(i = 0; i < DENTRY_HASH_SIZE; i++){
+        dentry_hash[i] = 0;
+    }
+    for(i = 0; i < bootblock_ptr->directory_num && i < MAX_DENTRIES; i++){
+        dentry_index_insert(i);
+    }
+}
+
+/* fs_bitmap_set
+* INPUTS: bitmap, bit
+* OUTPUTS: none
+* RETURN: 1 if the bit was clear, 0 if it was already set
+* SIDE EFFECTS: marks a block or inode as used
+*/
+static uint32_t fs_bitmap_set(uint32_t* bitmap, uint32_t bit){
+    uint32_t mask = 1 << (bit & 31);
+    if(bitmap[bit >> 5] & mask){
+        return 0;
+    }
+    bitmap[bit >> 5] |= mask;
+    return 1;
+}
+
+/* fs_space_build
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: none
+* SIDE EFFECTS: marks the inodes of the regular files in the directory and the data blocks they hold
+*               as used, everything else up to datablocks_num and inodes_num is free
+*/
+static void fs_space_build(void){
+    uint32_t i, j, blocks, inode, block;
+    uint32_t num_blocks = (bootblock_ptr->datablocks_num < FS_MAX_BLOCKS) ? bootblock_ptr->datablocks_num : FS_MAX_BLOCKS;
+    inode_t* inode_curr;
+
+    for(i = 0; i < FS_MAX_BLOCKS / 32; i++){
+        block_bitmap[i] = 0xFFFFFFFF;
+    }
+    for(i = 0; i < FS_MAX_INODES / 32; i++){
+        inode_bitmap[i] = 0xFFFFFFFF;
+    }
+    for(i = 0; i < num_blocks; i++){
+        block_bitmap[i >> 5] &= ~(1 << (i & 31));
+    }
+    for(i = 0; i < bootblock_ptr->inodes_num && i < FS_MAX_INODES; i++){
+        inode_bitmap[i >> 5] &= ~(1 << (i & 31));
+    }
+    fs_blocks_free = num_blocks;
+    fs_inodes_free = (bootblock_ptr->inodes_num < FS_MAX_INODES) ? bootblock_ptr->inodes_num : FS_MAX_INODES;
+    block_hint = 0;
+
+    for(i = 0; i < bootblock_ptr->directory_num && i < MAX_DENTRIES; i++){
+        inode = dentry_ptr[i].inode;
+        if(dentry_ptr[i].filetype != FILETYPE_FILE || inode >= bootblock_ptr->inodes_num || inode >= FS_MAX_INODES){
+            continue;
+        }
+        fs_inodes_free -= fs_bitmap_set(inode_bitmap, inode);
+        inode_curr = inode_ptr + inode;
+        blocks = (inode_curr->length + FOUR_KB - 1) / FOUR_KB;
+        for(j = 0; j < blocks && j < MAX_FILE_BLOCKS; j++){
+            block = inode_curr->datablock[j];
+            if(block < num_blocks){
+                fs_blocks_free -= fs_bitmap_set(block_bitmap, block);
+            }
+        }
+    }
+}
+
+/* fs_block_alloc
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: a free data block, FS_NO_BLOCK if the file system is full
+* SIDE EFFECTS: first fit, the hint skips the full words at the start of the bitmap. Interrupts must be off
+*/
+static uint32_t fs_block_alloc(void){
+    uint32_t i, bit;
+    for(i = block_hint; i < FS_MAX_BLOCKS / 32; i++){
+        if(block_bitmap[i] != 0xFFFFFFFF){
+            bit = find_first_zero(block_bitmap[i]);
+            block_bitmap[i] |= 1 << bit;
+            fs_blocks_free--;
+            block_hint = i;
+            return (i << 5) + bit;
+        }
+    }
+    block_hint = i;
+    return FS_NO_BLOCK;
+}
+
+/* fs_block_free
+* INPUTS: block
+* OUTPUTS: none
+* RETURN: none
+* SIDE EFFECTS: gives a block from fs_block_alloc back. Interrupts must be off
+*/
+static void fs_block_free(uint32_t block){
+    if(block >= FS_MAX_BLOCKS || !(block_bitmap[block >> 5] & (1 << (block & 31)))){
+        return;
+    }
+    block_bitmap[block >> 5] &= ~(1 << (block & 31));
+    fs_blocks_free++;
+    if((block >> 5) < block_hint){
+        block_hint = block >> 5;
+    }
+}
+
 /* bootblock_init
 * DESCRIPTION: initializing all structs and their pointers
 * INPUTS: bootblock_address
@@ -15,10 +178,39 @@ int32_t bootblock_init(uint32_t bootblock_address){
     dentry_ptr = (dentry_t*)(bootblock_ptr->directory_entries);
     inode_ptr = (inode_t*)(bootblock_ptr + 1);
     datablock_ptr = (datablock_t*)(1 + bootblock_ptr + bootblock_ptr->inodes_num);     // + 1 because structure is zero indexed but bootblock is in first 4kB
+
+    // room for files to grow right after the image, so data block numbers stay indices into datablock_ptr
+    if(bootblock_ptr->datablocks_num + FS_EXTRA_BLOCKS <= FS_MAX_BLOCKS){
+        frame_reserve((uint32_t)(datablock_ptr + bootblock_ptr->datablocks_num),
+                (uint32_t)(datablock_ptr + bootblock_ptr->datablocks_num + FS_EXTRA_BLOCKS));
+        bootblock_ptr->datablocks_num += FS_EXTRA_BLOCKS;
+    }
+    dentry_index_build();
+    fs_space_build();
     return 0;       // return 0 to indicate initialization success
 }
 
 
+/* dentry_index_report
+* INPUTS: none
+* OUTPUTS: prints the average number of probes per name lookup
+* RETURN: none
+* SIDE EFFECTS: looks every directory entry up once through the name index
+*/
+void dentry_index_report(void){
+    dentry_t dentry;
+    uint32_t i, avg;
+    for(i = 0; i < bootblock_ptr->directory_num && i < MAX_DENTRIES; i++){
+        read_dentry_by_name((uint8_t*)dentry_ptr[i].filename, &dentry);
+    }
+    if(dentry_lookups == 0){
+        return;
+    }
+    avg = (dentry_probes * 100) / dentry_lookups;      // hundredths of a probe, printf has no floats
+    printf("dentry index: %u lookups, %u.%u%u probes per lookup\n", dentry_lookups, avg / 100, (avg / 10) % 10, avg % 10);
+}
+
+
 /* read_dentry_by_name
 * INPUTS: fname, dentry
 * OUTPUTS: none
@@ -26,26 +218,26 @@ int32_t bootblock_init(uint32_t bootblock_address){
 * SIDE EFFECTS: given the name, reading corresponding entry from directory
 */
 int32_t read_dentry_by_name(const uint8_t* fname, dentry_t* dentry){
-    int flag = 0;
-    int i = 0;
-    int index;
-    dentry_t temp;
-    int8_t* temp1;
-
-    for(i = 0; i < bootblock_ptr->directory_num; i++){     // iterating through all directory entry files
-        temp = dentry_ptr[i];
-        temp1 = (int8_t*)(temp.filename);
-        if(strncmp((int8_t*)fname, temp1, 32) == 0){        // checking if file names are equivalent
-            flag = 1;
-            index = i;
-            break;
-        }
-    }
-    if(flag != 1){
+    uint32_t slot;
+    uint32_t index;
+
+    if(fname == NULL){
         return -1;      // return -1 on failure
     }
 
-    return read_dentry_by_index(index, dentry);
+    dentry_lookups++;
+    slot = dentry_hash_name((int8_t*)fname) & (DENTRY_HASH_SIZE - 1);
+    while(dentry_hash[slot] != 0){      // probing until an empty slot means the name is not in the directory
+        dentry_probes++;
+        index = dentry_hash[slot] - 1;
+        if(strncmp((int8_t*)fname, dentry_ptr[index].filename, FILENAME_LEN) == 0){        // checking if file names are equivalent
+            return read_dentry_by_index(index, dentry);
+        }
+        slot = (slot + 1) & (DENTRY_HASH_SIZE - 1);
+    }
+    dentry_probes++;        // the empty slot also counts as a probe
+
+    return -1;      // return -1 on failure
 }
 
 
@@ -72,50 +264,237 @@ int32_t read_dentry_by_index(uint32_t index, dentry_t* dentry){
 * INPUTS: inode, offset, buf, length
 * OUTPUTS: none
 * RETURN: -1 if failure (invalid inode), length of file read if success
-* SIDE EFFECTS: reading a max of length bytes starting from offset until the end from file with given inode
+* SIDE EFFECTS: reading a max of length bytes starting from offset until the end from file with given inode,
+*               runs of physically contiguous datablocks are copied with a single memcpy
 */
 int32_t read_data(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length){
 
-    inode_t* inode_curr = (inode_t*)(inode_ptr + inode);     // ptr to inode for file we want to read
-    int index_curr_datablock = 0;
-    datablock_t* datablock_curr;
-    uint8_t* data_curr;
+    inode_t* inode_curr;
+    uint32_t index_curr_datablock;
+    uint32_t block_offset;
+    uint32_t run;
+    uint32_t span;
     uint32_t bytes_read = 0;
 
     // parameter validation
-    if(inode < 0 || inode > (bootblock_ptr->inodes_num - 1) ||          // inode in valid range or not
-    inode_curr->length == 0 ||                                          // inode length 0 then nothing to read
-    buf == NULL){                                                       // buf NULL check
+    if(inode >= bootblock_ptr->inodes_num ||          // inode in valid range or not
+    buf == NULL){                                       // buf NULL check
         return -1;      // return -1 on failure
     }
-    // reinitializing ptrs to all structures
-    bootblock_ptr = (bootblock_t*)(fstart);     // address of bootblock
-    dentry_ptr = bootblock_ptr->directory_entries;     // where directory entries begin in bootblock structure 
-    inode_ptr = (inode_t*)(bootblock_ptr + 1);           // where inodes begin in memory
-    datablock_ptr = (datablock_t*)(1 + bootblock_ptr + bootblock_ptr->inodes_num);      // +1 offset because inodes starts from 1 and structure is zero indexed
-    
-    int i = 0;
+    inode_curr = (inode_t*)(inode_ptr + inode);     // ptr to inode for file we want to read
+    if(offset >= inode_curr->length){                   // nothing left past the end of the file, or an empty file
+        return 0;
+    }
+    if(length > inode_curr->length - offset){           // clamp to the bytes remaining in the file
+        length = inode_curr->length - offset;
+    }
 
-    while(bytes_read < length && bytes_read < (uint32_t)(inode_curr->length)){
+    index_curr_datablock = offset / FOUR_KB;
+    block_offset = offset % FOUR_KB;
 
-        index_curr_datablock = (bytes_read + offset)/FOUR_KB;      // finding index of current datablock from current inode
-        if(bytes_read + offset >= inode_curr->length ||     // if offset + bytes currently read exceed size of current inode's datablock OR invalid datablock index then exit loop
-            index_curr_datablock >= 1023){                  // checking if curr_datablock exceeds max number of datablocks possible
-                // flag = 1;
-                break;
+    while(bytes_read < length && index_curr_datablock < 1023){      // checking if curr_datablock exceeds max number of datablocks possible
+        if(inode_curr->datablock[index_curr_datablock] >= bootblock_ptr->datablocks_num){     // corrupt datablock number, stop here
+            break;
         }
 
-        // at this point, datablock index is valid and we look to copy data over to buffer
-        datablock_curr = (datablock_t*)(datablock_ptr + inode_curr->datablock[index_curr_datablock]);   // getting to current datablock in memory structure
-        data_curr = datablock_curr->data;
-        for(i = (offset + bytes_read) % FOUR_KB; (bytes_read < (uint32_t)(inode_curr->length)) && (i < FOUR_KB) && (bytes_read < length); i++){        // iterating through datablock
-            buf[bytes_read] = data_curr[i];     // filling buffer with the data of the current datablock (single byte at a time)
-            bytes_read++;                       // moving onto the next byte to read
+        // extend the span while the next datablock directly follows the previous one in memory
+        run = 1;
+        while((run * FOUR_KB) - block_offset < length - bytes_read &&
+            index_curr_datablock + run < 1023 &&
+            inode_curr->datablock[index_curr_datablock + run] == inode_curr->datablock[index_curr_datablock + run - 1] + 1 &&
+            inode_curr->datablock[index_curr_datablock + run] < bootblock_ptr->datablocks_num){
+            run++;
         }
+
+        span = (run * FOUR_KB) - block_offset;
+        if(span > length - bytes_read){
+            span = length - bytes_read;
+        }
+
+        memcpy(buf + bytes_read, datablock_ptr[inode_curr->datablock[index_curr_datablock]].data + block_offset, span);
+        bytes_read += span;
+        index_curr_datablock += run;
+        block_offset = 0;           // every span after the first starts on a block boundary
     }
     return bytes_read;      // returning the total number of bytes read from the file onto the buf
 }
 
+/* write_data
+* INPUTS: inode, offset, buf, length
+* OUTPUTS: none
+* RETURN: -1 on failure or while a running program's text is mapped onto the file, else the number of
+*         bytes written, short if the file system or the inode fills up
+* SIDE EFFECTS: overwrites the file from offset and grows it past its end, taking new data blocks from the
+*               bitmap as the file reaches them. Only the blocks in [offset, offset + length) are touched.
+*               Files have no holes, offset can be at most the current length
+*/
+int32_t write_data(uint32_t inode, uint32_t offset, const uint8_t* buf, uint32_t length){
+    inode_t* inode_curr;
+    uint32_t index_curr_datablock;
+    uint32_t block_offset;
+    uint32_t blocks;
+    uint32_t block;
+    uint32_t span;
+    uint32_t bytes_written = 0;
+
+    // parameter validation
+    if(inode >= bootblock_ptr->inodes_num || inode >= FS_MAX_INODES ||
+    !(inode_bitmap[inode >> 5] & (1 << (inode & 31))) ||     // inode of no file
+    buf == NULL){
+        return -1;      // return -1 on failure
+    }
+    inode_curr = (inode_t*)(inode_ptr + inode);
+
+    mutex_lock(&fs_lock);
+    if(text_maps[inode] != 0 || offset > inode_curr->length || offset >= MAX_FILE_BLOCKS * FOUR_KB){
+        mutex_unlock(&fs_lock);
+        return -1;
+    }
+    if(length > MAX_FILE_BLOCKS * FOUR_KB - offset){     // clamp to the largest file an inode can describe
+        length = MAX_FILE_BLOCKS * FOUR_KB - offset;
+    }
+
+    blocks = (inode_curr->length + FOUR_KB - 1) / FOUR_KB;     // blocks the file holds now
+    index_curr_datablock = offset / FOUR_KB;
+    block_offset = offset % FOUR_KB;
+
+    while(bytes_written < length){
+        if(index_curr_datablock >= blocks){             // first write past the last block
+            block = fs_block_alloc();
+            if(block == FS_NO_BLOCK){
+                break;
+            }
+            inode_curr->datablock[index_curr_datablock] = block;
+            blocks++;
+        }
+
+        span = FOUR_KB - block_offset;
+        if(span > length - bytes_written){
+            span = length - bytes_written;
+        }
+        memcpy(datablock_ptr[inode_curr->datablock[index_curr_datablock]].data + block_offset, buf + bytes_written, span);
+        bytes_written += span;
+        index_curr_datablock++;
+        block_offset = 0;
+    }
+
+    if(offset + bytes_written > inode_curr->length){
+        inode_curr->length = offset + bytes_written;
+    }
+    mutex_unlock(&fs_lock);
+
+    return (bytes_written == 0 && length != 0) ? -1 : bytes_written;     // -1 when the file system is full
+}
+
+/* truncate_data
+* INPUTS: inode, length
+* OUTPUTS: none
+* RETURN: -1 for an inode of no file or while a running program's text is mapped onto it, 0 on success
+* SIDE EFFECTS: shortens the file to length bytes and frees the data blocks past it, a longer length
+*               leaves the file alone
+*/
+int32_t truncate_data(uint32_t inode, uint32_t length){
+    inode_t* inode_curr;
+    uint32_t keep, blocks, i;
+
+    if(inode >= bootblock_ptr->inodes_num || inode >= FS_MAX_INODES ||
+    !(inode_bitmap[inode >> 5] & (1 << (inode & 31)))){
+        return -1;
+    }
+    inode_curr = (inode_t*)(inode_ptr + inode);
+
+    mutex_lock(&fs_lock);
+    if(text_maps[inode] != 0){
+        mutex_unlock(&fs_lock);
+        return -1;
+    }
+    if(length < inode_curr->length){
+        keep = (length + FOUR_KB - 1) / FOUR_KB;
+        blocks = (inode_curr->length + FOUR_KB - 1) / FOUR_KB;
+        for(i = keep; i < blocks && i < MAX_FILE_BLOCKS; i++){
+            fs_block_free(inode_curr->datablock[i]);
+        }
+        inode_curr->length = length;
+    }
+    mutex_unlock(&fs_lock);
+    return 0;
+}
+
+/* text_map_get
+* INPUTS: inode
+* OUTPUTS: none
+* RETURN: none
+* SIDE EFFECTS: counts a program whose text execute mapped onto the data blocks of inode, write_data and
+*               truncate_data refuse the file until every such program is gone
+*/
+void text_map_get(uint32_t inode){
+    if(inode < FS_MAX_INODES){
+        fetch_add(&text_maps[inode], 1);
+    }
+}
+
+/* text_map_put
+* INPUTS: inode
+* OUTPUTS: none
+* RETURN: none
+* SIDE EFFECTS: drops the count taken by text_map_get once the program's page table is freed. No lock, the
+*               caller may be running on the kernel stack it is freeing with interrupts off
+*/
+void text_map_put(uint32_t inode){
+    if(inode < FS_MAX_INODES){
+        fetch_add(&text_maps[inode], -1);
+    }
+}
+
+/* file_create
+* INPUTS: fname, dentry
+* OUTPUTS: the directory entry of the file in dentry
+* RETURN: -1 on failure and 0 on success
+* SIDE EFFECTS: adds an empty regular file with a free inode to the directory, an existing name is
+*               returned as it is
+*/
+int32_t file_create(const uint8_t* fname, dentry_t* dentry){
+    uint32_t length, index, i;
+    uint32_t inode = FS_MAX_INODES;
+
+    if(fname == NULL || dentry == NULL){
+        return -1;
+    }
+    length = strlen((int8_t*)fname);
+    if(length == 0 || length > FILENAME_LEN){
+        return -1;
+    }
+
+    mutex_lock(&fs_lock);
+    if(read_dentry_by_name(fname, dentry) == 0){        // created while we were getting here
+        mutex_unlock(&fs_lock);
+        return 0;
+    }
+    for(i = 0; i < FS_MAX_INODES / 32; i++){
+        if(inode_bitmap[i] != 0xFFFFFFFF){
+            inode = (i << 5) + find_first_zero(inode_bitmap[i]);
+            break;
+        }
+    }
+    if(bootblock_ptr->directory_num >= MAX_DENTRIES || inode >= FS_MAX_INODES){
+        mutex_unlock(&fs_lock);
+        return -1;
+    }
+    fs_inodes_free -= fs_bitmap_set(inode_bitmap, inode);
+    (inode_ptr + inode)->length = 0;
+
+    index = bootblock_ptr->directory_num;
+    memset(&dentry_ptr[index], 0, sizeof(dentry_t));
+    strncpy(dentry_ptr[index].filename, (int8_t*)fname, FILENAME_LEN);
+    dentry_ptr[index].filetype = FILETYPE_FILE;
+    dentry_ptr[index].inode = inode;
+    bootblock_ptr->directory_num++;
+    dentry_index_insert(index);
+    mutex_unlock(&fs_lock);
+
+    return read_dentry_by_index(index, dentry);
+}
+
 // File Functions
 
 /* file_open
@@ -155,7 +534,7 @@ int32_t file_close(int32_t filedescriptor){
 */
 int32_t file_read(int32_t fd, void* buf, int32_t n){
 
-    pcb_t* curr_pcb = terminal_arr[running_terminal].curr_pcb;
+    pcb_t* curr_pcb = pcb_ptr;
     int bytes_read = 0;
     if(n == 0){
         return 0; 
@@ -173,14 +552,30 @@ int32_t file_read(int32_t fd, void* buf, int32_t n){
 /* file_write
 * INPUTS: filedescriptor, buf, n
 * OUTPUTS: none
-* RETURN: -1 always
-* SIDE EFFECTS: always returns -1 since this is a read-only file system
+* RETURN: number of bytes written, -1 on failure
+* SIDE EFFECTS: writes at the file position, or at the end of the file if it was opened with O_APPEND,
+*               and moves the file position past the written bytes
 */
 int32_t file_write(int32_t filedescriptor, const void* buf, int32_t n){
-    if(filedescriptor < 0 || filedescriptor > 7 || buf == NULL){        // parameter validation: checking validity of filedescriptor and buf NULL check
+    pcb_t* curr_pcb = pcb_ptr;
+    int32_t bytes_written;
+
+    if(filedescriptor < 0 || filedescriptor > 7 || buf == NULL || n < 0){        // parameter validation: checking validity of filedescriptor and buf NULL check
         return -1;
     }
-    return -1;      // can do parameter validation for filedescriptor using cases but return value is -1 always
+    if(n == 0){
+        return 0;
+    }
+
+    if((curr_pcb->fd_array[filedescriptor]).oflags & O_APPEND){
+        (curr_pcb->fd_array[filedescriptor]).fpos = (inode_ptr + (curr_pcb->fd_array[filedescriptor]).inode)->length;
+    }
+    bytes_written = write_data((curr_pcb->fd_array[filedescriptor]).inode, (curr_pcb->fd_array[filedescriptor]).fpos, buf, n);
+
+    if(bytes_written != -1){
+        (curr_pcb->fd_array[filedescriptor]).fpos += bytes_written;
+    }
+    return bytes_written;
 }
 
 
@@ -221,7 +616,7 @@ int32_t directory_close(int32_t filedescriptor){                    // DOES NOTH
 */
 int32_t directory_read(int32_t filedescriptor, void* buf_arg, int32_t n){
     uint8_t* buf = (uint8_t*) buf_arg;
-    pcb_t* curr_pcb = terminal_arr[running_terminal].curr_pcb;
+    pcb_t* curr_pcb = pcb_ptr;
     // parameter validation
     if (filedescriptor < 2 || filedescriptor > 7 || buf == NULL) {  // checking for invalid file descriptor, buf NULL check
         return -1;                                                  // return -1 on failure
@@ -230,6 +625,9 @@ int32_t directory_read(int32_t filedescriptor, void* buf_arg, int32_t n){
     int8_t* dentry_filename;
     int numBytes = 0;
 
+    if ((curr_pcb->fd_array[filedescriptor]).fpos >= bootblock_ptr->directory_num) {    // past the last entry, created files included
+        return 0;
+    }
     dentry_filename = dentry_ptr[(curr_pcb->fd_array[filedescriptor]).fpos].filename;
     if (strlen((int8_t*)dentry_filename) > 32) {
         strncpy((int8_t*)(&buf[0]), dentry_filename, 32);
@@ -240,10 +638,7 @@ int32_t directory_read(int32_t filedescriptor, void* buf_arg, int32_t n){
     }
     
     (curr_pcb->fd_array[filedescriptor]).fpos++;
-    if ((curr_pcb->fd_array[filedescriptor]).fpos <= 17) {
-        return numBytes;
-    }
-    return 0;
+    return numBytes;
 }
 
 /* directory_write
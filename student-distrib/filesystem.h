@@ -8,6 +8,23 @@
 #include "terminal.h"
 #include "system_calls.h"
 
+#define FILENAME_LEN 32
+#define MAX_DENTRIES 63
+#define DENTRY_HASH_SIZE 128        // power of two, at least twice MAX_DENTRIES to keep probe chains short
+#define FILETYPE_FILE 2
+#define MAX_FILE_BLOCKS 1023        // datablock entries in an inode
+
+// writable file system
+#define FS_EXTRA_BLOCKS 256         // blank data blocks after the image that files can grow into (1 MB)
+#define FS_MAX_BLOCKS 4096          // data blocks the free block bitmap can track
+#define FS_MAX_INODES 1024
+#define FS_NO_BLOCK 0xFFFFFFFF
+
+// flags for open_flags
+#define O_CREATE 0x1                // make an empty file if the name is not found
+#define O_TRUNC 0x2                 // drop the contents of a regular file
+#define O_APPEND 0x4                // every write goes to the end of the file
+
 typedef struct __attribute__((packed)) dentry_struct         // struct for dentry
 {
     int8_t filename[32];
@@ -40,13 +57,27 @@ dentry_t* dentry_ptr;
 inode_t* inode_ptr;
 datablock_t* datablock_ptr;
 
+// name index statistics (every probe made by read_dentry_by_name)
+extern uint32_t dentry_lookups;
+extern uint32_t dentry_probes;
+
+// free space left for writes
+extern uint32_t fs_blocks_free;
+extern uint32_t fs_inodes_free;
+
 // file system functions
 int32_t read_dentry_by_name(const uint8_t* fname, dentry_t* dentry);
 int32_t read_dentry_by_index(uint32_t index, dentry_t* dentry);
 int32_t read_data(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length);
+int32_t write_data(uint32_t inode, uint32_t offset, const uint8_t* buf, uint32_t length);
+int32_t truncate_data(uint32_t inode, uint32_t length);
+int32_t file_create(const uint8_t* fname, dentry_t* dentry);
+void text_map_get(uint32_t inode);
+void text_map_put(uint32_t inode);
 
 // initialize bootblocker
 int32_t bootblock_init(uint32_t bootblock_address);
+void dentry_index_report(void);
 
 // file functions
 int32_t file_open(const uint8_t *fname);
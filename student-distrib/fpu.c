@@ -0,0 +1,212 @@
+#include "fpu.h"
+#include "lib.h"
+#include "system_calls.h"
+
+// device not available traps taken, each one is a task touching the fpu after a switch
+uint32_t fpu_traps = 0;
+
+// 0 on cpus without fxsave, then the state is kept with fnsave/frstor
+static uint8_t fpu_fxsr = 0;
+
+// shadow of this cpu's cr0.ts so switches between tasks that leave the fpu alone never write cr0
+#define fpu_ts_set (this_cpu()->fpu_ts_set)
+
+// registers a task starts with, fninit plus the default mxcsr
+static uint8_t fpu_init_state[FPU_STATE_BYTES] __attribute__((aligned(FPU_STATE_ALIGN)));
+
+/* fpu_area
+* INPUTS: task
+* OUTPUTS: none
+* RETURN: the 16 byte aligned save area inside the task's pcb
+* DESCRIPTION: pcb_t is packed, so the buffer is oversized and aligned here
+*/
+static uint8_t* fpu_area(pcb_t* task){
+    return (uint8_t*)(((uint32_t)task->fpu_state + FPU_STATE_ALIGN - 1) & ~(FPU_STATE_ALIGN - 1));
+}
+
+/* fpu_save
+* INPUTS: area
+* OUTPUTS: the fpu registers in area
+* RETURN: none
+* DESCRIPTION: cr0.ts must be clear
+*/
+static void fpu_save(uint8_t* area){
+    if (fpu_fxsr){
+        asm volatile ("fxsave (%0)" : : "r"(area) : "memory");
+    }
+    else{
+        asm volatile ("fnsave (%0)" : : "r"(area) : "memory");
+    }
+}
+
+/* fpu_restore
+* INPUTS: area
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: loads the fpu registers from an image fpu_save wrote, cr0.ts must be clear
+*/
+static void fpu_restore(uint8_t* area){
+    if (fpu_fxsr){
+        asm volatile ("fxrstor (%0)" : : "r"(area) : "memory");
+    }
+    else{
+        asm volatile ("frstor (%0)" : : "r"(area) : "memory");
+    }
+}
+
+/* fpu_set_ts
+* INPUTS: ts - 1 to make the next fpu instruction trap, 0 to let it run
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: writes cr0 only when ts actually changes
+*/
+static void fpu_set_ts(uint32_t ts){
+    uint32_t cr0;
+
+    if (ts == fpu_ts_set){
+        return;
+    }
+    fpu_ts_set = ts;
+    if (!ts){
+        asm volatile ("clts" : : : "memory");
+        return;
+    }
+    asm volatile ("movl %%cr0, %0" : "=r"(cr0));
+    asm volatile ("movl %0, %%cr0" : : "r"(cr0 | CR0_TS) : "memory");
+}
+
+/* fpu_init
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: turns on the fpu and, where the cpu has them, fxsave and sse. Records the clean register
+*              image new tasks start from and leaves cr0.ts set so the first use traps. Every cpu runs it
+*/
+void fpu_init(void){
+    uint32_t eax, ebx, ecx, edx, cr0, cr4, mxcsr = MXCSR_DEFAULT;
+
+    cpuid(1, &eax, &ebx, &ecx, &edx);
+
+    asm volatile ("movl %%cr0, %0" : "=r"(cr0));
+    cr0 = (cr0 & ~(CR0_EM | CR0_TS)) | CR0_MP | CR0_NE;      // fpu errors come in as exception 16
+    asm volatile ("movl %0, %%cr0" : : "r"(cr0) : "memory");
+
+    if (edx & CPUID_FXSR){
+        fpu_fxsr = 1;
+        asm volatile ("movl %%cr4, %0" : "=r"(cr4));
+        cr4 |= CR4_OSFXSR;
+        if (edx & CPUID_SSE){
+            cr4 |= CR4_OSXMMEXCPT;
+        }
+        asm volatile ("movl %0, %%cr4" : : "r"(cr4) : "memory");
+    }
+
+    asm volatile ("fninit");
+    if (edx & CPUID_SSE){
+        asm volatile ("ldmxcsr %0" : : "m"(mxcsr));
+    }
+    fpu_save(fpu_init_state);
+
+    fpu_owner = NULL;
+    fpu_ts_set = 0;
+    fpu_set_ts(1);
+}
+
+/* fpu_task_init
+* INPUTS: task
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: a new task has no fpu state until its first fpu instruction
+*/
+void fpu_task_init(pcb_t* task){
+    task->fpu_used = 0;
+}
+
+/* fpu_switch
+* INPUTS: next - task about to run
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: called on every change of pcb_ptr with interrupts off. With one cpu nothing is saved here,
+*              the fpu keeps the owner's registers and cr0.ts makes any other task trap before touching
+*              them. With more the owner may resume on another cpu, so its registers go to its pcb now
+*/
+void fpu_switch(pcb_t* next){
+    if (smp_cpus > 1 && fpu_owner != NULL && fpu_owner != next){
+        fpu_set_ts(0);
+        fpu_save(fpu_area(fpu_owner));
+        fpu_owner = NULL;
+    }
+    fpu_set_ts(next != fpu_owner);
+}
+
+/* fpu_release
+* INPUTS: task - task that is going away
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: forgets the fpu registers of a task so they are never saved into its freed pcb
+*/
+void fpu_release(pcb_t* task){
+    if (fpu_owner == task){
+        fpu_owner = NULL;
+        fpu_set_ts(1);
+    }
+}
+
+/* fpu_nm_handler
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: device not available trap, the running task used the fpu while cr0.ts was set. Saves the
+*              previous owner's registers into its pcb and loads the running task's, or the clean image
+*              on its first use, with interrupts off. Returns to the faulting instruction through fpu_nm_linkage
+*/
+void fpu_nm_handler(void){
+    pcb_t* task;
+    uint32_t flags;
+
+    cli_and_save(flags);        // a switch between the save and the restore could move the task to another cpu
+    task = pcb_ptr;
+    fpu_set_ts(0);
+    if (task == NULL || task == fpu_owner){
+        restore_flags(flags);
+        return;
+    }
+    fpu_traps++;
+    if (fpu_owner != NULL){
+        fpu_save(fpu_area(fpu_owner));
+    }
+    fpu_restore(task->fpu_used ? fpu_area(task) : fpu_init_state);
+    task->fpu_used = 1;
+    fpu_owner = task;
+    restore_flags(flags);
+}
+
+/* kernel_fpu_begin
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: saved eflags for kernel_fpu_end
+* DESCRIPTION: lets kernel code use the fpu and xmm registers. The owner's registers go to its pcb first,
+*              so the owner reloads them on its next fpu instruction. Interrupts stay off until the end
+*/
+uint32_t kernel_fpu_begin(void){
+    uint32_t flags;
+
+    cli_and_save(flags);
+    fpu_set_ts(0);
+    if (fpu_owner != NULL){
+        fpu_save(fpu_area(fpu_owner));
+        fpu_owner = NULL;
+    }
+    return flags;
+}
+
+/* kernel_fpu_end
+* INPUTS: flags - from kernel_fpu_begin
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: the fpu now holds kernel scratch values, so the next user fpu instruction has to trap
+*/
+void kernel_fpu_end(uint32_t flags){
+    fpu_set_ts(1);
+    restore_flags(flags);
+}
@@ -0,0 +1,37 @@
+#if !defined(FPU_H)
+#define FPU_H
+
+#include "types.h"
+#include "smp.h"
+
+#define FPU_STATE_BYTES 512        // fxsave image, fnsave only needs 108
+#define FPU_STATE_ALIGN 16
+
+// cpuid leaf 1 edx
+#define CPUID_FXSR (1 << 24)
+#define CPUID_SSE (1 << 25)
+
+#define CR0_MP 0x2
+#define CR0_EM 0x4
+#define CR0_TS 0x8
+#define CR0_NE 0x20
+#define CR4_OSFXSR 0x200
+#define CR4_OSXMMEXCPT 0x400
+
+#define MXCSR_DEFAULT 0x1F80       // every sse exception masked, round to nearest
+
+struct pcb_struct;
+
+extern void fpu_init(void);
+extern void fpu_task_init(struct pcb_struct* task);
+extern void fpu_switch(struct pcb_struct* next);
+extern void fpu_release(struct pcb_struct* task);
+extern void fpu_nm_handler(void);
+extern uint32_t kernel_fpu_begin(void);
+extern void kernel_fpu_end(uint32_t flags);
+
+// task whose registers are loaded in this cpu's fpu, NULL when every task's state is in its pcb
+#define fpu_owner (this_cpu()->fpu_owner)
+extern uint32_t fpu_traps;
+
+#endif
@@ -0,0 +1,171 @@
+#include "frame.h"
+#include "lib.h"
+
+// one bit per 4kb physical frame below FRAME_HIGH_LIMIT, set when the frame is in use
+static uint32_t frame_bitmap[NUM_FRAMES / 32];
+
+// first bitmap word that may still have a free frame, everything below it is full
+static uint32_t frame_hint = 0;
+
+uint32_t frames_free = 0;
+
+/* frame_mark
+* INPUTS: start, end, used
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: marks every frame fully inside [start, end) as used or free
+*/
+static void frame_mark(uint32_t start, uint32_t end, uint32_t used){
+    uint32_t frame = (start + FRAME_SIZE - 1) >> FRAME_SHIFT;
+    uint32_t last = end >> FRAME_SHIFT;
+    uint32_t mask;
+
+    if (last > NUM_FRAMES){
+        last = NUM_FRAMES;
+    }
+    for (; frame < last; frame++){
+        mask = 1 << (frame & 31);
+        if (used && !(frame_bitmap[frame >> 5] & mask)){
+            frame_bitmap[frame >> 5] |= mask;
+            frames_free--;
+        }
+        else if (!used && (frame_bitmap[frame >> 5] & mask)){
+            frame_bitmap[frame >> 5] &= ~mask;
+            frames_free++;
+        }
+    }
+}
+
+/* frame_init
+* INPUTS: mbi - multiboot information from the boot loader
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: frees every frame between 8 MB and 128 MB the boot loader's memory map reports as
+*              available ram, without a memory map it falls back to mem_upper. Must run before paging
+*              is enabled since the multiboot structures live in unmapped low memory
+*/
+void frame_init(multiboot_info_t* mbi){
+    memory_map_t* mmap;
+    uint32_t i;
+
+    for (i = 0; i < NUM_FRAMES / 32; i++){
+        frame_bitmap[i] = 0xFFFFFFFF;
+    }
+    frames_free = 0;
+    frame_hint = 0;
+
+    if (mbi->flags & (1 << 6)){
+        for (mmap = (memory_map_t *)mbi->mmap_addr;
+                (unsigned long)mmap < mbi->mmap_addr + mbi->mmap_length;
+                mmap = (memory_map_t *)((unsigned long)mmap + mmap->size + sizeof (mmap->size))){
+            if (mmap->type != MULTIBOOT_MEMORY_AVAILABLE || mmap->base_addr_high != 0){
+                continue;
+            }
+            if (mmap->length_high != 0 || mmap->base_addr_low + mmap->length_low < mmap->base_addr_low){
+                frame_mark(mmap->base_addr_low, FRAME_HIGH_LIMIT, 0);       // region runs past 4 GB
+            }
+            else{
+                frame_mark(mmap->base_addr_low, mmap->base_addr_low + mmap->length_low, 0);
+            }
+        }
+    }
+    else if (mbi->flags & 1){
+        frame_mark(0x100000, 0x100000 + (mbi->mem_upper << 10), 0);        // mem_upper is in kb above 1 MB
+    }
+
+    frame_reserve(0, FRAME_LOW_LIMIT);
+}
+
+/* frame_reserve
+* INPUTS: start, end
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: keeps the allocator away from [start, end), used for boot modules
+*/
+void frame_reserve(uint32_t start, uint32_t end){
+    frame_mark(start & ~(FRAME_SIZE - 1), end + FRAME_SIZE - 1, 1);
+}
+
+/* frame_alloc
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: physical address of a free 4kb frame, 0 if memory is exhausted
+* DESCRIPTION: first fit, the hint skips the full words at the start of the bitmap
+*/
+uint32_t frame_alloc(void){
+    uint32_t flags, i, bit, addr = 0;
+
+    cli_and_save(flags);
+    for (i = frame_hint; i < NUM_FRAMES / 32; i++){
+        if (frame_bitmap[i] != 0xFFFFFFFF){
+            bit = find_first_zero(frame_bitmap[i]);
+            frame_bitmap[i] |= 1 << bit;
+            frames_free--;
+            addr = ((i << 5) + bit) << FRAME_SHIFT;
+            break;
+        }
+    }
+    frame_hint = i;
+    restore_flags(flags);
+    return addr;
+}
+
+/* frame_alloc_pair
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: physical address of two free frames aligned on 8kb, 0 if none are left
+* DESCRIPTION: used for kernel stacks, which keep the pcb at their 8kb aligned bottom
+*/
+uint32_t frame_alloc_pair(void){
+    uint32_t flags, i, bit, pairs, addr = 0;
+
+    cli_and_save(flags);
+    for (i = frame_hint; i < NUM_FRAMES / 32; i++){
+        pairs = frame_bitmap[i] | (frame_bitmap[i] >> 1);       // even bit clear when both frames of the pair are free
+        pairs |= 0xAAAAAAAA;
+        if (pairs != 0xFFFFFFFF){
+            bit = find_first_zero(pairs);
+            frame_bitmap[i] |= 3 << bit;
+            frames_free -= 2;
+            addr = ((i << 5) + bit) << FRAME_SHIFT;
+            break;
+        }
+    }
+    restore_flags(flags);
+    return addr;
+}
+
+/* frame_free
+* INPUTS: addr
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: gives a frame from frame_alloc back
+*/
+void frame_free(uint32_t addr){
+    uint32_t flags;
+    uint32_t frame = addr >> FRAME_SHIFT;
+
+    if (addr < FRAME_LOW_LIMIT || frame >= NUM_FRAMES){
+        return;
+    }
+    cli_and_save(flags);
+    if (frame_bitmap[frame >> 5] & (1 << (frame & 31))){
+        frame_bitmap[frame >> 5] &= ~(1 << (frame & 31));
+        frames_free++;
+        if ((frame >> 5) < frame_hint){
+            frame_hint = frame >> 5;
+        }
+    }
+    restore_flags(flags);
+}
+
+/* frame_free_pair
+* INPUTS: addr
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: gives a kernel stack from frame_alloc_pair back
+*/
+void frame_free_pair(uint32_t addr){
+    frame_free(addr);
+    frame_free(addr + FRAME_SIZE);
+}
@@ -0,0 +1,23 @@
+#if !defined(FRAME_H)
+#define FRAME_H
+
+#include "types.h"
+#include "multiboot.h"
+
+#define FRAME_SIZE 0x1000
+#define FRAME_SHIFT 12
+#define FRAME_LOW_LIMIT 0x800000        // below 8 MB: low memory, video memory and the kernel's 4 MB page
+#define FRAME_HIGH_LIMIT 0x8000000      // the kernel identity maps physical memory up to the 128 MB user window
+#define NUM_FRAMES (FRAME_HIGH_LIMIT / FRAME_SIZE)
+#define MULTIBOOT_MEMORY_AVAILABLE 1
+
+extern void frame_init(multiboot_info_t* mbi);
+extern void frame_reserve(uint32_t start, uint32_t end);
+extern uint32_t frame_alloc(void);
+extern uint32_t frame_alloc_pair(void);
+extern void frame_free(uint32_t addr);
+extern void frame_free_pair(uint32_t addr);
+
+extern uint32_t frames_free;
+
+#endif
@@ -3,6 +3,8 @@
 #include "handlers.h"
 #include "i8259.h"
 #include "rtc.h"
+#include "system_calls.h"
+#include "trace.h"
 
 /*
  * 	exception0
@@ -15,6 +17,7 @@
  */
 void exception0()
 {
+    kernel_enter();                     // %gs and the kernel lock, the exception may come from user mode
     cli();                              // start critical section
     printf("Divide Error Exception\n"); // print exception message
     sti();                              // end critical section (never reaches this line)
@@ -44,6 +47,7 @@ void exception0()
  */
 void exception1()
 {
+    kernel_enter();
     cli();
     printf("Debug Exception\n");
     sti();
@@ -73,6 +77,7 @@ void exception1()
  */
 void exception2()
 {
+    kernel_enter();
     cli();
     printf("NMI Interrupt\n");
     sti();
@@ -102,6 +107,7 @@ void exception2()
  */
 void exception3()
 {
+    kernel_enter();
     cli();
     printf("Breakpoint Exception\n");
     sti();
@@ -131,6 +137,7 @@ void exception3()
  */
 void exception4()
 {
+    kernel_enter();
     cli();
     printf("Overflow Exception\n");
     sti();
@@ -160,6 +167,7 @@ void exception4()
  */
 void exception5()
 {
+    kernel_enter();
     cli();
     printf("BOUND Range Exceeded Exception\n");
     sti();
@@ -189,6 +197,7 @@ void exception5()
  */
 void exception6()
 {
+    kernel_enter();
     cli();
     printf("Invalid Opcode Exception\n");
     sti();
@@ -218,6 +227,7 @@ void exception6()
  */
 void exception7()
 {
+    kernel_enter();
     cli();
     printf("Device Not Available Exception\n");
     sti();
@@ -247,6 +257,7 @@ void exception7()
  */
 void exception8()
 {
+    kernel_enter();
     cli();
     printf("Double Fault Exception\n");
     sti();
@@ -276,6 +287,7 @@ void exception8()
  */
 void exception9()
 {
+    kernel_enter();
     cli();
     printf("Coprocessor Segment Overrun\n");
     sti();
@@ -305,6 +317,7 @@ void exception9()
  */
 void exception10()
 {
+    kernel_enter();
     cli();
     printf("Invalid TSS Exception\n");
     sti();
@@ -334,6 +347,7 @@ void exception10()
  */
 void exception11()
 {
+    kernel_enter();
     cli();
     printf("Segment Not Present\n");
     sti();
@@ -363,6 +377,7 @@ void exception11()
  */
 void exception12()
 {
+    kernel_enter();
     cli();
     printf("Stack Fault Exception\n");
     sti();
@@ -392,6 +407,7 @@ void exception12()
  */
 void exception13()
 {
+    kernel_enter();
     cli();
     printf("General Protection Exception\n");
     sti();
@@ -421,12 +437,10 @@ void exception13()
  */
 void exception14()
 {
+    kernel_enter();
     cli();                            // start critical section
     printf("Page Fault Exception\n"); // print exception message
-    while (1)
-    {
-    }
-    sti(); // end critical section (never reaches this line)
+    sti(); // end critical section
 
     int call_number = 1;
     int firstArg = 256;
@@ -442,6 +456,24 @@ void exception14()
                  : "a"(call_number), "b"(firstArg));
 }
 
+/*
+ * 	page_fault_handler
+ *   DESCRIPTION: Called from page_fault_linkage. Not-present faults inside the 128-132 MB user window
+ *                are served by loading the page on demand, anything else is a real page fault
+ *   INPUTS: fault_addr - CR2, error_code - page fault error code pushed by the processor
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: maps and fills one user page, or squashes the program through exception14
+ */
+void page_fault_handler(uint32_t fault_addr, uint32_t error_code)
+{
+    TRACE(TRACE_PAGE_FAULT, fault_addr);
+    if (!(error_code & PF_ERR_PRESENT) && user_page_fault(fault_addr) == 0){
+        return;     // page is now present, the faulting instruction is retried
+    }
+    exception14();
+}
+
 // void exception15(){
 //     printf("NMI Interrupt");
 //     while(1){}
@@ -458,6 +490,7 @@ void exception14()
  */
 void exception16()
 {
+    kernel_enter();
     cli();
     printf("x87 FPU Floating Point Error\n");
     sti();
@@ -487,6 +520,7 @@ void exception16()
  */
 void exception17()
 {
+    kernel_enter();
     cli();
     printf("Aligment Check Exception\n");
     sti();
@@ -516,6 +550,7 @@ void exception17()
  */
 void exception18()
 {
+    kernel_enter();
     cli();
     printf("Machine-Check Exception\n");
     sti();
@@ -545,6 +580,7 @@ void exception18()
  */
 void exception19()
 {
+    kernel_enter();
     cli();
     printf("SIMD Floating-Point Exception\n");
     sti();
@@ -1,6 +1,10 @@
 #if !defined(HANDLERS_H)
 #define HANDLERS_H
 
+#include "types.h"
+
+#define PF_ERR_PRESENT 0x1      // page fault error code bit: fault on a present page (protection violation)
+
 //see function interfaces in handlers.c for more details
 
 extern void exception0();
@@ -18,6 +22,7 @@ extern void exception11();
 extern void exception12();
 extern void exception13();
 extern void exception14();
+extern void page_fault_handler(uint32_t fault_addr, uint32_t error_code);
 //void exception15();
 extern void exception16();
 extern void exception17();
@@ -4,6 +4,8 @@
 // some code adapted from wiki.osdev.org and kernel.org
 #include "i8259.h"
 #include "lib.h"
+#include "ioapic.h"
+#include "apic.h"
 
 /* Interrupt masks to determine which interrupts are enabled and disabled */
 uint8_t master_mask; /* IRQs 0-7  */
@@ -49,6 +51,10 @@ void enable_irq(uint32_t irq_num) {
     uint16_t port;  // initialize variable to store port
     uint8_t value;  // initialize variable to store new mask
 
+    if (ioapic_active) {              // the 8259 stays masked once the io apic routes the irqs
+        ioapic_enable_irq(irq_num);
+        return;
+    }
     if (irq_num < 8) {  // if irq is on slave pic or master pic
         port = 0x21;    // select master pic command port
     } else {
@@ -75,6 +81,10 @@ void disable_irq(uint32_t irq_num) {
     uint16_t port;  // initialize variable to store port
     uint8_t value;  // initialize variable to store new mask
 
+    if (ioapic_active) {              // the 8259 stays masked once the io apic routes the irqs
+        ioapic_disable_irq(irq_num);
+        return;
+    }
     if (irq_num < 8) {  // if irq is on slave pic or master pic
         port = 0x21;    // select master pic command port
     } else {
@@ -98,6 +108,10 @@ void disable_irq(uint32_t irq_num) {
  */
 void send_eoi(uint32_t irq_num) {
     if (irq_num < 0 || irq_num > 16) return; //if argument is not valid, return
+    if (ioapic_active) {                               // io apic interrupts end at the local apic
+        apic_eoi();
+        return;
+    }
     if (irq_num >= 8) {                                // if irq is on slave or master pic
         outb((EOI | (irq_num - 8)), SLAVE_8259_PORT);  // send eoi to slave pic after correcting irqnum to irq0-7
         outb((EOI | 2), MASTER_8259_PORT);             // send eoi to irq2 on master pic
@@ -8,5 +8,11 @@ void rtc_handler_linkage();
 void keyboard_handler_linkage();
 void system_call_linkage();
 void pit_handler_linkage();
+void page_fault_linkage();
+void fpu_nm_linkage();
+void sysenter_linkage();
+void task_start_linkage();
+void apic_spurious_linkage();
+void ipi_handler_linkage();
 
 #endif 
@@ -0,0 +1,140 @@
+#include "ioapic.h"
+#include "i8259.h"
+#include "lib.h"
+
+// nonzero once the isa irqs come through the io apic, the 8259 then stays fully masked
+uint32_t ioapic_active = 0;
+
+static uint32_t ioapic_base = IOAPIC_DEFAULT_BASE;
+static uint32_t ioapic_dest;        // local apic id the device interrupts go to
+
+// io apic pin and redirection flags of each isa irq, the MP table overrides the identity mapping
+static uint8_t irq_pin[ISA_IRQS] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+static uint32_t irq_flags[ISA_IRQS];
+
+/* ioapic_read
+* INPUTS: reg - register index
+* OUTPUTS: none
+* RETURN: the register
+* DESCRIPTION: io apic registers are reached through the select and window pair
+*/
+static uint32_t ioapic_read(uint32_t reg){
+    *(volatile uint32_t*)(ioapic_base + IOAPIC_REGSEL) = reg;
+    return *(volatile uint32_t*)(ioapic_base + IOAPIC_WIN);
+}
+
+/* ioapic_write
+* INPUTS: reg - register index, val
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: io apic registers are reached through the select and window pair
+*/
+static void ioapic_write(uint32_t reg, uint32_t val){
+    *(volatile uint32_t*)(ioapic_base + IOAPIC_REGSEL) = reg;
+    *(volatile uint32_t*)(ioapic_base + IOAPIC_WIN) = val;
+}
+
+/* ioapic_set_base
+* INPUTS: addr - physical address from the MP table
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: records where the io apic is, it has to fall in the page mapped for the local apic
+*/
+void ioapic_set_base(uint32_t addr){
+    ioapic_base = addr;
+}
+
+/* ioapic_set_irq
+* INPUTS: irq - isa irq, pin - io apic input it is wired to, mp_flags - polarity and trigger of the
+*         MP interrupt entry
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: records an interrupt source override, the pit usually comes in on pin 2
+*/
+void ioapic_set_irq(uint32_t irq, uint32_t pin, uint32_t mp_flags){
+    uint32_t flags = 0;
+
+    if (irq >= ISA_IRQS){
+        return;
+    }
+    if ((mp_flags & MP_POLARITY_MASK) == MP_POLARITY_LOW){
+        flags |= IOAPIC_ACTIVE_LOW;
+    }
+    if (((mp_flags >> MP_TRIGGER_SHIFT) & MP_TRIGGER_MASK) == MP_TRIGGER_LEVEL){
+        flags |= IOAPIC_LEVEL;
+    }
+    irq_pin[irq] = pin;
+    irq_flags[irq] = flags;
+}
+
+/* ioapic_route
+* INPUTS: irq, masked
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: writes the redirection entry of an isa irq, fixed delivery to the boot cpu on the vector
+*              the 8259 used. The destination word goes first so the entry is never live half written
+*/
+static void ioapic_route(uint32_t irq, uint32_t masked){
+    uint32_t reg = IOAPIC_REDTBL + 2 * irq_pin[irq];
+
+    ioapic_write(reg, IOAPIC_MASKED);
+    ioapic_write(reg + 1, ioapic_dest << 24);
+    ioapic_write(reg, (ISA_VECTOR_BASE + irq) | irq_flags[irq] | (masked ? IOAPIC_MASKED : 0));
+}
+
+/* ioapic_init
+* INPUTS: dest_apic_id - local apic id of the cpu that takes the device interrupts
+* OUTPUTS: none
+* RETURN: 0 on success, -1 if the io apic is out of reach
+* DESCRIPTION: masks every pin, routes the isa irqs the 8259 had enabled, then masks the 8259 for good.
+*              enable_irq, disable_irq and send_eoi go through the apics from here on
+*/
+int32_t ioapic_init(uint32_t dest_apic_id){
+    uint32_t flags, pins, mask, i;
+
+    if ((ioapic_base >> 22) != (IOAPIC_DEFAULT_BASE >> 22)){
+        return -1;
+    }
+    cli_and_save(flags);
+    ioapic_dest = dest_apic_id;
+    pins = ((ioapic_read(IOAPIC_VER) >> 16) & 0xFF) + 1;
+    for (i = 0; i < pins; i++){
+        ioapic_write(IOAPIC_REDTBL + 2 * i, IOAPIC_MASKED);
+    }
+
+    mask = inb(MASTER_8259_PORT + 1) | (inb(SLAVE_8259_PORT + 1) << 8);
+    for (i = 0; i < ISA_IRQS; i++){
+        if (i != ISA_CASCADE_IRQ && irq_pin[i] < pins){     // the cascade's pin is usually the pit's
+            ioapic_route(i, mask & (1 << i));
+        }
+    }
+    outb(0xFF, MASTER_8259_PORT + 1);
+    outb(0xFF, SLAVE_8259_PORT + 1);
+    ioapic_active = 1;
+    restore_flags(flags);
+    return 0;
+}
+
+/* ioapic_enable_irq
+* INPUTS: irq
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: unmasks the pin of an isa irq
+*/
+void ioapic_enable_irq(uint32_t irq){
+    if (irq < ISA_IRQS && irq != ISA_CASCADE_IRQ){
+        ioapic_route(irq, 0);
+    }
+}
+
+/* ioapic_disable_irq
+* INPUTS: irq
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: masks the pin of an isa irq
+*/
+void ioapic_disable_irq(uint32_t irq){
+    if (irq < ISA_IRQS && irq != ISA_CASCADE_IRQ){
+        ioapic_route(irq, 1);
+    }
+}
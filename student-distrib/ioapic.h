@@ -0,0 +1,35 @@
+#if !defined(IOAPIC_H)
+#define IOAPIC_H
+
+#include "types.h"
+
+#define IOAPIC_DEFAULT_BASE 0xFEC00000     // inside the 4 MB page initialize_paging maps for the local apic
+#define IOAPIC_REGSEL 0x00
+#define IOAPIC_WIN 0x10
+#define IOAPIC_VER 0x01
+#define IOAPIC_REDTBL 0x10                 // two registers per pin, low word first
+
+#define IOAPIC_MASKED (1 << 16)
+#define IOAPIC_LEVEL (1 << 15)
+#define IOAPIC_ACTIVE_LOW (1 << 13)
+
+// polarity and trigger bits of an MP interrupt entry, 0 means what the bus does (edge, high for isa)
+#define MP_POLARITY_MASK 0x3
+#define MP_POLARITY_LOW 0x3
+#define MP_TRIGGER_SHIFT 2
+#define MP_TRIGGER_MASK 0x3
+#define MP_TRIGGER_LEVEL 0x3
+
+#define ISA_IRQS 16
+#define ISA_CASCADE_IRQ 2                  // the slave 8259, no device behind it
+#define ISA_VECTOR_BASE 0x20               // where i8259_init put them, the idt stays the same
+
+extern uint32_t ioapic_active;
+
+void ioapic_set_base(uint32_t addr);
+void ioapic_set_irq(uint32_t irq, uint32_t pin, uint32_t mp_flags);
+int32_t ioapic_init(uint32_t dest_apic_id);
+void ioapic_enable_irq(uint32_t irq);
+void ioapic_disable_irq(uint32_t irq);
+
+#endif
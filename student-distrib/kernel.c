@@ -13,6 +13,11 @@
 #include "filesystem.h"
 #include "keyboard.h"
 #include "rtc.h"
+#include "frame.h"
+#include "timer.h"
+#include "apic.h"
+#include "clock.h"
+#include "smp.h"
 
 #define RUN_TESTS
 
@@ -26,6 +31,9 @@ void entry(unsigned long magic, unsigned long addr) {
 
     multiboot_info_t *mbi;
 
+    /* Point %gs at the boot cpu's data, pcb_ptr and running_terminal live there. */
+    smp_boot_cpu();
+
     /* Clear the screen. */
     clear();
 
@@ -38,6 +46,13 @@ void entry(unsigned long magic, unsigned long addr) {
     /* Set MBI to the address of the Multiboot information structure. */
     mbi = (multiboot_info_t *) addr;
 
+    /* Build the physical frame allocator from the memory map while it is still reachable. */
+    frame_init(mbi);
+
+    /* Turn on the fpu and sse, then pick the memcpy/memset variants for this cpu. */
+    fpu_init();
+    mem_init();
+
     /* Print out the flags. */
     printf("flags = 0x%#x\n", (unsigned)mbi->flags);
 
@@ -61,6 +76,7 @@ void entry(unsigned long magic, unsigned long addr) {
         bootblock_init(mod->mod_start);         // calling function from filesystem.h to initialize bootblock structure
         
         while (mod_count < mbi->mods_count) {
+            frame_reserve(mod->mod_start, mod->mod_end);
             printf("Module %d loaded at address: 0x%#x\n", mod_count, (unsigned int)mod->mod_start);
             printf("Module %d ends at address: 0x%#x\n", mod_count, (unsigned int)mod->mod_end);
             printf("First few bytes of module:\n");
@@ -71,6 +87,7 @@ void entry(unsigned long magic, unsigned long addr) {
             mod_count++;
             mod++;
         }
+        dentry_index_report();
     }
     /* Bits 4 and 5 are mutually exclusive! */
     if (CHECK_FLAG(mbi->flags, 4) && CHECK_FLAG(mbi->flags, 5)) {
@@ -102,6 +119,7 @@ void entry(unsigned long magic, unsigned long addr) {
                     (unsigned)mmap->length_high,
                     (unsigned)mmap->length_low);
     }
+    printf("frame allocator: %u free 4KB frames\n", frames_free);
 
     /* Construct an LDT entry in the GDT */
     {
@@ -145,7 +163,7 @@ void entry(unsigned long magic, unsigned long addr) {
     }
 
     unsigned int i;
-    for (i = 0x00; i <= 0x2F; i++){
+    for (i = 0x00; i <= APIC_IPI_VECTOR; i++){
         idt[i].seg_selector = KERNEL_CS; // setting the segment selector, for the exceptions and interrupts to be Code Segment.
         idt[i].reserved4 = 0; // setting the reserved bits for the exceptions
         idt[i].reserved2 = 1;// setting the reserved bits for the exceptions
@@ -158,6 +176,8 @@ void entry(unsigned long magic, unsigned long addr) {
         else{idt[i].reserved3 = 0;}   // if the gate is an interrupt gate you set the reserved to b0
     }
     
+    idt[APIC_SPURIOUS_VECTOR] = idt[APIC_TIMER_VECTOR]; // another interrupt gate, for the local apic's spurious interrupts
+
     idt[0x80].seg_selector = KERNEL_CS;
     idt[0x80].reserved4 = 0; // setting the reserved bits for the system call
     idt[0x80].reserved2 = 1;  // setting the reserved bits for the system call
@@ -177,14 +197,15 @@ void entry(unsigned long magic, unsigned long addr) {
     SET_IDT_ENTRY(idt[4], exception4); // populate the IDT for the fifth exception, linking it to its respective handler
     SET_IDT_ENTRY(idt[5], exception5); // populate the IDT for the sixth exception, linking it to its respective handler
     SET_IDT_ENTRY(idt[6], exception6); // populate the IDT for the seventh exception, linking it to its respective handler
-    SET_IDT_ENTRY(idt[7], exception7); // populate the IDT for the eighth exception, linking it to its respective handler
+    SET_IDT_ENTRY(idt[7], fpu_nm_linkage); // device not available, cr0.ts set by the lazy fpu switch
     SET_IDT_ENTRY(idt[8], exception8); // populate the IDT for the ninth exception, linking it to its respective handler
     SET_IDT_ENTRY(idt[9], exception9); // populate the IDT for the tenth exception, linking it to its respective handler
     SET_IDT_ENTRY(idt[10], exception10); // populate the IDT for the eleventh exception, linking it to its respective handler
     SET_IDT_ENTRY(idt[11], exception11); // populate the IDT for the twelfth exception, linking it to its respective handler
     SET_IDT_ENTRY(idt[12], exception12); // populate the IDT for the thirteenth exception, linking it to its respective handler
     SET_IDT_ENTRY(idt[13], exception13); // populate the IDT for the fourteenth exception, linking it to its respective handler
-    SET_IDT_ENTRY(idt[14], exception14); // populate the IDT for the fifteenth exception, linking it to its respective handler
+    SET_IDT_ENTRY(idt[14], page_fault_linkage); // populate the IDT for the fifteenth exception, linking it to the demand paging handler
+    idt[14].reserved3 = 0; // interrupt gate, no tick may switch tasks and overwrite cr2 before the linkage reads it
     //SET_IDT_ENTRY(idt[15], exception15);
     SET_IDT_ENTRY(idt[16], exception16); // populate the IDT for the seventeenth exception, linking it to its respective handler
     SET_IDT_ENTRY(idt[17], exception17); // populate the IDT for the eighteenth exception, linking it to its respective handler
@@ -194,13 +215,18 @@ void entry(unsigned long magic, unsigned long addr) {
     SET_IDT_ENTRY(idt[0x20], pit_handler_linkage);
     SET_IDT_ENTRY(idt[0x21], keyboard_handler_linkage); // populate the IDT with the interrupt line/gate for the keyboard, linking to the keyboard handler
     SET_IDT_ENTRY(idt[0x28], rtc_handler_linkage); // populate the IDT with the interrupt line/gate for the rtc, linking to the rtc handler
+    SET_IDT_ENTRY(idt[APIC_TIMER_VECTOR], pit_handler_linkage); // the apic one shot takes over the pit's tick once tick_init goes tickless
+    SET_IDT_ENTRY(idt[APIC_IPI_VECTOR], ipi_handler_linkage); // wakes a halted cpu when there is work for it
+    SET_IDT_ENTRY(idt[APIC_SPURIOUS_VECTOR], apic_spurious_linkage);
 
     SET_IDT_ENTRY(idt[0x80], system_call_linkage); // populate the IDT with the system call (trap gate), linking to the system call handler
+    sysenter_init(); // user programs can also enter through sysenter, int $0x80 keeps working
 
     lidt(idt_desc_ptr); //load idtr with idt descriptor
 
     /* Init the PIC */
     i8259_init();
+    mp_init();      // before paging, which leaves the bios tables unmapped
 
     /* Initialize devices, memory, filesystem, enable device interrupts on the
      * PIC, any other initialization stuff... */
@@ -208,7 +234,12 @@ void entry(unsigned long magic, unsigned long addr) {
     rtc_init(); //initialize rtc
     keyboard_init(); //initialize keyboard
     terminal_init();
-    //pit_init();
+    pit_init();
+    pit_calibrate_tsc();
+    timer_init();
+    tick_init();        // after the calibration and the timers, the apic one shot needs both
+    clock_init();
+    smp_init();         // last, the other cpus copy the finished page directory
 
     /* Enable interrupts */
     /* Do not enable the following until after you have set up your
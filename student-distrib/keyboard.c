@@ -1,8 +1,34 @@
 #include "keyboard.h"
+#include "softirq.h"
 
 uint8_t flags[4];   // shift, ctrl, alt, capslock flags (key press=1, key release= 0)
 uint8_t boot_flag[2] = {0, 0};
 
+// scancodes the interrupt handler read and the bottom half has not handled yet, one producer and one consumer
+static uint8_t scancode_ring[SCANCODE_RING_SIZE];
+static volatile uint32_t scancode_head = 0;
+static volatile uint32_t scancode_tail = 0;
+uint32_t scancodes_dropped = 0;
+
+//array to store each ASCII character based on the scancode index (a 0 indicates no corresponding character to be printed)
+static const unsigned char ascii_code[58] = {0, 0, '1', '2', '3', '4', '5', '6', '7', '8', 
+                                  '9', '0', '-', '=', '\b', '\t', 'q', 'w', 'e', 'r',
+                                  't', 'y', 'u', 'i', 'o', 'p', '[', ']', '\n', 0,
+                                  'a', 's', 'd', 'f', 'g', 'h', 'j', 'k', 'l', ';',
+                                  '\'', '`', 0, '\\', 'z', 'x', 'c', 'v', 'b', 'n',
+                                  'm', ',', '.', '/', 0, 0, 0, ' '};
+
+//array to store each shifted ASCII character based on the scancode index (a 0 indicates no corresponding character to be printed)
+static const unsigned char ascii_code_shift[58] = {0, 0, '!', '@', '#', '$', '%', '^', '&', '*', 
+                                         '(', ')', '_', '+', '\b', '\t', 'Q', 'W', 'E', 'R',
+                                         'T', 'Y', 'U', 'I', 'O', 'P', '{', '}', '\n', 0,
+                                         'A', 'S', 'D', 'F', 'G', 'H', 'J', 'K', 'L', ':',
+                                         '\"', '~', 0, '|', 'Z', 'X', 'C', 'V', 'B', 'N',
+                                         'M', '<', '>', '?', 0, 0, 0, ' '};
+
+static void keyboard_softirq(void);
+static void keyboard_process(uint8_t scancode);
+
 /*
  * 	keyboard_init
  *   DESCRIPTION: Initializes the keyboard by unmasking the corresponding keyboard init line on the *master pic
@@ -13,8 +39,8 @@ uint8_t boot_flag[2] = {0, 0};
  */
 
 void keyboard_init(){
+    softirq_register(SOFTIRQ_KEYBOARD, keyboard_softirq);
     enable_irq(1); //enable interrupts from irq1 keyboard
-    line_buf_index = 0;
     //set all flags to 0
     unsigned int i;
     for (i = 0; i < 4; i++){
@@ -24,36 +50,64 @@ void keyboard_init(){
 
 /*
  * 	keyboard_handler
- *   DESCRIPTION: Execute the code in this handler whenever keyboard raises an interrupt.
+ *   DESCRIPTION: Top half, executed whenever keyboard raises an interrupt. Only queues the scancode
+ *                for keyboard_softirq, which echoes and switches terminals with interrupts on
  *   INPUTS: none
- *   OUTPUTS: Prints the characters obtained by mapping the scancodes, obtained from the keyboard *data port
+ *   OUTPUTS: none
  *   RETURN VALUE: none
- *   SIDE EFFECTS: clears and sets the interrupt flag, while executing the code inside the handler
+ *   SIDE EFFECTS: the scancode is dropped if the bottom half is SCANCODE_RING_SIZE behind
  */ 
 
 void keyboard_handler(){
-    unsigned char returnChar;      // stores character to print
+    uint64_t start = rdtsc();
     uint8_t scancode;              // stores scancode received from keyboard
 
-    //array to store each ASCII character based on the scancode index (a 0 indicates no corresponding character to be printed)
-    unsigned char ascii_code[58] = {0, 0, '1', '2', '3', '4', '5', '6', '7', '8', 
-                                  '9', '0', '-', '=', '\b', '\t', 'q', 'w', 'e', 'r',
-                                  't', 'y', 'u', 'i', 'o', 'p', '[', ']', '\n', 0,
-                                  'a', 's', 'd', 'f', 'g', 'h', 'j', 'k', 'l', ';',
-                                  '\'', '`', 0, '\\', 'z', 'x', 'c', 'v', 'b', 'n',
-                                  'm', ',', '.', '/', 0, 0, 0, ' '};
-
-    //array to store each shifted ASCII character based on the scancode index (a 0 indicates no corresponding character to be printed)
-    unsigned char ascii_code_shift[58] = {0, 0, '!', '@', '#', '$', '%', '^', '&', '*', 
-                                         '(', ')', '_', '+', '\b', '\t', 'Q', 'W', 'E', 'R',
-                                         'T', 'Y', 'U', 'I', 'O', 'P', '{', '}', '\n', 0,
-                                         'A', 'S', 'D', 'F', 'G', 'H', 'J', 'K', 'L', ':',
-                                         '\"', '~', 0, '|', 'Z', 'X', 'C', 'V', 'B', 'N',
-                                         'M', '<', '>', '?', 0, 0, 0, ' '};
-
     cli();                         // start critical section
     scancode = inb(0x60);          // get scan code from data port on keyboard
 
+    if (scancode_head - scancode_tail < SCANCODE_RING_SIZE){
+        scancode_ring[scancode_head & (SCANCODE_RING_SIZE - 1)] = scancode;
+        barrier();
+        scancode_head++;
+    }
+    else{
+        scancodes_dropped++;
+    }
+    softirq_raise(SOFTIRQ_KEYBOARD);
+
+    send_eoi(1);  // end or interrupt for irq1 keyboard
+    softirq_top_time(SOFTIRQ_KEYBOARD, start);
+    sti();        // end critical section
+}
+
+/* keyboard_softirq
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: bottom half, handles every queued scancode
+*/
+static void keyboard_softirq(void){
+    uint8_t scancode;
+
+    while (scancode_tail != scancode_head){
+        scancode = scancode_ring[scancode_tail & (SCANCODE_RING_SIZE - 1)];
+        barrier();
+        scancode_tail++;
+        keyboard_process(scancode);
+    }
+}
+
+/*
+ * 	keyboard_process
+ *   DESCRIPTION: Acts on one scancode, runs in the bottom half with interrupts on
+ *   INPUTS: scancode
+ *   OUTPUTS: Prints the characters obtained by mapping the scancodes
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: updates the modifier flags and the input ring of the visible terminal
+ */
+static void keyboard_process(uint8_t scancode){
+    unsigned char returnChar;      // stores character to print
+
     //right or left shift pressed
     if (scancode == 0x2A || scancode == 0x36){
         flags[0] = 1;
@@ -91,7 +145,17 @@ void keyboard_handler(){
 
     //if ctrl-l pressed, clear the screen
     else if (flags[1] == 1 && (scancode == 38)){
-        clear();
+        terminal_clear();
+    }
+
+    // shift + page up, look back through the scrollback
+    else if (flags[0] == 1 && (scancode == 0x49)){
+        video_scroll_view(terminal_id, SCROLLBACK_STEP);
+    }
+
+    // shift + page down
+    else if (flags[0] == 1 && (scancode == 0x51)){
+        video_scroll_view(terminal_id, -SCROLLBACK_STEP);
     }
 
     // alt + F1
@@ -112,18 +176,16 @@ void keyboard_handler(){
     //backspace character
     else if (scancode == 14){
         //check to not backspace previous terminal entry
-        if (line_buf_index > 0){
-            putc(ascii_code[14]);
-            (line_buf_index)--;   //decrement index since, removing a character
+        if (terminal_input_erase(terminal_id)){
+            terminal_echo(ascii_code[14]);
         }
     }
 
     //enter character
     else if (scancode == 28){
-        //check since max number of characters to be typed is 128 (128 since last character should be enter)
-        if (line_buf_index < 128){
-            putc(ascii_code[28]);
-            line_buffer[line_buf_index] = ascii_code[28]; 
+        //hands the line to the terminal's reader, which wakes up even if its terminal is not the one shown
+        if (terminal_input_put(terminal_id, ascii_code[28])){
+            terminal_echo(ascii_code[28]);
         }
     }
 
@@ -137,24 +199,21 @@ void keyboard_handler(){
         else{
             returnChar = ascii_code[scancode];
         }
-        //add character to the line buffer if line buffer max not reached (127 since want the last character to be enter)
-        if (line_buf_index < 127){
-            putc(returnChar);
-            line_buffer[line_buf_index] = returnChar;
-            (line_buf_index)++;
+        //add character to the line if the line max not reached (127 since want the last character to be enter)
+        if (terminal_input_put(terminal_id, returnChar)){
+            terminal_echo(returnChar);
         }
     }
     
     //tab character
     else if (scancode == 15){
-        // check if index < 124 since tab is 4 spaces (128-4=124)
-        if ((line_buf_index) < 124){
-            putc(ascii_code[15]);
+        // check there is room for the 4 spaces a tab becomes
+        if (terminal_input_room(terminal_id) >= 4){
+            terminal_echo(ascii_code[15]);
             unsigned int j;
             // add a space 4 times
             for (j = 0; j < 4; j++){
-                line_buffer[line_buf_index] = ' ';
-                (line_buf_index)++;
+                terminal_input_put(terminal_id, ' ');
             }    
         }
     }
@@ -169,14 +228,9 @@ void keyboard_handler(){
             returnChar = ascii_code[scancode];  
             }
 
-        //add character to the line buffer if line buffer max not reached (127 since want the last character to be enter)
-        if (line_buf_index < 127){
-            putc(returnChar);
-            line_buffer[line_buf_index] = returnChar;
-            (line_buf_index)++;
+        //add character to the line if the line max not reached (127 since want the last character to be enter)
+        if (terminal_input_put(terminal_id, returnChar)){
+            terminal_echo(returnChar);
         }
     }
-        
-    send_eoi(1);  // end or interrupt for irq1 keyboard
-    sti();        // end critical section
 }
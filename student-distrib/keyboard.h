@@ -5,11 +5,11 @@
 #include "i8259.h"
 #include "terminal.h"
 
+#define SCANCODE_RING_SIZE 64       // scancodes queued for the bottom half, a power of two
+
 extern void keyboard_init();
 extern void keyboard_handler();
-
-unsigned char line_buffer[128]; //keyboard buffer to keep track of typed characters
-unsigned int line_buf_index; //index to keep track of number of characters typed
+extern uint32_t scancodes_dropped;
 
 
 #endif
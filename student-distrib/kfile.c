@@ -0,0 +1,35 @@
+#include "kfile.h"
+#include "trace.h"
+#include "sysstat.h"
+#include "softirq.h"
+#include "scheduler.h"
+#include "spinlock.h"
+
+kfile_t kfile_table[] = {
+    {"trace", {trace_open, trace_read, trace_write, trace_close}},
+    {"sysstat", {sysstat_open, sysstat_read, sysstat_write, sysstat_close}},
+    {"softirq", {softirq_open, softirq_read, softirq_write, softirq_close}},
+    {"ticks", {tick_open, tick_read, NULL, tick_close}},
+    {"locks", {lock_open, lock_read, lock_write, lock_close}},
+    {NULL, {NULL, NULL, NULL, NULL}}
+};
+
+/* kfile_lookup
+* INPUTS: fname, dentry
+* OUTPUTS: dentry filled with FILETYPE_KFILE and the table index as inode
+* RETURN: 0 if fname is a kernel file, -1 otherwise
+* DESCRIPTION: lets open treat kernel files like entries of the file system image
+*/
+int32_t kfile_lookup(const uint8_t* fname, dentry_t* dentry){
+    uint32_t i;
+    uint32_t len = strlen((int8_t*)fname);
+
+    for (i = 0; kfile_table[i].name != NULL; i++){
+        if (len == strlen(kfile_table[i].name) && strncmp((int8_t*)fname, kfile_table[i].name, len) == 0){
+            dentry->filetype = FILETYPE_KFILE;
+            dentry->inode = i;
+            return 0;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,21 @@
+#if !defined(KFILE_H)
+#define KFILE_H
+
+#include "types.h"
+#include "system_calls.h"
+#include "filesystem.h"
+
+#define FILETYPE_KFILE 3        // dentry type open gives files the kernel provides itself
+
+// a file that lives in the kernel instead of the file system image
+typedef struct kfile_struct
+{
+    const int8_t* name;
+    helper_t ops;
+} kfile_t;
+
+extern kfile_t kfile_table[];
+
+int32_t kfile_lookup(const uint8_t* fname, dentry_t* dentry);
+
+#endif
@@ -2,6 +2,8 @@
  * vim:ts=4 noexpandtab */
 
 #include "lib.h"
+#include "fpu.h"
+#include "spinlock.h"
 
 
 #define NUM_COLS    80
@@ -12,26 +14,224 @@ static int screen_x;
 static int screen_y;
 static char* video_mem = (char *)VIDEO;
 
+// terminal buffers, the crtc and video memory. printf runs in any context, so interrupts go off with it
+static spinlock_t video_lock = SPINLOCK_INIT("video   ");
+
+// true when some byte of the word is zero, lets strlen and strncmp look at four characters at once
+#define HAS_ZERO_BYTE(w) (((w) - 0x01010101) & ~(w) & 0x80808080)
+
+// memory routine variants, picked once by mem_init. The scalar ones are safe before it runs
+uint32_t mem_features = 0;
+static void* (*memcpy_fn)(void* dest, const void* src, uint32_t n) = memcpy_movsl;
+static void* (*memcpy_video_fn)(void* dest, const void* src, uint32_t n) = memcpy_movsl;
+static void* (*memset_fn)(void* s, int32_t c, uint32_t n) = memset_stosl;
+
+/* mark_dirty
+* INPUTS: term, start, end
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: grows the terminal's dirty span to cover the byte offsets [start, end) of its buffer
+*/
+static void mark_dirty(uint32_t term, uint32_t start, uint32_t end){
+    if (start < terminal_arr[term].dirty_start){
+        terminal_arr[term].dirty_start = start;
+    }
+    if (end > TERM_BUF_BYTES){
+        end = TERM_BUF_BYTES;
+    }
+    if (end > terminal_arr[term].dirty_end){
+        terminal_arr[term].dirty_end = end;
+    }
+}
+
+/* set_start_address
+* INPUTS: cell - first character cell the crtc displays
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: programs the crtc start address, scrolling the screen without touching video memory
+*/
+static void set_start_address(uint16_t cell){
+    static uint16_t shown = 0;
+
+    if (cell == shown){
+        return;
+    }
+    shown = cell;
+    outb(0x0C, 0x3D4);
+    outb((uint8_t) ((cell >> 8) & 0xFF), 0x3D5);
+    outb(0x0D, 0x3D4);
+    outb((uint8_t) (cell & 0xFF), 0x3D5);
+}
+
+/* video_flush_locked
+* INPUTS: term
+* OUTPUTS: the dirty part of the terminal's buffer on screen
+* RETURN: none
+* DESCRIPTION: the terminal buffers are the only copy of the text, video memory mirrors the visible
+*              one at the same offsets. Copies the span written since the last flush and points the
+*              crtc at the viewed lines if term is on screen, else keeps it dirty until it is shown.
+*              video_lock must be held
+*/
+static void video_flush_locked(uint32_t term){
+    uint32_t start, end;
+
+    start = terminal_arr[term].dirty_start;
+    end = terminal_arr[term].dirty_end;
+    if (term == terminal_id){
+        if (start < end){
+            memcpy_video((uint8_t*)(VIDEO + start), (uint8_t*)(terminal_arr[term].vmem_location + start), end - start);
+            terminal_arr[term].dirty_start = TERM_BUF_BYTES;
+            terminal_arr[term].dirty_end = 0;
+        }
+        set_start_address((terminal_arr[term].top_line - terminal_arr[term].view_back) * NUM_COLS);
+    }
+}
+
+/* video_flush
+* INPUTS: term
+* OUTPUTS: the dirty part of the terminal's buffer on screen
+* RETURN: none
+* DESCRIPTION: video_flush_locked under video_lock
+*/
+void video_flush(uint32_t term){
+    uint32_t flags;
+
+    spin_lock_irqsave(&video_lock, flags);
+    video_flush_locked(term);
+    spin_unlock_irqrestore(&video_lock, flags);
+}
+
+/* video_show
+* INPUTS: term
+* OUTPUTS: the terminal's screen and scrollback in video memory
+* RETURN: none
+* DESCRIPTION: copies every line in use, for a terminal that just became visible
+*/
+void video_show(uint32_t term){
+    uint32_t flags;
+
+    spin_lock_irqsave(&video_lock, flags);
+    mark_dirty(term, 0, (terminal_arr[term].top_line + NUM_ROWS) * LINE_BYTES);
+    video_flush_locked(term);
+    spin_unlock_irqrestore(&video_lock, flags);
+}
+
+/* video_reset
+* INPUTS: term
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: blanks the terminal's buffer and drops its scrollback
+*/
+void video_reset(uint32_t term){
+    uint32_t flags;
+
+    spin_lock_irqsave(&video_lock, flags);
+    memset_word((void*)terminal_arr[term].vmem_location, (ATTRIB << 8) | ' ', TERM_LINES * NUM_COLS);
+    terminal_arr[term].top_line = 0;
+    terminal_arr[term].view_back = 0;
+    terminal_arr[term].dirty_start = TERM_BUF_BYTES;
+    terminal_arr[term].dirty_end = 0;
+    spin_unlock_irqrestore(&video_lock, flags);
+}
+
+/* video_sync_vidmap
+* INPUTS: term
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: copies what a vidmap program drew onto the terminal's screen
+*/
+void video_sync_vidmap(uint32_t term){
+    uint32_t flags, offset;
+
+    spin_lock_irqsave(&video_lock, flags);
+    offset = terminal_arr[term].top_line * LINE_BYTES;
+    memcpy((uint8_t*)(terminal_arr[term].vmem_location + offset), (uint8_t*)terminal_arr[term].vidmap_location, SCREEN_BYTES);
+    mark_dirty(term, offset, offset + SCREEN_BYTES);
+    spin_unlock_irqrestore(&video_lock, flags);
+}
+
+/* video_scroll_view
+* INPUTS: term, lines - positive to look further back, negative to come forward
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: moves the view through the scrollback, only the crtc start address changes
+*/
+void video_scroll_view(uint32_t term, int32_t lines){
+    uint32_t flags;
+    int32_t back;
+
+    spin_lock_irqsave(&video_lock, flags);
+    back = terminal_arr[term].view_back + lines;
+    if (back < 0){
+        back = 0;
+    }
+    if (back > terminal_arr[term].top_line){
+        back = terminal_arr[term].top_line;
+    }
+    terminal_arr[term].view_back = back;
+    video_flush_locked(term);
+    spin_unlock_irqrestore(&video_lock, flags);
+}
+
+/* screen_addr
+* INPUTS: term
+* OUTPUTS: none
+* RETURN: address of the terminal's top screen line in its buffer
+* DESCRIPTION: helper for putc
+*/
+static uint32_t screen_addr(uint32_t term){
+    return terminal_arr[term].vmem_location + terminal_arr[term].top_line * LINE_BYTES;
+}
+
+/* scroll_up
+* INPUTS: term
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: moves the screen one line down the buffer and blanks the new bottom line. When the
+*              buffer is full the newest SCROLLBACK_KEEP lines of history and the screen are moved
+*              back to the start, so a line costs a constant amount of copying on average
+*/
+static void scroll_up(uint32_t term){
+    terminal_t* t = &terminal_arr[term];
+    uint8_t* buf = (uint8_t*)t->vmem_location;
+    uint32_t shift, bottom;
+
+    if (t->top_line + NUM_ROWS == TERM_LINES){
+        shift = t->top_line + 1 - SCROLLBACK_KEEP;
+        memmove(buf, buf + shift * LINE_BYTES, (TERM_LINES - shift) * LINE_BYTES);
+        t->top_line -= shift;
+        mark_dirty(term, 0, (t->top_line + NUM_ROWS) * LINE_BYTES);
+    }
+    t->top_line++;
+    if (t->view_back > t->top_line){
+        t->view_back = t->top_line;
+    }
+
+    bottom = (t->top_line + NUM_ROWS - 1) * LINE_BYTES;
+    memset_word(buf + bottom, (ATTRIB << 8) | ' ', NUM_COLS);
+    mark_dirty(term, bottom, bottom + LINE_BYTES);
+}
+
 /* void clear(void);
  * Inputs: void
  * Return Value: none
- * Function: Clears video memory */
+ * Function: Clears the screen, the scrollback stays */
 void clear(void) {
-    uint32_t curr_vmem = terminal_arr[running_terminal].vmem_location;
-    int32_t i;
-    for (i = 0; i < NUM_ROWS * NUM_COLS; i++) {
-        *(uint8_t *)(curr_vmem + (i << 1)) = ' ';
-        *(uint8_t *)(curr_vmem + (i << 1) + 1) = ATTRIB;
-    }
+    uint32_t flags, offset;
+
+    spin_lock_irqsave(&video_lock, flags);
+    offset = terminal_arr[running_terminal].top_line * LINE_BYTES;
+    memset_word((void*)(terminal_arr[running_terminal].vmem_location + offset), (ATTRIB << 8) | ' ', NUM_ROWS * NUM_COLS);
     //set cursor to top left
     screen_x = 0;
     screen_y = 0;
     terminal_arr[running_terminal].cursor_xpos = 0;  
     terminal_arr[running_terminal].cursor_ypos = 0;
+    terminal_arr[running_terminal].view_back = 0;
     change_cursor(screen_x, screen_y);
-    if (running_terminal == terminal_id){
-        memcpy((uint8_t*)(VIDEO), (uint8_t*)(curr_vmem), FOUR_KB);
-    }
+    mark_dirty(running_terminal, offset, offset + SCREEN_BYTES);
+    video_flush_locked(running_terminal);
+    spin_unlock_irqrestore(&video_lock, flags);
 }
 
 /* Standard printf().
@@ -157,6 +357,7 @@ format_char_switch:
         }
         buf++;
     }
+    video_flush(running_terminal);
     return (buf - format);
 }
 
@@ -170,19 +371,22 @@ int32_t puts(int8_t* s) {
         putc(s[index]);
         index++;
     }
+    video_flush(running_terminal);
     return index;
 }
 
-/* void putc(uint8_t c);
+/* void putc_locked(uint8_t c);
  * Inputs: uint_8* c = character to print
  * Return Value: void
- *  Function: Output a character to the console */
-void putc(uint8_t c) {
+ *  Function: Output a character to the console, video_lock must be held */
+static void putc_locked(uint8_t c) {
     // tab character
 
-    uint32_t curr_vmem = terminal_arr[running_terminal].vmem_location;
+    uint32_t curr_vmem = screen_addr(running_terminal);
     uint8_t curr_x = terminal_arr[running_terminal].cursor_xpos;
     uint8_t curr_y = terminal_arr[running_terminal].cursor_ypos;
+    uint32_t start = curr_vmem + ((NUM_COLS * curr_y + curr_x) << 1);        // cells between the old and new cursor get written
+    uint32_t end;
 
     if(c == '\t'){
         unsigned int i;
@@ -196,17 +400,8 @@ void putc(uint8_t c) {
             if (curr_x == NUM_COLS){
                 //check if last row (if so scroll)
                 if (curr_y == (NUM_ROWS-1)){
-                    unsigned int row, col;
-                    //copy each row to the previous row
-                    for (row=0; row < NUM_ROWS - 1; row++){
-                        for (col=0; col < NUM_COLS; col++){
-                            *(uint8_t *)(curr_vmem + ((NUM_COLS * row + col) << 1)) = *(uint8_t *)(curr_vmem + ((NUM_COLS * (row+1) + col) << 1));
-                        }
-                    }
-                    //set last row to spaces
-                    for (col = 0; col < NUM_COLS; col++){
-                        *(uint8_t *)(curr_vmem + ((NUM_COLS * row + col) << 1)) = ' ';
-                    }
+                    scroll_up(running_terminal);
+                    curr_vmem = screen_addr(running_terminal);
                     //set cursor to first column, last row
                     curr_y = NUM_ROWS-1;
                     curr_x = 0;
@@ -223,7 +418,7 @@ void putc(uint8_t c) {
     }
 
     else if (c == '\b'){
-        if (curr_x == 0){
+        if (curr_x == 0 && curr_y > 0){
             curr_y--;
             curr_x = NUM_COLS-1;
             *(uint8_t *)(curr_vmem + ((NUM_COLS * curr_y + curr_x) << 1)) = ' ';
@@ -231,7 +426,7 @@ void putc(uint8_t c) {
             // screen_y--;
             // screen_x = 79;
         }
-        else{
+        else if (curr_x > 0){
             curr_x--;
             *(uint8_t *)(curr_vmem + ((NUM_COLS * curr_y + curr_x) << 1)) = ' ';
             *(uint8_t *)(curr_vmem + ((NUM_COLS * curr_y + curr_x) << 1) + 1) = ATTRIB;
@@ -245,17 +440,7 @@ void putc(uint8_t c) {
     else if(c == '\n' || c == '\r') {
         //check if last row (24) (if so scroll)
         if (curr_y == (NUM_ROWS-1)){
-            unsigned int row, col;
-            //copy each row to the previous row
-            for (row=0; row<NUM_ROWS-1; row++){
-                for (col=0; col <NUM_COLS; col++){
-                *(uint8_t *)(curr_vmem + ((NUM_COLS * row + col) << 1)) = *(uint8_t *)(curr_vmem + ((NUM_COLS * (row+1) + col) << 1));
-                }
-            }
-            //set last row to spaces
-            for (col = 0; col < NUM_COLS; col++){
-                *(uint8_t *)(curr_vmem + ((NUM_COLS * row + col) << 1)) = ' ';
-            }
+            scroll_up(running_terminal);
             //set cursor to first column, last row (24)
             curr_y = (NUM_ROWS-1);
             curr_x = 0;
@@ -276,17 +461,7 @@ void putc(uint8_t c) {
         if (curr_x == NUM_COLS){
             //check if last row (24) (if so scroll)
             if (curr_y == NUM_ROWS-1){
-                unsigned int row, col;
-                //copy each row to the previous row
-                for (row=0; row<NUM_ROWS-1; row++){
-                    for (col=0; col <NUM_COLS; col++){
-                        *(uint8_t *)(curr_vmem + ((NUM_COLS * row + col) << 1)) = *(uint8_t *)(curr_vmem + ((NUM_COLS * (row+1) + col) << 1));
-                    }
-                }
-                //set last row to spaces
-                for (col = 0; col < NUM_COLS; col++){
-                    *(uint8_t *)(curr_vmem + ((NUM_COLS * row + col) << 1)) = ' ';
-                }
+                scroll_up(running_terminal);
                 //set cursor to first column, last row (24)
                 curr_y = (NUM_ROWS-1);
                 curr_x = 0;
@@ -304,11 +479,29 @@ void putc(uint8_t c) {
 
     change_cursor(curr_x, curr_y);
 
-    if (running_terminal == terminal_id){
-        memcpy((uint8_t*)(VIDEO), (uint8_t*)(curr_vmem), FOUR_KB);
+    // scrolling keeps buffer offsets, only a compaction moves lines and it marks them all itself
+    start -= terminal_arr[running_terminal].vmem_location;
+    end = screen_addr(running_terminal) - terminal_arr[running_terminal].vmem_location + ((NUM_COLS * curr_y + curr_x) << 1);
+    if (end < start){        // backspace
+        mark_dirty(running_terminal, end, start + 2);
+    }
+    else{
+        mark_dirty(running_terminal, start, end + 2);
     }
 }
 
+/* void putc(uint8_t c);
+ * Inputs: uint_8* c = character to print
+ * Return Value: void
+ *  Function: Output a character to the console */
+void putc(uint8_t c) {
+    uint32_t flags;
+
+    spin_lock_irqsave(&video_lock, flags);
+    putc_locked(c);
+    spin_unlock_irqrestore(&video_lock, flags);
+}
+
 /* int8_t* itoa(uint32_t value, int8_t* buf, int32_t radix);
  * Inputs: uint32_t value = number to convert
  *            int8_t* buf = allocated buffer to place string in
@@ -347,6 +540,66 @@ int8_t* itoa(uint32_t value, int8_t* buf, int32_t radix) {
     return strrev(buf);
 }
 
+/* void put_dec(uint8_t* line, uint32_t value, uint32_t width);
+ * Inputs: uint8_t* line = where the number goes
+ *         uint32_t value = number to write
+ *         uint32_t width = characters it takes, wide enough for value
+ * Return Value: none
+ * Function: Writes value in decimal right aligned in width characters, no terminator,
+ *           for the fixed width lines of the kernel text files */
+void put_dec(uint8_t* line, uint32_t value, uint32_t width) {
+    int8_t digits[11];
+    uint32_t len, i;
+
+    itoa(value, digits, 10);
+    len = strlen(digits);
+    for (i = 0; i < width; i++) {
+        line[i] = (i < width - len) ? ' ' : digits[i - (width - len)];
+    }
+}
+
+/* uint32_t put_stat_line(uint8_t* line, const int8_t* name, const uint32_t* values, const uint8_t* widths, uint32_t count);
+ * Inputs: uint8_t* line = where the line goes
+ *         const int8_t* name = 8 characters, padded
+ *         const uint32_t* values = numbers after the name
+ *         const uint8_t* widths = characters each number takes
+ *         uint32_t count = number of values
+ * Return Value: length of the line
+ * Function: Writes one line of the kernel statistics files, the name then every value right aligned
+ *           in its width, all separated by spaces and ended by a newline, no terminator */
+uint32_t put_stat_line(uint8_t* line, const int8_t* name, const uint32_t* values, const uint8_t* widths, uint32_t count) {
+    uint32_t pos = 8;
+    uint32_t i;
+
+    memcpy(line, (void*)name, 8);
+    for (i = 0; i < count; i++) {
+        line[pos++] = ' ';
+        put_dec(line + pos, values[i], widths[i]);
+        pos += widths[i];
+    }
+    line[pos++] = '\n';
+    return pos;
+}
+
+/* uint32_t cycles_since(uint64_t start);
+ * Inputs: uint64_t start = rdtsc value
+ * Return Value: cycles since start, saturated to 32 bits
+ * Function: helper for the kernel statistics */
+uint32_t cycles_since(uint64_t start) {
+    uint64_t cycles = rdtsc() - start;
+    return (cycles >> 32) ? 0xFFFFFFFF : (uint32_t)cycles;
+}
+
+/* uint32_t cycles_to_ns(uint32_t cycles);
+ * Inputs: uint32_t cycles = tsc cycles
+ * Return Value: cycles in nanoseconds at the rate pit_calibrate_tsc measured
+ * Function: split so nothing overflows or needs a 64 bit division */
+uint32_t cycles_to_ns(uint32_t cycles) {
+    uint32_t mhz = (tsc_khz >= 1000) ? tsc_khz / 1000 : 1;
+
+    return (cycles / mhz) * 1000 + (cycles % mhz) * 1000 / mhz;
+}
+
 /* int8_t* strrev(int8_t* s);
  * Inputs: int8_t* s = string to reverse
  * Return Value: reversed string
@@ -371,10 +624,43 @@ int8_t* strrev(int8_t* s) {
  * Return Value: length of string s
  * Function: return length of string s */
 uint32_t strlen(const int8_t* s) {
-    register uint32_t len = 0;
-    while (s[len] != '\0')
-        len++;
-    return len;
+    const int8_t* p = s;
+    const uint32_t* w;
+
+    while ((uint32_t)p & 0x3) {
+        if (*p == '\0')
+            return p - s;
+        p++;
+    }
+    /* An aligned word never crosses a page, so reading the bytes after
+     * the terminator cannot fault. */
+    for (w = (const uint32_t*)p; !HAS_ZERO_BYTE(*w); w++);
+    for (p = (const int8_t*)w; *p != '\0'; p++);
+    return p - s;
+}
+
+/* void mem_init(void);
+ * Inputs: none
+ * Return Value: none
+ * Function: picks the memcpy and memset variants from cpuid, once at boot.
+ *           fpu_init has already turned sse on */
+void mem_init(void) {
+    uint32_t max_leaf, eax, ebx, ecx, edx;
+
+    cpuid(0, &max_leaf, &ebx, &ecx, &edx);
+    cpuid(1, &eax, &ebx, &ecx, &edx);
+    if (edx & CPUID_SSE2) {
+        mem_features |= MEM_SSE2;
+        memcpy_video_fn = memcpy_nt;
+    }
+    if (max_leaf >= 7) {
+        cpuid(7, &eax, &ebx, &ecx, &edx);
+        if (ebx & CPUID_ERMS) {
+            mem_features |= MEM_ERMS;
+            memcpy_fn = memcpy_erms;
+            memset_fn = memset_erms;
+        }
+    }
 }
 
 /* void* memset(void* s, int32_t c, uint32_t n);
@@ -382,8 +668,19 @@ uint32_t strlen(const int8_t* s) {
  *          int32_t c = value to set memory to
  *         uint32_t n = number of bytes to set
  * Return Value: new string
- * Function: set n consecutive bytes of pointer s to value c */
+ * Function: set n consecutive bytes of pointer s to value c, using the
+ *           variant mem_init picked */
 void* memset(void* s, int32_t c, uint32_t n) {
+    return memset_fn(s, c, n);
+}
+
+/* void* memset_stosl(void* s, int32_t c, uint32_t n);
+ * Inputs:    void* s = pointer to memory
+ *          int32_t c = value to set memory to
+ *         uint32_t n = number of bytes to set
+ * Return Value: new string
+ * Function: memset with rep stosl and byte sized head and tail */
+void* memset_stosl(void* s, int32_t c, uint32_t n) {
     c &= 0xFF;
     asm volatile ("                 \n\
             .memset_top:            \n\
@@ -419,6 +716,27 @@ void* memset(void* s, int32_t c, uint32_t n) {
     return s;
 }
 
+/* void* memset_erms(void* s, int32_t c, uint32_t n);
+ * Inputs:    void* s = pointer to memory
+ *          int32_t c = value to set memory to
+ *         uint32_t n = number of bytes to set
+ * Return Value: new string
+ * Function: memset with a single rep stosb, which cpus with enhanced
+ *           rep movsb/stosb run in cache line sized chunks */
+void* memset_erms(void* s, int32_t c, uint32_t n) {
+    asm volatile ("                 \n\
+            movw    %%ds, %%dx      \n\
+            movw    %%dx, %%es      \n\
+            cld                     \n\
+            rep     stosb           \n\
+            "
+            :
+            : "a"(c), "D"(s), "c"(n)
+            : "edx", "memory", "cc"
+    );
+    return s;
+}
+
 /* void* memset_word(void* s, int32_t c, uint32_t n);
  * Description: Optimized memset_word
  * Inputs:    void* s = pointer to memory
@@ -465,8 +783,29 @@ void* memset_dword(void* s, int32_t c, uint32_t n) {
  *         const void* src = source of copy
  *              uint32_t n = number of byets to copy
  * Return Value: pointer to dest
- * Function: copy n bytes of src to dest */
+ * Function: copy n bytes of src to dest, using the variant mem_init picked */
 void* memcpy(void* dest, const void* src, uint32_t n) {
+    return memcpy_fn(dest, src, n);
+}
+
+/* void* memcpy_video(void* dest, const void* src, uint32_t n);
+ * Inputs:      void* dest = destination of copy, usually video memory
+ *         const void* src = source of copy
+ *              uint32_t n = number of byets to copy
+ * Return Value: pointer to dest
+ * Function: memcpy for data that will not be read back soon, streams
+ *           past the cache when the cpu has sse2 */
+void* memcpy_video(void* dest, const void* src, uint32_t n) {
+    return memcpy_video_fn(dest, src, n);
+}
+
+/* void* memcpy_movsl(void* dest, const void* src, uint32_t n);
+ * Inputs:      void* dest = destination of copy
+ *         const void* src = source of copy
+ *              uint32_t n = number of byets to copy
+ * Return Value: pointer to dest
+ * Function: memcpy with rep movsl and byte sized head and tail */
+void* memcpy_movsl(void* dest, const void* src, uint32_t n) {
     asm volatile ("                 \n\
             .memcpy_top:            \n\
             testl   %%ecx, %%ecx    \n\
@@ -505,6 +844,76 @@ void* memcpy(void* dest, const void* src, uint32_t n) {
     return dest;
 }
 
+/* void* memcpy_erms(void* dest, const void* src, uint32_t n);
+ * Inputs:      void* dest = destination of copy
+ *         const void* src = source of copy
+ *              uint32_t n = number of byets to copy
+ * Return Value: pointer to dest
+ * Function: memcpy with a single rep movsb, which cpus with enhanced
+ *           rep movsb/stosb run in cache line sized chunks */
+void* memcpy_erms(void* dest, const void* src, uint32_t n) {
+    asm volatile ("                 \n\
+            movw    %%ds, %%dx      \n\
+            movw    %%dx, %%es      \n\
+            cld                     \n\
+            rep     movsb           \n\
+            "
+            :
+            : "S"(src), "D"(dest), "c"(n)
+            : "edx", "memory", "cc"
+    );
+    return dest;
+}
+
+/* void* memcpy_nt(void* dest, const void* src, uint32_t n);
+ * Inputs:      void* dest = destination of copy
+ *         const void* src = source of copy
+ *              uint32_t n = number of byets to copy
+ * Return Value: pointer to dest
+ * Function: sse2 copy with non-temporal stores, 64 bytes a round. The
+ *           unaligned head and the tail go through memcpy. The xmm
+ *           registers are borrowed with kernel_fpu_begin, and not listed
+ *           as clobbered since the kernel is built without sse */
+void* memcpy_nt(void* dest, const void* src, uint32_t n) {
+    uint8_t* d = (uint8_t*)dest;
+    const uint8_t* s = (const uint8_t*)src;
+    uint32_t head, blocks, flags;
+
+    if (n < NT_COPY_MIN)
+        return memcpy_fn(dest, src, n);
+
+    head = -(uint32_t)d & 0xF;
+    memcpy_fn(d, s, head);
+    d += head;
+    s += head;
+    n -= head;
+    blocks = n >> 6;
+    flags = kernel_fpu_begin();
+    asm volatile ("                         \n\
+            1:                              \n\
+            movdqu  (%%esi), %%xmm0         \n\
+            movdqu  16(%%esi), %%xmm1       \n\
+            movdqu  32(%%esi), %%xmm2       \n\
+            movdqu  48(%%esi), %%xmm3       \n\
+            movntdq %%xmm0, (%%edi)         \n\
+            movntdq %%xmm1, 16(%%edi)       \n\
+            movntdq %%xmm2, 32(%%edi)       \n\
+            movntdq %%xmm3, 48(%%edi)       \n\
+            addl    $64, %%esi              \n\
+            addl    $64, %%edi              \n\
+            subl    $1, %%ecx               \n\
+            jnz     1b                      \n\
+            sfence                          \n\
+            "
+            : "+S"(s), "+D"(d), "+c"(blocks)
+            :
+            : "memory", "cc"
+    );
+    kernel_fpu_end(flags);
+    memcpy_fn(d, s, n & 0x3F);
+    return dest;
+}
+
 /* void* memmove(void* dest, const void* src, uint32_t n);
  * Description: Optimized memmove (used for overlapping memory areas)
  * Inputs:      void* dest = destination of move
@@ -513,17 +922,26 @@ void* memcpy(void* dest, const void* src, uint32_t n) {
  * Return Value: pointer to dest
  * Function: move n bytes of src to dest */
 void* memmove(void* dest, const void* src, uint32_t n) {
+    /* A forward copy is safe unless dest starts inside src */
+    if ((uint32_t)dest <= (uint32_t)src || (uint32_t)dest >= (uint32_t)src + n)
+        return memcpy_fn(dest, src, n);
+
+    /* Backwards, the odd bytes at the end first and then whole dwords */
     asm volatile ("                             \n\
             movw    %%ds, %%dx                  \n\
             movw    %%dx, %%es                  \n\
-            cld                                 \n\
-            cmp     %%edi, %%esi                \n\
-            jae     .memmove_go                 \n\
             leal    -1(%%esi, %%ecx), %%esi     \n\
             leal    -1(%%edi, %%ecx), %%edi     \n\
+            movl    %%ecx, %%edx                \n\
+            andl    $0x3, %%ecx                 \n\
+            shrl    $2, %%edx                   \n\
             std                                 \n\
-            .memmove_go:                        \n\
             rep     movsb                       \n\
+            subl    $3, %%esi                   \n\
+            subl    $3, %%edi                   \n\
+            movl    %%edx, %%ecx                \n\
+            rep     movsl                       \n\
+            cld                                 \n\
             "
             :
             : "D"(dest), "S"(src), "c"(n)
@@ -545,6 +963,21 @@ void* memmove(void* dest, const void* src, uint32_t n) {
  * Function: compares string 1 and string 2 for equality */
 int32_t strncmp(const int8_t* s1, const int8_t* s2, uint32_t n) {
     int32_t i;
+    uint32_t word;
+
+    /* When both strings share an alignment, skip over equal words with no
+     * terminator in them. The byte loop below finds the exact difference. */
+    if ((((uint32_t)s1 ^ (uint32_t)s2) & 0x3) == 0) {
+        for (; n > 0 && ((uint32_t)s1 & 0x3); n--, s1++, s2++) {
+            if ((*s1 != *s2) || (*s1 == '\0'))
+                return *s1 - *s2;
+        }
+        for (; n >= 4; n -= 4, s1 += 4, s2 += 4) {
+            word = *(const uint32_t*)s1;
+            if (word != *(const uint32_t*)s2 || HAS_ZERO_BYTE(word))
+                break;
+        }
+    }
     for (i = 0; i < n; i++) {
         if ((s1[i] != s2[i]) || (s1[i] == '\0') /* || s2[i] == '\0' */) {
 
@@ -609,13 +1042,15 @@ void test_interrupts(void) {
  * Inputs: void
  * Outputs: Blinking cursor on screen
  * Return Value: void
- * Function: Change Cursor Position based on screen_x and screen_y postions */
+ * Function: Change Cursor Position based on screen_x and screen_y postions, the hardware cursor
+*           only follows the visible terminal */
 void change_cursor(uint8_t x_tmp, uint8_t y_tmp){
-    if(terminal_id == running_terminal){
-        screen_x = x_tmp;
-        screen_y = y_tmp;
+    if(terminal_id != running_terminal){
+        return;
     }
-    uint16_t pos = y_tmp * NUM_COLS + x_tmp;
+    screen_x = x_tmp;
+    screen_y = y_tmp;
+    uint16_t pos = (terminal_arr[running_terminal].top_line + y_tmp) * NUM_COLS + x_tmp;
  
 	outb(0x0F, 0x3D4);
 	outb((uint8_t) (pos & 0xFF), 0x3D5);
@@ -630,15 +1065,19 @@ void change_cursor(uint8_t x_tmp, uint8_t y_tmp){
 * DESCRIPTION: updating cursor
 */
 void terminal_switch_cursor(int x_pos , int y_pos){
+    uint32_t flags;
+
+    spin_lock_irqsave(&video_lock, flags);
     screen_x = x_pos;
     screen_y = y_pos;
     
-    uint16_t pos = y_pos * NUM_COLS + x_pos;
+    uint16_t pos = (terminal_arr[terminal_id].top_line + y_pos) * NUM_COLS + x_pos;
  
 	outb(0x0F, 0x3D4);
 	outb((uint8_t) (pos & 0xFF), 0x3D5);
 	outb(0x0E, 0x3D4);
 	outb((uint8_t) ((pos >> 8) & 0xFF), 0x3D5);
+    spin_unlock_irqrestore(&video_lock, flags);
 }
 
 /* get_screen_coords
@@ -9,10 +9,21 @@
 #include "terminal.h"
 #define VIDEO 0xB8000
 
+// cpuid feature bits the string routines are picked by
+#define CPUID_SSE2 (1 << 26)       // leaf 1 edx
+#define CPUID_ERMS (1 << 9)        // leaf 7 ebx
+#define MEM_SSE2 0x1
+#define MEM_ERMS 0x2
+#define NT_COPY_MIN 1024           // below this the non-temporal setup costs more than it saves
+
 int32_t printf(int8_t *format, ...);
 void putc(uint8_t c);
 int32_t puts(int8_t *s);
 int8_t *itoa(uint32_t value, int8_t* buf, int32_t radix);
+void put_dec(uint8_t* line, uint32_t value, uint32_t width);
+uint32_t put_stat_line(uint8_t* line, const int8_t* name, const uint32_t* values, const uint8_t* widths, uint32_t count);
+uint32_t cycles_since(uint64_t start);
+uint32_t cycles_to_ns(uint32_t cycles);
 int8_t *strrev(int8_t* s);
 uint32_t strlen(const int8_t* s);
 void clear(void);
@@ -22,6 +33,14 @@ void* memset_word(void* s, int32_t c, uint32_t n);
 void* memset_dword(void* s, int32_t c, uint32_t n);
 void* memcpy(void* dest, const void* src, uint32_t n);
 void* memmove(void* dest, const void* src, uint32_t n);
+void* memcpy_video(void* dest, const void* src, uint32_t n);
+void* memcpy_movsl(void* dest, const void* src, uint32_t n);
+void* memcpy_erms(void* dest, const void* src, uint32_t n);
+void* memcpy_nt(void* dest, const void* src, uint32_t n);
+void* memset_stosl(void* s, int32_t c, uint32_t n);
+void* memset_erms(void* s, int32_t c, uint32_t n);
+void mem_init(void);
+extern uint32_t mem_features;
 int32_t strncmp(const int8_t* s1, const int8_t* s2, uint32_t n);
 int8_t* strcpy(int8_t* dest, const int8_t*src);
 int8_t* strncpy(int8_t* dest, const int8_t*src, uint32_t n);
@@ -29,6 +48,11 @@ void test_interrupts(void);
 void change_cursor(uint8_t x_tmp, uint8_t y_tmp);
 void terminal_switch_cursor(int x_pos , int y_pos);
 int* get_screen_coords(void);
+void video_flush(uint32_t term);
+void video_show(uint32_t term);
+void video_reset(uint32_t term);
+void video_sync_vidmap(uint32_t term);
+void video_scroll_view(uint32_t term, int32_t lines);
 
 /* Userspace address-check functions */
 int32_t bad_userspace_addr(const void* addr, int32_t len);
@@ -78,6 +102,93 @@ static inline uint32_t inl(port) {
     return val;
 }
 
+/* Reads the 64-bit time-stamp counter */
+static inline uint64_t rdtsc(void) {
+    uint32_t lo, hi;
+    asm volatile ("rdtsc"
+            : "=a"(lo), "=d"(hi)
+    );
+    return ((uint64_t)hi << 32) | lo;
+}
+
+/* Divides a 64-bit value by a 32-bit one with divl, saturating when the quotient needs more than 32 bits */
+static inline uint32_t udiv64_sat(uint64_t n, uint32_t d) {
+    uint32_t q, r;
+    if ((uint32_t)(n >> 32) >= d) {
+        return 0xFFFFFFFF;
+    }
+    asm ("divl %4"
+            : "=a"(q), "=d"(r)
+            : "a"((uint32_t)n), "d"((uint32_t)(n >> 32)), "rm"(d)
+            : "cc"
+    );
+    return q;
+}
+
+/* Runs cpuid for the given leaf */
+static inline void cpuid(uint32_t leaf, uint32_t* eax, uint32_t* ebx, uint32_t* ecx, uint32_t* edx) {
+    asm volatile ("cpuid"
+            : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx)
+            : "a"(leaf), "c"(0)
+    );
+}
+
+/* Writes a model specific register */
+static inline void wrmsr(uint32_t msr, uint64_t val) {
+    asm volatile ("wrmsr"
+            :
+            : "c"(msr), "a"((uint32_t)val), "d"((uint32_t)(val >> 32))
+            : "memory"
+    );
+}
+
+/* Swaps a word with memory in one locked bus cycle, xchg needs no lock prefix */
+static inline uint32_t xchg(volatile uint32_t* addr, uint32_t val) {
+    asm volatile ("xchgl %0, %1"
+            : "+r"(val), "+m"(*addr)
+            :
+            : "memory"
+    );
+    return val;
+}
+
+/* Adds to a word in one locked bus cycle, returns what it held before */
+static inline uint32_t fetch_add(volatile uint32_t* addr, uint32_t val) {
+    asm volatile ("lock; xaddl %0, %1"
+            : "+r"(val), "+m"(*addr)
+            :
+            : "memory", "cc"
+    );
+    return val;
+}
+
+/* Tells the processor it is in a spin loop */
+static inline void cpu_relax(void) {
+    asm volatile ("pause" : : : "memory");
+}
+
+/* Returns the index of the lowest clear bit of a word that is not all ones */
+static inline uint32_t find_first_zero(uint32_t word) {
+    uint32_t bit;
+    asm volatile ("bsfl %1, %0"
+            : "=r"(bit)
+            : "r"(~word)
+            : "cc"
+    );
+    return bit;
+}
+
+/* Returns the index of the highest set bit of a nonzero word */
+static inline uint32_t find_last_set(uint32_t word) {
+    uint32_t bit;
+    asm volatile ("bsrl %1, %0"
+            : "=r"(bit)
+            : "r"(word)
+            : "cc"
+    );
+    return bit;
+}
+
 /* Writes a byte to a port */
 #define outb(data, port)                \
 do {                                    \
@@ -159,4 +270,12 @@ do {                                    \
     );                                  \
 } while (0)
 
+/* Compiler barrier
+ * Keeps the compiler from moving memory accesses across it, which is
+ * all one producer and one consumer on a single processor need */
+#define barrier()                       \
+do {                                    \
+    asm volatile ("" : : : "memory");   \
+} while (0)
+
 #endif /* _LIB_H */
@@ -1,5 +1,8 @@
 #include "paging.h"
 #include "system_calls.h"
+#include "frame.h"
+#include "apic.h"
+#include "smp.h"
 
 unsigned int PDE_index = 32;
 
@@ -43,6 +46,38 @@ void initialize_paging(){
             pde[i].page_dir_kernel.rw     =1    ;    //set parameter to 1
             pde[i].page_dir_kernel.present=1    ;     //set parameter to 1
         }
+        //identity map the rest of physical memory below 128 MB so the kernel can reach allocated frames
+        else if (i < (FRAME_HIGH_LIMIT >> 22)){
+            pde[i].page_dir_kernel.page_base_add  = i;  //set parameter to pageIndex
+            pde[i].page_dir_kernel.reserved       = 0;  //set parameter to 0
+            pde[i].page_dir_kernel.pat            = 0;  //set parameter to 0    
+            pde[i].page_dir_kernel.avail          = 0;        //set parameter to 0
+            pde[i].page_dir_kernel.g              = 0;       //set parameter to 0     
+            pde[i].page_dir_kernel.ps = 1       ;      //set parameter to 1
+            pde[i].page_dir_kernel.d = 0        ;     //set parameter to 0
+            pde[i].page_dir_kernel.a = 0        ;    //set parameter to 0
+            pde[i].page_dir_kernel.pcd = 0      ;    //set parameter to 0
+            pde[i].page_dir_kernel.pwt    =0    ;     //set parameter to 0
+            pde[i].page_dir_kernel.us     =0    ;     //set parameter to 0 (kernel only)
+            pde[i].page_dir_kernel.rw     =1    ;    //set parameter to 1
+            pde[i].page_dir_kernel.present=1    ;     //set parameter to 1
+        }
+        //map the local apic registers, uncached
+        else if (i == LAPIC_PDE){
+            pde[i].page_dir_kernel.page_base_add  = i;  //set parameter to pageIndex
+            pde[i].page_dir_kernel.reserved       = 0;  //set parameter to 0
+            pde[i].page_dir_kernel.pat            = 0;  //set parameter to 0
+            pde[i].page_dir_kernel.avail          = 0;        //set parameter to 0
+            pde[i].page_dir_kernel.g              = 0;       //set parameter to 0
+            pde[i].page_dir_kernel.ps = 1       ;      //set parameter to 1
+            pde[i].page_dir_kernel.d = 0        ;     //set parameter to 0
+            pde[i].page_dir_kernel.a = 0        ;    //set parameter to 0
+            pde[i].page_dir_kernel.pcd = 1      ;    //set parameter to 1, registers must not be cached
+            pde[i].page_dir_kernel.pwt    =1    ;     //set parameter to 1
+            pde[i].page_dir_kernel.us     =0    ;     //set parameter to 0 (kernel only)
+            pde[i].page_dir_kernel.rw     =1    ;    //set parameter to 1
+            pde[i].page_dir_kernel.present=1    ;     //set parameter to 1
+        }
         //disable these entries
         else{
             pde[i].page_dir_vid.table_base_add = 0; //set parameter to 0
@@ -62,7 +97,7 @@ void initialize_paging(){
     // for loop for each element in the page table
     for (i = 0; i < 1024; i++){
         //check if entry corresponds to video memory
-        if (i == 184 || i == 185 || i == 186 || i == 187){ 
+        if (i >= VGA_FIRST_PAGE && i <= VGA_LAST_PAGE){ 
             pte[i].page_base_add = i; //set parameter to pageIndex
             pte[i].avail = 0         ; //set parameter to 0
             pte[i].g = 0         ; //set parameter to 0
@@ -95,134 +130,255 @@ void initialize_paging(){
     enablePaging(); //switch on paging
 }
 
-/* executable_page
-* INPUTS: none
+/* set_user_pde
+* INPUTS: pid
 * OUTPUTS: none
 * RETURN: none
-* DESCRIPTION: creates new page for current program being loaded
+* DESCRIPTION: points the 128 MB page directory entry at the page table of the given process, in the
+*              directory of the running cpu
 */
-void executable_page(){
-    pde[PDE_index].page_dir_kernel.page_base_add  = get_global_pid() + 2;  //set parameter to 1
-    pde[PDE_index].page_dir_kernel.reserved       = 0;  //set parameter to 0
-    pde[PDE_index].page_dir_kernel.pat            = 0;  //set parameter to 0    
-    pde[PDE_index].page_dir_kernel.avail          = 0;        //set parameter to 0
-    pde[PDE_index].page_dir_kernel.g              = 1;       //set parameter to 1     
-    pde[PDE_index].page_dir_kernel.ps = 1       ;      //set parameter to 1
-    pde[PDE_index].page_dir_kernel.d = 0        ;     //set parameter to 0
-    pde[PDE_index].page_dir_kernel.a = 0        ;    //set parameter to 0
-    pde[PDE_index].page_dir_kernel.pcd = 0      ;    //set parameter to 0
-    pde[PDE_index].page_dir_kernel.pwt    = 0    ;     //set parameter to 0
-    pde[PDE_index].page_dir_kernel.us     = 1    ;     //set parameter to 0
-    pde[PDE_index].page_dir_kernel.rw     = 1    ;    //set parameter to 1
-    pde[PDE_index].page_dir_kernel.present = 1    ;     //set parameter to 1
-    //PDE_index++;
-    loadPageDirectory((unsigned int *)pde);
+static void set_user_pde(uint32_t pid){
+    page_dir_entry_t* dir = this_cpu()->page_dir;
+
+    dir[PDE_index].page_dir_vid.table_base_add = (unsigned int) get_pcb(pid)->page_table >> 12;  //set base address to the process' page table
+    dir[PDE_index].page_dir_vid.avail = 0         ; //set parameter to 0
+    dir[PDE_index].page_dir_vid.g = 0         ; //set parameter to 0
+    dir[PDE_index].page_dir_vid.ps = 0            ; //set parameter to 0 (4kb pages)
+    dir[PDE_index].page_dir_vid.reserved = 0       ;    //set parameter to 0
+    dir[PDE_index].page_dir_vid.a = 0             ; //set parameter to 0
+    dir[PDE_index].page_dir_vid.pcd = 0          ;  //set parameter to 0
+    dir[PDE_index].page_dir_vid.pwt = 0           ; //set parameter to 0
+    dir[PDE_index].page_dir_vid.us = 1            ; //set parameter to 1
+    dir[PDE_index].page_dir_vid.rw = 1            ; //set parameter to 1
+    dir[PDE_index].page_dir_vid.present = 1        ;    //set parameter to 1
 }
 
-/* disable_page
+/* user_table_alloc
 * INPUTS: none
 * OUTPUTS: none
-* RETURN: none
-* DESCRIPTION: creates new page for current program being loaded
+* RETURN: an empty page table for the 128 MB window, NULL if memory is exhausted
+* DESCRIPTION: every page starts out not present and is filled in by the loader or the page fault handler
 */
-void disable_page(uint32_t vmem_loc){
-    pde[0].page_dir_vid.table_base_add = (unsigned int) pte >> 12;
+page_table_entry_t* user_table_alloc(void){
+    page_table_entry_t* table = (page_table_entry_t*)frame_alloc();
+    unsigned int i;
 
-    pte[vmem_loc/(FOUR_KB)].page_base_add = vmem_loc/(FOUR_KB); //set parameter to pageIndex
+    if (table == NULL){
+        return NULL;
+    }
+    for (i = 0; i < 1024; i++){
+        table[i].page_base_add = 0;    //set parameter to 0
+        table[i].avail = 0         ;//set parameter to 0
+        table[i].g = 0         ;//set parameter to 0
+        table[i].pat = 0            ;//set parameter to 0
+        table[i].d = 0       ;//set parameter to 0
+        table[i].a = 0             ;//set parameter to 0
+        table[i].pcd = 0          ;//set parameter to 0
+        table[i].pwt = 0           ;//set parameter to 0
+        table[i].us = 1            ;//set parameter to 1
+        table[i].rw = 1            ;//set parameter to 1
+        table[i].present = 0        ;//set parameter to 0
+    }
+    return table;
+}
 
-    pte[vmem_loc/(FOUR_KB)].present = 1        ;//set parameter to 1
+/* user_table_free
+* INPUTS: table
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: gives the frames the process owned and the table itself back, pages shared with
+*              the filesystem image are left alone. The table must not be the one in use
+*/
+void user_table_free(page_table_entry_t* table){
+    unsigned int i;
 
-    loadPageDirectory((unsigned int *)pde);
+    for (i = 0; i < 1024; i++){
+        if (table[i].present && table[i].avail == PAGE_OWNED){
+            frame_free(table[i].page_base_add << 12);
+        }
+    }
+    frame_free((uint32_t)table);
 }
 
-/* enable_page
-* INPUTS: vmem_loc
+/* user_page_map
+* INPUTS: pid, vaddr, phys_addr, rw
 * OUTPUTS: none
 * RETURN: none
-* DESCRIPTION: enabling paging for a giving video memory location
+* DESCRIPTION: maps one 4kb page of the 128 MB user window onto any physical page,
+*              caller reloads cr3 once all pages are mapped
 */
+void user_page_map(uint32_t pid, uint32_t vaddr, uint32_t phys_addr, uint32_t rw){
+    page_table_entry_t* table = get_pcb(pid)->page_table;
+    uint32_t i = (vaddr >> 12) & 0x3FF;        // index into the 4mb window's page table
 
-void enable_page(uint32_t vmem_loc){
-    pde[0].page_dir_vid.table_base_add = (unsigned int) pte >> 12;
- 
-    pte[vmem_loc/(FOUR_KB)].page_base_add = 184; //set parameter to pageIndex
+    table[i].page_base_add = phys_addr >> 12;
+    table[i].avail = 0           ;//not owned, never freed with the process
+    table[i].us = 1            ;//set parameter to 1
+    table[i].rw = rw           ;//read-only pages fault on user writes
+    table[i].present = 1        ;//set parameter to 1
+}
 
-    pte[vmem_loc/(FOUR_KB)].present = 1        ;//set parameter to 1
+/* user_page_alloc
+* INPUTS: pid, vaddr
+* OUTPUTS: none
+* RETURN: physical address of the new frame, 0 if memory is exhausted
+* DESCRIPTION: backs one page of the 128 MB user window with a fresh writable frame the process owns
+*/
+uint32_t user_page_alloc(uint32_t pid, uint32_t vaddr){
+    page_table_entry_t* table = get_pcb(pid)->page_table;
+    uint32_t i = (vaddr >> 12) & 0x3FF;        // index into the 4mb window's page table
+    uint32_t phys_addr = frame_alloc();
 
-    loadPageDirectory((unsigned int *)pde);
+    if (phys_addr == 0){
+        return 0;
+    }
+    table[i].page_base_add = phys_addr >> 12;
+    table[i].avail = PAGE_OWNED  ;//freed with the process
+    table[i].us = 1            ;//set parameter to 1
+    table[i].rw = 1            ;//set parameter to 1
+    table[i].present = 1        ;//set parameter to 1
+    return phys_addr;
 }
 
-/* schedule_visible_page
-* INPUTS: none
+/* flush_tlb
+* INPUTS: pid
 * OUTPUTS: none
 * RETURN: none
-* DESCRIPTION: used by scheduler to do paginging for the visible terminal
+* DESCRIPTION: flushes tlb by writing to cr3 reg
 */
-void schedule_visible_page(){
-    pde[0].page_dir_vid.table_base_add = (unsigned int) pte >> 12;
+void flush_tlb(uint32_t curr_pid){
+    set_user_pde(curr_pid);
+    loadPageDirectory((unsigned int *)this_cpu()->page_dir);
+}
 
-    pte[184].page_base_add = 184; //set parameter to pageIndex
+/* vidmap_pde_set
+* INPUTS: dir - page directory, table - its 132 MB page table
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: points the 132 MB page directory entry at table, user accessible
+*/
+static void vidmap_pde_set(page_dir_entry_t* dir, page_table_entry_t* table){
+    int vidmem_pde_index = VIDMAP_ADDR >> 22;
 
-    loadPageDirectory((unsigned int *)pde);
+    dir[vidmem_pde_index].page_dir_vid.table_base_add = (unsigned int)table >> 12; // set base address to pte; right shift by 12 bits to fit in 31:12 of pde entry
+    dir[vidmem_pde_index].page_dir_vid.avail = 0;                                // set parameter to 0
+    dir[vidmem_pde_index].page_dir_vid.g = 0;                                    // set parameter to 0
+    dir[vidmem_pde_index].page_dir_vid.ps = 0;                                   // set parameter to 0
+    dir[vidmem_pde_index].page_dir_vid.reserved = 0;                             // set parameter to 0
+    dir[vidmem_pde_index].page_dir_vid.a = 0;                                    // set parameter to 0
+    dir[vidmem_pde_index].page_dir_vid.pcd = 0;                                  // set parameter to 0
+    dir[vidmem_pde_index].page_dir_vid.pwt = 0;                                  // set parameter to 0
+    dir[vidmem_pde_index].page_dir_vid.us = 1;                                   // set parameter to 0
+    dir[vidmem_pde_index].page_dir_vid.rw = 1;                                   // set parameter to 1
+    dir[vidmem_pde_index].page_dir_vid.present = 1;                              // set parameter to 1
 }
 
-/* schedule_invisible_page
-* INPUTS: none
+/* vidmap_table_init
+* INPUTS: dir - page directory of a cpu, table - a free frame
 * OUTPUTS: none
 * RETURN: none
-* DESCRIPTION: used by scheduler to do paginging for the invisible terminal
+* DESCRIPTION: gives another cpu its own 132 MB page table, a copy of the boot cpu's with the time page
+*              and no vidmap page. The vidmap entry follows the task the cpu runs
 */
-void schedule_invisible_page(uint32_t vmem_loc){
-    pde[0].page_dir_vid.table_base_add = (unsigned int) pte >> 12;
+void vidmap_table_init(page_dir_entry_t* dir, page_table_entry_t* table){
+    memcpy(table, vidmem_pte, sizeof(vidmem_pte));
+    table[0].present = 0;
+    vidmap_pde_set(dir, table);
+}
 
-    pte[184].page_base_add = vmem_loc/(FOUR_KB); //set parameter to pageIndex
+/* low_page_map
+* INPUTS: addr - physical address below 4 MB
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: identity maps the page holding addr for the kernel, for the startup code of the other
+*              cpus that has to sit below 1 MB. The first 4 MB page table is shared by every cpu
+*/
+void low_page_map(uint32_t addr){
+    uint32_t i = addr >> 12;
 
-    loadPageDirectory((unsigned int *)pde);
+    pte[i].page_base_add = i;  //set parameter to pageIndex
+    pte[i].avail = 0         ;//set parameter to 0
+    pte[i].g = 0         ;//set parameter to 0
+    pte[i].pat = 0            ;//set parameter to 0
+    pte[i].d = 0       ;//set parameter to 0
+    pte[i].a = 0             ;//set parameter to 0
+    pte[i].pcd = 0          ;//set parameter to 0
+    pte[i].pwt = 0           ;//set parameter to 0
+    pte[i].us = 0            ;//set parameter to 0
+    pte[i].rw = 1            ;//set parameter to 1
+    pte[i].present = 1        ;//set parameter to 1
+    asm volatile ("invlpg (%0)" : : "r"(addr) : "memory");
 }
 
-/* flush_tlb
-* INPUTS: pid
+/* vidmem_assign
+* INPUTS: phys_addr - page the user program draws into
 * OUTPUTS: none
 * RETURN: none
-* DESCRIPTION: flushes tlb by writing to cr3 reg
+* DESCRIPTION: maps the page at VIDMAP_ADDR for user programs, in the 132 MB table of the running cpu
 */
-void flush_tlb(uint32_t curr_pid){
-    pde[PDE_index].page_dir_kernel.page_base_add  = curr_pid + 2;
-    loadPageDirectory((unsigned int *)pde);
+void vidmem_assign(uint32_t phys_addr){
+    page_table_entry_t* table = this_cpu()->vidmap_table;
+
+    vidmap_pde_set(this_cpu()->page_dir, table);
+
+    table[0].page_base_add = phys_addr >> 12; // set parameter to pageIndex
+    table[0].avail = 0;         // set parameter to 0
+    table[0].g = 0;             // set parameter to 0
+    table[0].pat = 0;           // set parameter to 0
+    table[0].d = 0;             // set parameter to 0
+    table[0].a = 0;             // set parameter to 0
+    table[0].pcd = 0;           // set parameter to 0
+    table[0].pwt = 0;           // set parameter to 0
+    table[0].us = 1;            // set parameter to 0
+    table[0].rw = 1;            // set parameter to 1
+    table[0].present = 1;       // set parameter to 1
+
+    asm volatile ("invlpg (%0)" : : "r"(VIDMAP_ADDR) : "memory");
 }
 
-/* vidmem_assign
-* INPUTS: none
+/* vidmem_switch
+* INPUTS: phys_addr - vidmap page of the terminal of the task about to run, 0 if that terminal has none
 * OUTPUTS: none
 * RETURN: none
-* DESCRIPTION: assigning new page for video memory
+* DESCRIPTION: called on every task switch. The vidmap page belongs to a terminal, so the entry of the
+*              running cpu is re-pointed whenever the next task is on another terminal
 */
-void vidmem_assign(int vid_addr){
-    int vidmem_pde_index = vid_addr >> 22;
-
-    pde[vidmem_pde_index].page_dir_vid.table_base_add = (unsigned int)vidmem_pte >> 12; // set base address to pte; right shift by 12 bits to fit in 31:12 of pde entry
-    pde[vidmem_pde_index].page_dir_vid.avail = 0;                                // set parameter to 0
-    pde[vidmem_pde_index].page_dir_vid.g = 0;                                    // set parameter to 0
-    pde[vidmem_pde_index].page_dir_vid.ps = 0;                                   // set parameter to 0
-    pde[vidmem_pde_index].page_dir_vid.reserved = 0;                             // set parameter to 0
-    pde[vidmem_pde_index].page_dir_vid.a = 0;                                    // set parameter to 0
-    pde[vidmem_pde_index].page_dir_vid.pcd = 0;                                  // set parameter to 0
-    pde[vidmem_pde_index].page_dir_vid.pwt = 0;                                  // set parameter to 0
-    pde[vidmem_pde_index].page_dir_vid.us = 1;                                   // set parameter to 0
-    pde[vidmem_pde_index].page_dir_vid.rw = 1;                                   // set parameter to 1
-    pde[vidmem_pde_index].page_dir_vid.present = 1;                              // set parameter to 1
-
-    vidmem_pte[0].page_base_add = 184 + 1 + terminal_id; // set parameter to pageIndex
-    vidmem_pte[0].avail = 0;         // set parameter to 0
-    vidmem_pte[0].g = 0;             // set parameter to 0
-    vidmem_pte[0].pat = 0;           // set parameter to 0
-    vidmem_pte[0].d = 0;             // set parameter to 0
-    vidmem_pte[0].a = 0;             // set parameter to 0
-    vidmem_pte[0].pcd = 0;           // set parameter to 0
-    vidmem_pte[0].pwt = 0;           // set parameter to 0
-    vidmem_pte[0].us = 1;            // set parameter to 0
-    vidmem_pte[0].rw = 1;            // set parameter to 1
-    vidmem_pte[0].present = 1;       // set parameter to 1
+void vidmem_switch(uint32_t phys_addr){
+    page_table_entry_t* table = this_cpu()->vidmap_table;
+
+    if (phys_addr == 0){
+        if (table[0].present){
+            table[0].present = 0;
+            asm volatile ("invlpg (%0)" : : "r"(VIDMAP_ADDR) : "memory");
+        }
+        return;
+    }
+    if (!table[0].present || table[0].page_base_add != (phys_addr >> 12)){
+        vidmem_assign(phys_addr);
+    }
+}
+
+/* time_page_assign
+* INPUTS: phys_addr - the kernel's time page
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: maps the time page read-only at TIME_PAGE_ADDR, next to the vidmap page. Every process
+*              shares the 132 MB table, so it is there for all of them from boot on
+*/
+void time_page_assign(uint32_t phys_addr){
+    vidmap_pde_set(pde, vidmem_pte);
+
+    vidmem_pte[TIME_PAGE_INDEX].page_base_add = phys_addr >> 12; // set parameter to pageIndex
+    vidmem_pte[TIME_PAGE_INDEX].avail = 0;         // set parameter to 0
+    vidmem_pte[TIME_PAGE_INDEX].g = 0;             // set parameter to 0
+    vidmem_pte[TIME_PAGE_INDEX].pat = 0;           // set parameter to 0
+    vidmem_pte[TIME_PAGE_INDEX].d = 0;             // set parameter to 0
+    vidmem_pte[TIME_PAGE_INDEX].a = 0;             // set parameter to 0
+    vidmem_pte[TIME_PAGE_INDEX].pcd = 0;           // set parameter to 0
+    vidmem_pte[TIME_PAGE_INDEX].pwt = 0;           // set parameter to 0
+    vidmem_pte[TIME_PAGE_INDEX].us = 1;            // set parameter to 1
+    vidmem_pte[TIME_PAGE_INDEX].rw = 0;            // set parameter to 0, user programs only read it
+    vidmem_pte[TIME_PAGE_INDEX].present = 1;       // set parameter to 1
 
     // flush tlb
     asm volatile(
@@ -7,11 +7,8 @@ extern void loadPageDirectory(unsigned int*);
 extern void enablePaging();
 extern void flush_tlb(uint32_t curr_pid);
 
-extern void executable_page();
-extern void disable_page(uint32_t vmem_loc);
-extern void enable_page(uint32_t vmem_loc);
-extern void schedule_visible_page();
-extern void schedule_invisible_page(uint32_t vmem_loc);
+extern void user_page_map(uint32_t pid, uint32_t vaddr, uint32_t phys_addr, uint32_t rw);
+extern uint32_t user_page_alloc(uint32_t pid, uint32_t vaddr);
 
 
 
@@ -85,6 +82,21 @@ page_table_entry_t pte[1024] __attribute__((aligned(4096)));  //1024 entries in
 
 page_table_entry_t vidmem_pte[1024] __attribute__((aligned(4096)));  //1024 entries in the directory, aligned by 4kb (4096 bytes)
 
-extern void vidmem_assign(int vid_addr);
+#define PAGE_OWNED 1          // avail bits of a user pte whose frame came from frame_alloc
+#define VGA_FIRST_PAGE 184      // 0xB8000
+#define VGA_LAST_PAGE 191       // the whole 32 kb text window, hardware scrolling moves through it
+#define VIDMAP_ADDR 0x8400000   // 132 MB, where vidmap puts the page user programs draw into
+#define TIME_PAGE_INDEX 1       // entry of vidmem_pte for the time page, right above the vidmap page
+#define TIME_PAGE_ADDR (VIDMAP_ADDR + (TIME_PAGE_INDEX << 12))
+
+//per-process page tables for the 128 MB user program window, allocated from the frame allocator
+extern page_table_entry_t* user_table_alloc(void);
+extern void user_table_free(page_table_entry_t* table);
+
+extern void vidmem_assign(uint32_t phys_addr);
+extern void vidmem_switch(uint32_t phys_addr);
+extern void vidmap_table_init(page_dir_entry_t* dir, page_table_entry_t* table);
+extern void low_page_map(uint32_t addr);
+extern void time_page_assign(uint32_t phys_addr);
 
 #endif
@@ -0,0 +1,196 @@
+#include "pipe.h"
+#include "lib.h"
+#include "system_calls.h"
+
+pipe_t pipe_table[MAX_PIPES];
+
+/* pipe_fd_init
+* INPUTS: fd, index, end
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: points an fd of the running task at one end of a pipe
+*/
+static void pipe_fd_init(int32_t fd, uint32_t index, uint32_t end){
+    fd_t* file = &pcb_ptr->fd_array[fd];
+
+    file->file_op_table.open = pipe_open;
+    file->file_op_table.read = (end == PIPE_READ_END) ? pipe_read : NULL;
+    file->file_op_table.write = (end == PIPE_WRITE_END) ? pipe_write : NULL;
+    file->file_op_table.close = pipe_close;
+    file->inode = index;
+    file->fpos = end;
+    file->filetype = FILETYPE_PIPE;
+    file->oflags = 0;
+    file->flags = 1;
+}
+
+/* pipe
+* INPUTS: fds - user array for the two descriptors
+* OUTPUTS: fds[0] the read end, fds[1] the write end
+* RETURN: 0 on success, -1 if the array is bad or no pipe or fds are left
+* DESCRIPTION: system call, makes an empty pipe open for reading and writing in the calling process
+*/
+int32_t pipe(int32_t* fds){
+    uint32_t flags, index;
+    int32_t fd, ends[2], found = 0;
+
+    if ((uint32_t)fds < ONETWENTYEIGHT_MB || (uint32_t)fds > ONETHIRTYTWO_MB - 2 * sizeof(int32_t)){
+        return -1;
+    }
+
+    cli_and_save(flags);
+    for (fd = 2; fd < 8 && found < 2; fd++){
+        if (pcb_ptr->fd_array[fd].flags == 0){
+            ends[found++] = fd;
+        }
+    }
+    for (index = 0; index < MAX_PIPES; index++){
+        if (pipe_table[index].readers == 0 && pipe_table[index].writers == 0){
+            break;
+        }
+    }
+    if (found < 2 || index == MAX_PIPES){
+        restore_flags(flags);
+        return -1;
+    }
+
+    pipe_table[index].head = 0;
+    pipe_table[index].tail = 0;
+    pipe_table[index].readers = 1;
+    pipe_table[index].writers = 1;
+    wait_queue_init(&pipe_table[index].read_wait);
+    wait_queue_init(&pipe_table[index].write_wait);
+    pipe_fd_init(ends[0], index, PIPE_READ_END);
+    pipe_fd_init(ends[1], index, PIPE_WRITE_END);
+    restore_flags(flags);
+
+    fds[0] = ends[0];
+    fds[1] = ends[1];
+    return 0;
+}
+
+/* pipe_dup
+* INPUTS: index, end
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: counts one more open descriptor for an end, used when a child gets a copy of it
+*/
+void pipe_dup(uint32_t index, uint32_t end){
+    uint32_t flags;
+
+    cli_and_save(flags);
+    if (end == PIPE_READ_END){
+        pipe_table[index].readers++;
+    }
+    else{
+        pipe_table[index].writers++;
+    }
+    restore_flags(flags);
+}
+
+/* pipe_open
+* INPUTS: filename
+* OUTPUTS: none
+* RETURN: -1
+* DESCRIPTION: pipes have no name, only the pipe call makes them
+*/
+int32_t pipe_open(const uint8_t* filename){
+    return -1;
+}
+
+/* pipe_close
+* INPUTS: fd
+* OUTPUTS: none
+* RETURN: 0
+* DESCRIPTION: drops one end. The last writer gives readers end of file, the last reader makes
+*              writes fail, either way whoever sleeps on the other side is woken to notice
+*/
+int32_t pipe_close(int32_t fd){
+    pipe_t* p = &pipe_table[pcb_ptr->fd_array[fd].inode];
+    uint32_t flags;
+
+    cli_and_save(flags);
+    if (pcb_ptr->fd_array[fd].fpos == PIPE_READ_END){
+        if (p->readers > 0 && --p->readers == 0){
+            wake_up(&p->write_wait);
+        }
+    }
+    else if (p->writers > 0 && --p->writers == 0){
+        wake_up(&p->read_wait);
+    }
+    restore_flags(flags);
+    return 0;
+}
+
+/* pipe_read
+* INPUTS: fd, buf, nbytes
+* OUTPUTS: up to nbytes from the pipe in buf
+* RETURN: bytes read, 0 at end of file
+* DESCRIPTION: sleeps while the pipe is empty and still has a writer, then takes whatever is there
+*              so data streams through instead of waiting for nbytes
+*/
+int32_t pipe_read(int32_t fd, void* buf, int32_t nbytes){
+    pipe_t* p = &pipe_table[pcb_ptr->fd_array[fd].inode];
+    uint32_t flags, count, start, first;
+
+    cli_and_save(flags);
+    while (p->head == p->tail && p->writers > 0){
+        sleep_on(&p->read_wait);
+    }
+    count = p->head - p->tail;
+    if (count > nbytes){
+        count = nbytes;
+    }
+    start = p->tail & (PIPE_SIZE - 1);
+    first = PIPE_SIZE - start;          // bytes before the ring wraps
+    if (first > count){
+        first = count;
+    }
+    memcpy(buf, p->buf + start, first);
+    memcpy((uint8_t*)buf + first, p->buf, count - first);
+    p->tail += count;
+    if (count > 0){
+        wake_up(&p->write_wait);
+    }
+    restore_flags(flags);
+    return count;
+}
+
+/* pipe_write
+* INPUTS: fd, buf, nbytes
+* OUTPUTS: none
+* RETURN: bytes written, -1 if no reader is left before anything was written
+* DESCRIPTION: copies as much as fits and wakes the readers, sleeping whenever the ring is full
+*              until all of buf is in or the last reader goes away
+*/
+int32_t pipe_write(int32_t fd, const void* buf, int32_t nbytes){
+    pipe_t* p = &pipe_table[pcb_ptr->fd_array[fd].inode];
+    uint32_t flags, count, start, first, written = 0;
+
+    cli_and_save(flags);
+    while (written < nbytes){
+        if (p->readers == 0){
+            break;
+        }
+        count = PIPE_SIZE - (p->head - p->tail);
+        if (count == 0){
+            sleep_on(&p->write_wait);
+            continue;
+        }
+        if (count > nbytes - written){
+            count = nbytes - written;
+        }
+        start = p->head & (PIPE_SIZE - 1);
+        first = PIPE_SIZE - start;
+        if (first > count){
+            first = count;
+        }
+        memcpy(p->buf + start, (const uint8_t*)buf + written, first);
+        memcpy(p->buf, (const uint8_t*)buf + written + first, count - first);
+        p->head += count;
+        written += count;
+        wake_up(&p->read_wait);
+    }
+    restore_flags(flags);
+    return (written == 0) ? -1 : written;
+}
@@ -0,0 +1,34 @@
+#if !defined(PIPE_H)
+#define PIPE_H
+
+#include "types.h"
+#include "scheduler.h"
+
+#define FILETYPE_PIPE 5
+#define PIPE_SIZE 4096              // ring buffer bytes, a power of two
+#define MAX_PIPES 16
+#define PIPE_READ_END 0             // kept in the fd's fpos
+#define PIPE_WRITE_END 1
+
+typedef struct pipe_struct
+{
+    uint8_t buf[PIPE_SIZE];
+    uint32_t head;                  // bytes ever written, the next one goes to head % PIPE_SIZE
+    uint32_t tail;                  // bytes ever read
+    uint32_t readers;               // open read ends, over every process
+    uint32_t writers;
+    wait_queue_t read_wait;         // readers of an empty pipe
+    wait_queue_t write_wait;        // writers of a full pipe
+} pipe_t;
+
+extern pipe_t pipe_table[MAX_PIPES];
+
+int32_t pipe(int32_t* fds);
+void pipe_dup(uint32_t index, uint32_t end);
+
+int32_t pipe_open(const uint8_t* filename);
+int32_t pipe_close(int32_t fd);
+int32_t pipe_read(int32_t fd, void* buf, int32_t nbytes);
+int32_t pipe_write(int32_t fd, const void* buf, int32_t nbytes);
+
+#endif
@@ -3,6 +3,15 @@
 // #include "handlers.h"
 #include "i8259.h"
 #include "rtc.h"
+#include "system_calls.h"
+#include "softirq.h"
+#include "spinlock.h"
+
+static wait_queue_t rtc_wait_queue;     // tasks blocked in rtc_read
+static volatile uint32_t rtc_ticks_pending = 0;     // ticks the bottom half has not counted yet
+static uint32_t rtc_open_files = 0;     // the chip only interrupts while this is not 0
+static spinlock_t rtc_lock = SPINLOCK_INIT("rtc     ");     // the cmos index port, the pending ticks and the rtc files' counters
+static void rtc_softirq();
 
 
 /*
@@ -14,81 +23,169 @@
  *   SIDE EFFECTS: none
  */
 void printRTCReg(){
-    cli();
+    uint32_t flags;
+
+    spin_lock_irqsave(&rtc_lock, flags);
     outb(0x0a, 0x70);
     char prev = inb(0x71);
+    spin_unlock_irqrestore(&rtc_lock, flags);
     printf("reg A in rtc: %x\n", prev);
-    sti();
 }
 
 /*
  * 	rtc_init
- *   DESCRIPTION: Initialization the rtc interrupt line by unmasking the interrupt line on the slave PIC
+ *   DESCRIPTION: Sets the rtc chip to MAX_RTC_FREQ and registers the bottom half. The periodic interrupt
+ *                stays off until the first rtc file is opened
  *   INPUTS: none
  *   OUTPUTS: none
  *   RETURN VALUE: none
- *   SIDE EFFECTS: enables the IRQ 8 interrupt line (IRQ 0  on the slave PIC) 
+ *   SIDE EFFECTS: none
  */
 void rtc_init(){
-   
-    cli(); //start critical section
-    outb(0x8B, 0x70);		// select register B, and disable NMI
-    char prev=inb(0x71);	// read the current value of register B
-    outb(0x8B, 0x70);		// set the index again (a read will reset the index to register D)
-    outb( prev | 0x40, 0x71);	// write the previous value ORed with 0x40. This turns on bit 6 of register B
-    sti();
-    enable_irq(8); //enable interrupts from irq8 rtc
-    cli();
+    uint32_t flags;
+
+    spin_lock_irqsave(&rtc_lock, flags); //start critical section
     outb(0x8A, 0x70);		// set index to register A, disable NMI
-    prev=inb(0x71);	// get initial value of register A
+    char prev=inb(0x71);	// get initial value of register A
     outb( 0x8A, 0x70);		// reset index to A
     outb( (prev & 0xF0) | MAX_RTC_FREQ_BM, 0x71); //write only our rate to A. Note, rate is the bottom 4 bits.
 
-    rtc_frequency = MIN_RTC_FREQ;
-    rtc_frequency_counter_limit = MAX_RTC_FREQ / MIN_RTC_FREQ; // number of ticks to occur before read
-    rtc_frequency_counter = rtc_frequency_counter_limit; // set current counter to tick limit
+    // the chip always runs at MAX_RTC_FREQ, every open rtc file divides it down to its own rate
     rtc_initialized = 1; // raise intialization flag
-    rtc_interrupt_occurred = 0;
+    wait_queue_init(&rtc_wait_queue);
+    softirq_register(SOFTIRQ_RTC, rtc_softirq);
+
+    spin_unlock_irqrestore(&rtc_lock, flags); //end critical section
+}
+
+/*
+ * 	rtc_periodic
+ *   DESCRIPTION: Turns the periodic interrupt of the chip on or off. Off, an idle cpu is not woken
+ *                MAX_RTC_FREQ times a second for nobody
+ *   INPUTS: on - 1 to turn it on, 0 to turn it off
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: sets or clears bit 6 of register B, unmasks or masks IRQ 8
+ */
+static void rtc_periodic(int on){
+    uint32_t flags;
 
-    sti(); //end critical section
+    if (!on){
+        disable_irq(8); //mask irq8 rtc before the chip stops
+    }
+    spin_lock_irqsave(&rtc_lock, flags);
+    outb(0x8B, 0x70);		// select register B, and disable NMI
+    char prev=inb(0x71);	// read the current value of register B
+    outb(0x8B, 0x70);		// set the index again (a read will reset the index to register D)
+    outb(on ? (prev | 0x40) : (prev & ~0x40), 0x71);	// bit 6 of register B is the periodic interrupt
+    outb(0x0C, 0x70);		// select register C
+    inb(0x71);			// drop a flag raised before the change
+    rtc_ticks_pending = 0;
+    spin_unlock_irqrestore(&rtc_lock, flags);
+    if (on){
+        enable_irq(8); //enable interrupts from irq8 rtc
+    }
 }
 
 /*
  * 	rtc_handler
- *   DESCRIPTION: Executes the code inside this handler periodically as the RTC raises an interrupt
+ *   DESCRIPTION: Top half, executed periodically as the RTC raises an interrupt. Acknowledges the chip
+ *                and counts the tick for rtc_softirq
  *   INPUTS: none
- *   OUTPUTS: runs the test_interrupts, printing/flashing alternate character on the screen
+ *   OUTPUTS: none
  *   RETURN VALUE: none
- *   SIDE EFFECTS: clears and sets the interrupt flag, while executing the code inside the handler
+ *   SIDE EFFECTS: none, runs with interrupts off from the interrupt gate to the iret
  */ 
 void rtc_handler(){
-    cli(); //start critical section
-    //test_interrupts(); //call function that checkpoint 1 requires
+    uint64_t start = rdtsc();
+    uint32_t flags;
+
+    spin_lock_irqsave(&rtc_lock, flags);
     outb(0x0C, 0x70); // select register C
     inb(0x71); //throw away contents
 
-    if (rtc_frequency_counter > 0) rtc_frequency_counter--; //tick
+    rtc_ticks_pending++;
+    spin_unlock_irqrestore(&rtc_lock, flags);
+    softirq_raise(SOFTIRQ_RTC);
 
-    if (rtc_frequency_counter  == 0){ // if tick limit reached
-        rtc_interrupt_occurred = 0; // lower flag
-        rtc_frequency_counter = rtc_frequency_counter_limit; // reset tick counter
+    send_eoi(8); //end of interrupts for irq8 rtc
+    softirq_top_time(SOFTIRQ_RTC, start);
+}
+
+/*
+ * 	rtc_softirq
+ *   DESCRIPTION: Bottom half, counts down the virtual rtc of every open rtc file by the ticks since it
+ *                last ran and wakes the readers whose period passed
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: none
+ */ 
+static void rtc_softirq(){
+    pcb_t* task;
+    fd_t* file;
+    int pid, fd;
+    int expired = 0;
+    uint32_t flags, ticks, left;
+
+    spin_lock_irqsave(&rtc_lock, flags);
+    ticks = rtc_ticks_pending;
+    rtc_ticks_pending = 0;
+    spin_unlock_irqrestore(&rtc_lock, flags);
+    if (ticks == 0){
+        return;
     }
 
-    send_eoi(8); //end of interrupts for irq8 rtc
-    sti(); //end critical section
+    // the walk runs with interrupts on, the lock is only held for the counters of one file at a time
+    for (pid = 0; pid < MAX_PIDS; pid++){
+        task = get_pcb(pid);
+        if (task == NULL){
+            continue;
+        }
+        for (fd = 2; fd < 8; fd++){
+            file = &task->fd_array[fd];
+            if (file->flags == 0 || file->filetype != 0){      // not an open rtc file
+                continue;
+            }
+            spin_lock_irqsave(&rtc_lock, flags);
+            if (file->rtc_counter > ticks){
+                file->rtc_counter -= ticks;
+            }
+            else{
+                left = ticks - file->rtc_counter;       // virtual period passed, maybe more than once
+                file->rtc_pending += 1 + left / file->rtc_divider;
+                file->rtc_counter = file->rtc_divider - left % file->rtc_divider;
+                expired = 1;
+            }
+            spin_unlock_irqrestore(&rtc_lock, flags);
+        }
+    }
+
+    if (expired){
+        wake_up(&rtc_wait_queue); // wake the tasks blocked in rtc_read, each checks its own file
+    }
 }
 
 /*
  * 	rtc_read
- *   DESCRIPTION: RTC read system call. Waits for rtc interrupt to occur and returns.
- *   INPUTS: none
+ *   DESCRIPTION: RTC read system call. Waits for the next tick of this file's virtual rtc and returns.
+ *   INPUTS: fd
  *   OUTPUTS: none
  *   RETURN VALUE: int32_t - always 0
- *   SIDE EFFECTS: raises rtc_interrupt_occurred flag temporarily.
+ *   SIDE EFFECTS: the caller leaves the run queue while waiting. Ticks that passed while the caller was busy
+ *                 are returned right away so the average rate stays exact.
  */
 int32_t rtc_read(int32_t fd, void* buf, int32_t nbytes){
-    rtc_interrupt_occurred = 1; // raises flag
-    while (rtc_interrupt_occurred != 0){} // waits for flag to be lowered by rtc handler
+    uint32_t flags;
+
+    spin_lock_irqsave(&rtc_lock, flags);
+    while (pcb_ptr->fd_array[fd].rtc_pending == 0){ // sleeps until the rtc handler counts a tick for this file
+        spin_unlock(&rtc_lock);         // interrupts stay off and the kernel lock is held, so no wakeup slips in before sleep_on
+        sleep_on(&rtc_wait_queue);
+        spin_lock(&rtc_lock);
+    }
+    pcb_ptr->fd_array[fd].rtc_pending--;
+    spin_unlock_irqrestore(&rtc_lock, flags);
     return 0;
 }
 
@@ -98,36 +195,41 @@ int32_t rtc_read(int32_t fd, void* buf, int32_t nbytes){
  *   INPUTS: none
  *   OUTPUTS: none
  *   RETURN VALUE: int32_t - always 0
- *   SIDE EFFECTS: none
+ *   SIDE EFFECTS: stops the periodic interrupt when this was the last open rtc file
  */
 int32_t rtc_close(int32_t fd){
-    rtc_initialized = 0; // lower rtc initialized flag
+    if (rtc_open_files > 0 && --rtc_open_files == 0){  // open and close run under the kernel lock
+        rtc_periodic(0);
+    }
     return 0;
 }
 
 /*
  * 	rtc_write
- *   DESCRIPTION: RTC write system call. Changes RTC frequency.
- *   INPUTS: buf - buffer, n - number of bytes
+ *   DESCRIPTION: RTC write system call. Changes the virtual RTC frequency of this file only.
+ *   INPUTS: fd, buf - buffer holding a 4 byte frequency, n - number of bytes
  *   OUTPUTS: none
  *   RETURN VALUE: int32_t - 4 if success, -1 if failure
- *   SIDE EFFECTS: changes the rtc frequency.
+ *   SIDE EFFECTS: changes the file's rtc frequency and drops its pending ticks.
  */
 int32_t rtc_write(int32_t fd, const void* buf_arg, int32_t n){
     // printf("rtc_write call\n");
-    cli();
-    uint8_t* buf = (uint8_t*) buf_arg;
+    uint32_t flags;
     int32_t freq;
-    freq = (uint32_t) (*buf); // get frequency from buffer
-    if (freq > 1024 || freq < 2 || freq == NULL) { // parameter checking
+    if (buf_arg == NULL || n != 4){
+        return -1;
+    }
+    freq = *(int32_t*)buf_arg; // get frequency from buffer
+    if (freq > MAX_RTC_FREQ || freq < MIN_RTC_FREQ || (freq & (freq - 1)) != 0) { // parameter checking, must be a power of 2
         printf("Error setting RTC\n");
-        sti();
         return -1;
     } 
-    rtc_frequency_counter_limit = MAX_RTC_FREQ / freq; // redefine tick limit
-    rtc_frequency_counter = rtc_frequency_counter_limit; // reset tick counter
-    sti();
-    return -1; // return error if freq is not power of 2
+    spin_lock_irqsave(&rtc_lock, flags);
+    pcb_ptr->fd_array[fd].rtc_divider = MAX_RTC_FREQ / freq; // redefine tick limit
+    pcb_ptr->fd_array[fd].rtc_counter = pcb_ptr->fd_array[fd].rtc_divider; // reset tick counter
+    pcb_ptr->fd_array[fd].rtc_pending = 0;
+    spin_unlock_irqrestore(&rtc_lock, flags);
+    return 4;
 }
 
 /*
@@ -136,11 +238,115 @@ int32_t rtc_write(int32_t fd, const void* buf_arg, int32_t n){
  *   INPUTS: none
  *   OUTPUTS: none
  *   RETURN VALUE: int32_t - always 0
- *   SIDE EFFECTS: sets rtc frequency to 2 Hz.
+ *   SIDE EFFECTS: starts the periodic interrupt for the first open rtc file, open sets the file's virtual rate to 2 Hz.
  */
 int32_t rtc_open(const uint8_t* filename){
     if (rtc_initialized == 0) rtc_init(); // if rtc not initialized, initialize it first
-    uint8_t i = 2;
-    rtc_write(0,&i,4); // set freq to 2 Hz, required by addendum
+    if (rtc_open_files++ == 0){
+        rtc_periodic(1);
+    }
     return 0;
 }
+
+/*
+ * 	cmos_read
+ *   DESCRIPTION: Reads one cmos register with NMI left off, like rtc_init does.
+ *   INPUTS: reg - register index
+ *   OUTPUTS: none
+ *   RETURN VALUE: uint8_t - the register
+ *   SIDE EFFECTS: none
+ */
+static uint8_t cmos_read(uint8_t reg){
+    outb(CMOS_NMI_OFF | reg, CMOS_INDEX);
+    return inb(CMOS_DATA);
+}
+
+/*
+ * 	cmos_read_date
+ *   DESCRIPTION: Reads the date registers once no update is in progress.
+ *   INPUTS: none
+ *   OUTPUTS: fields - seconds, minutes, hours, day, month, year as the chip keeps them
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: none
+ */
+static void cmos_read_date(uint8_t* fields){
+    static const uint8_t regs[CMOS_FIELDS] = {CMOS_SECONDS, CMOS_MINUTES, CMOS_HOURS, CMOS_DAY, CMOS_MONTH, CMOS_YEAR};
+    int i;
+
+    while (cmos_read(CMOS_STATUS_A) & CMOS_UIP);
+    for (i = 0; i < CMOS_FIELDS; i++){
+        fields[i] = cmos_read(regs[i]);
+    }
+}
+
+/*
+ * 	bcd_to_bin
+ *   DESCRIPTION: Converts a two digit bcd register.
+ *   INPUTS: value
+ *   OUTPUTS: none
+ *   RETURN VALUE: uint32_t - the binary value
+ *   SIDE EFFECTS: none
+ */
+static uint32_t bcd_to_bin(uint32_t value){
+    return (value & 0x0F) + (value >> 4) * 10;
+}
+
+/*
+ * 	rtc_read_time
+ *   DESCRIPTION: Reads the cmos date and converts it to seconds since 1970-01-01 00:00 UTC, assuming the
+ *                chip keeps UTC in the 2000s.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: uint32_t - unix time, to the second
+ *   SIDE EFFECTS: none
+ */
+uint32_t rtc_read_time(void){
+    static const uint16_t month_days[12] = {0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334};
+    uint8_t date[CMOS_FIELDS], check[CMOS_FIELDS];
+    uint32_t flags, status_b, sec, min, hour, day, month, year, days;
+    int i, same;
+
+    spin_lock_irqsave(&rtc_lock, flags);
+    cmos_read_date(date);
+    do{         // an update between the reads could mix two dates, read until two agree
+        cmos_read_date(check);
+        same = 1;
+        for (i = 0; i < CMOS_FIELDS; i++){
+            if (date[i] != check[i]){
+                same = 0;
+                date[i] = check[i];
+            }
+        }
+    } while (!same);
+    status_b = cmos_read(CMOS_STATUS_B);
+    spin_unlock_irqrestore(&rtc_lock, flags);
+
+    hour = date[2] & ~CMOS_PM;
+    sec = date[0];
+    min = date[1];
+    day = date[3];
+    month = date[4];
+    year = date[5];
+    if (!(status_b & CMOS_BINARY)){
+        sec = bcd_to_bin(sec);
+        min = bcd_to_bin(min);
+        hour = bcd_to_bin(hour);
+        day = bcd_to_bin(day);
+        month = bcd_to_bin(month);
+        year = bcd_to_bin(year);
+    }
+    if (!(status_b & CMOS_24HOUR)){
+        hour = (hour % 12) + ((date[2] & CMOS_PM) ? 12 : 0);
+    }
+    if (month < 1 || month > 12){
+        return 0;
+    }
+    year += CMOS_CENTURY;
+
+    // every fourth year is a leap year between 1901 and 2099
+    days = (year - 1970) * 365 + (year - 1969) / 4 + month_days[month - 1] + day - 1;
+    if (month > 2 && year % 4 == 0){
+        days++;
+    }
+    return days * SECS_PER_DAY + hour * 3600 + min * 60 + sec;
+}
@@ -8,11 +8,27 @@
 #define MIN_RTC_FREQ    2
 #define MIN_RTC_FREQ_BM 0xF
 
-volatile unsigned int rtc_interrupt_occurred;
+// cmos clock, read once at boot to seed the wall clock
+#define CMOS_INDEX      0x70
+#define CMOS_DATA       0x71
+#define CMOS_NMI_OFF    0x80
+#define CMOS_SECONDS    0x00
+#define CMOS_MINUTES    0x02
+#define CMOS_HOURS      0x04
+#define CMOS_DAY        0x07
+#define CMOS_MONTH      0x08
+#define CMOS_YEAR       0x09
+#define CMOS_STATUS_A   0x0A
+#define CMOS_STATUS_B   0x0B
+#define CMOS_UIP        0x80    // status A, the chip is updating the date registers
+#define CMOS_BINARY     0x04    // status B, registers hold binary instead of bcd
+#define CMOS_24HOUR     0x02    // status B
+#define CMOS_PM         0x80    // hour register in 12 hour mode
+#define CMOS_FIELDS     6
+#define CMOS_CENTURY    2000    // the year register only holds two digits
+#define SECS_PER_DAY    86400
+
 volatile unsigned int rtc_initialized;
-volatile unsigned int rtc_frequency;
-volatile unsigned int rtc_frequency_counter;
-volatile unsigned int rtc_frequency_counter_limit;
 
 extern void rtc_init();
 extern void rtc_handler();
@@ -20,6 +36,7 @@ extern int32_t rtc_read(int32_t fd, void* buf, int32_t nbytes);
 extern int32_t rtc_write(int32_t fd, const void* buf_arg, int32_t n);
 extern int32_t rtc_open(const uint8_t* filename);
 extern int32_t rtc_close(int32_t fd);
+extern uint32_t rtc_read_time(void);
 volatile unsigned int rtc_overall_tick_counter;
 
 #endif
@@ -1,8 +1,33 @@
 #include "scheduler.h"
 #include "system_calls.h"
 #include "terminal.h"
+#include "trace.h"
+#include "softirq.h"
+#include "timer.h"
+#include "apic.h"
 
-volatile int running_terminal = 0;
+static void pit_video_softirq();
+
+// run queues, one per cpu. A task is queued on the cpu it last ran on, a cpu with nothing of its own
+// to run steals from the busiest other queue
+run_queue_t run_queues[MAX_CPUS];
+
+// pit ticks a task may run before being preempted, lower priorities get longer slices
+static const uint32_t priority_timeslice[NUM_PRIORITIES] = {2, 5, 10};
+
+// pit ticks seen by the scheduler, and how many of them found the cpu halted with every task blocked
+volatile uint32_t sched_ticks = 0;
+volatile uint32_t sched_idle_ticks = 0;
+
+// time stamp counter rate, set once at boot by pit_calibrate_tsc
+uint32_t tsc_khz = 0;
+
+// tickless: the local apic one shot replaces the pit, armed for the next tick or timer and not at all
+// while the cpu idles with nothing due
+uint32_t tickless = 0;
+static uint64_t tick_cycles;
+volatile uint32_t tick_wakeups = 0;        // times the cpu left hlt
+volatile uint32_t tick_idle_stops = 0;     // times it went idle with no tick armed
 
 /* pit_init
 * INPUTS: none
@@ -11,90 +36,348 @@ volatile int running_terminal = 0;
 * DESCRIPTION: initializing pit chip (reference to OSDev)
 */
 void pit_init(){
+    softirq_register(SOFTIRQ_VIDEO, pit_video_softirq);
     enable_irq(0);
     //cli();
     int32_t div = PIT_INPUT_CLOCK/FREQ;
     outb(CMD_DATA, CMD_REG);
-    outb(div && BYTE_LOWER_MASK, CHANNEL0);
+    outb(div & BYTE_LOWER_MASK, CHANNEL0);
     outb(div >> 8, CHANNEL0);
     return;
 }
 
+/* pit_calibrate_wait
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: runs pit channel 2 as a CALIBRATE_MS one shot and spins until its output goes high,
+*              callers sample their counter right before. Channel 0 keeps running the scheduler tick,
+*              the speaker stays off. Interrupts must be off
+*/
+void pit_calibrate_wait(void){
+    uint32_t count = PIT_INPUT_CLOCK / (1000 / CALIBRATE_MS);
+
+    outb((inb(PIT_GATE_PORT) & ~0x02) | 0x01, PIT_GATE_PORT);
+    outb(CHANNEL2_ONESHOT, CMD_REG);
+    outb(count & BYTE_LOWER_MASK, CHANNEL2);
+    outb(count >> 8, CHANNEL2);        // counting starts once the high byte is in
+    while (!(inb(PIT_GATE_PORT) & 0x20));
+}
+
+/* pit_calibrate_tsc
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: tsc ticks per millisecond
+* DESCRIPTION: counts tsc cycles over the pit calibration one shot
+*/
+uint32_t pit_calibrate_tsc(void){
+    uint32_t flags;
+    uint64_t start;
+
+    cli_and_save(flags);
+    start = rdtsc();
+    pit_calibrate_wait();
+    tsc_khz = (uint32_t)(rdtsc() - start) / CALIBRATE_MS;
+    restore_flags(flags);
+    return tsc_khz;
+}
+
+/* tick_arm
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: arms the apic one shot for the next scheduler tick, or sooner when a timer expires
+*              first, on the running cpu. Interrupts must be off
+*/
+void tick_arm(){
+    uint64_t now = rdtsc();
+    uint64_t next = timer_next();
+
+    if (next > now + tick_cycles){
+        next = now + tick_cycles;
+    }
+    apic_timer_oneshot((next > now) ? next - now : 0);
+}
+
+/* tick_init
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: goes tickless when the local apic timer calibrates, the pit irq is masked from then on.
+*              Needs pit_calibrate_tsc and timer_init to have run
+*/
+void tick_init(){
+    uint32_t flags;
+
+    tick_cycles = ns_to_cycles(0, NSEC_PER_SEC / FREQ);
+    if (apic_init() == -1){
+        return;
+    }
+    cli_and_save(flags);
+    disable_irq(0);
+    tickless = 1;
+    tick_arm();
+    restore_flags(flags);
+}
+
+/* tick_eoi
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: ends the tick interrupt at whichever controller sent it
+*/
+static void tick_eoi(){
+    if (tickless){
+        apic_eoi();
+    }
+    else{
+        send_eoi(0);
+    }
+}
+
+/* tick_idle
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: called with interrupts off right before the cpu halts. Leaves only the next timer armed,
+*              unless a bottom half still needs ticks: a screen to copy or a base shell to start
+*/
+static void tick_idle(){
+    uint64_t now, next;
+
+    if (!tickless){
+        return;
+    }
+    if (terminal_shell_pending >= 0 || terminal_arr[terminal_id].vidmapped ||
+        terminal_arr[terminal_id].dirty_start < terminal_arr[terminal_id].dirty_end){
+        tick_arm();
+        return;
+    }
+    next = timer_next();
+    if (next == ~(uint64_t)0){
+        apic_timer_stop();
+        tick_idle_stops++;
+        return;
+    }
+    now = rdtsc();
+    apic_timer_oneshot((next > now) ? next - now : 0);
+}
+
+/* tick_wake
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: called with interrupts off once the cpu is out of hlt, the running task gets its tick back
+*/
+static void tick_wake(){
+    tick_wakeups++;
+    if (tickless){
+        tick_arm();
+    }
+}
+
+/* cpu_halt
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: halts until the next interrupt with the kernel lock dropped, so the other cpus can enter
+*              the kernel meanwhile. Called and returns with interrupts off. sti only takes effect after
+*              hlt so the wakeup interrupt cannot be missed
+*/
+static void cpu_halt(){
+    tick_idle();
+    this_cpu()->idle = 1;
+    kernel_exit(1);
+    asm volatile("sti; hlt" : : : "memory");
+    cli();
+    kernel_enter();
+    this_cpu()->idle = 0;
+    tick_wake();
+}
+
+/* pit_video_softirq
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: bottom half of the pit, copies what changed on the visible terminal to video memory
+*/
+static void pit_video_softirq(){
+    if (terminal_arr[terminal_id].vidmapped){       // writes through vidmap never mark the buffer dirty
+        video_sync_vidmap(terminal_id);
+    }
+    video_flush(terminal_id);        // bounds how long a lone putc stays off screen
+}
 
 /* pit_handler
 * INPUTS: none
 * OUTPUTS: none
 * RETURN: none
-* DESCRIPTION: handler for pit responsible for scheduling based on PIT interrupts
+* DESCRIPTION: handler for pit responsible for scheduling based on PIT interrupts, the screen update
+*              is left to the bottom half
 */
 void pit_handler(){
+    uint64_t start = rdtsc();
+    int32_t terminal;
+
     cli();
-    if((terminal_arr[running_terminal].curr_pcb == NULL)){      // base shell check
+    if (tickless){
+        tick_arm();
+    }
+    softirq_raise(SOFTIRQ_VIDEO);
+    timer_tick();       // sleepers are woken by the timer softirq
+    if (softirq_active){        // interrupted a bottom half, which has to finish on this stack first
+        tick_eoi();
+        softirq_top_time(SOFTIRQ_VIDEO, start);
+        sti();
+        return;
+    }
+    if (terminal_shell_pending >= 0 && (terminal = terminal_shell_take()) >= 0){      // alt+f on a terminal without a shell
+        tick_eoi();
+        sched_spawn_shell(terminal);        // returns once the interrupted task is scheduled again
         sti();
-        send_eoi(0);
         return;
     }
-  
+    softirq_top_time(SOFTIRQ_VIDEO, start);
+    if(pcb_ptr == NULL){      // no program has been started yet
+        sti();
+        tick_eoi();
+        return;
+    }
+
     scheduler();
     sti();
-    
+
     return;
 }
 
-/* scheduler
-* INPUTS: none
+/* rq_push
+* INPUTS: task
 * OUTPUTS: none
 * RETURN: none
-* DESCRIPTION: helper called by pit_handler, responsible for scheduling
+* DESCRIPTION: marks the task ready and appends it to the run queue of its priority on the cpu it last
+*              ran on, where its cache lines still are, and wakes a halted cpu to take it. Interrupts
+*              must be off
 */
-void scheduler(){
-    cli();
+static void rq_push(pcb_t* task){
+    run_queue_t* rq = &run_queues[task->cpu];
 
-    int prev_terminal = running_terminal;
-    register uint32_t local_esp_saved asm("esp");       // saving context switch information
-    terminal_arr[prev_terminal].esp_saved = local_esp_saved;
-    register uint32_t local_ebp_saved asm("ebp");
-    terminal_arr[prev_terminal].ebp_saved = local_ebp_saved;
-
-    int temp_terminal = (1 + running_terminal) % 3;         // updating terminal to schedule on
-    pcb_t* temp_pcb = terminal_arr[temp_terminal].curr_pcb;
-    
-    if ((temp_pcb == NULL) || (temp_pcb->parent_pid < 0)){
-        temp_terminal = (2 + running_terminal) % 3;
-        temp_pcb = terminal_arr[temp_terminal].curr_pcb;
-        if((temp_pcb == NULL) || (temp_pcb->parent_pid < 0)) {      // base shell check
-            send_eoi(0);        // IRQ for PIT
-            sti();
-            return;
-        }
+    task->state = TASK_READY;
+    task->queue_next = NULL;
+    if (rq->tail[task->priority] == NULL){
+        rq->head[task->priority] = task;
     }
-    
-    int next_terminal = temp_terminal;
+    else{
+        rq->tail[task->priority]->queue_next = task;
+    }
+    rq->tail[task->priority] = task;
+    rq->ready++;
+    smp_kick_idle(task->cpu);
+}
 
-    terminal_arr[prev_terminal].esp0_term = tss.esp0;
-    terminal_arr[prev_terminal].ss0_term = tss.ss0;
+/* rq_take
+* INPUTS: rq
+* OUTPUTS: none
+* RETURN: the first ready task of the highest non-empty priority of rq, NULL if it is empty
+* DESCRIPTION: removes the next task to run from a run queue, interrupts must be off
+*/
+static pcb_t* rq_take(run_queue_t* rq){
+    pcb_t* task;
+    int i;
+    for (i = 0; i < NUM_PRIORITIES; i++){
+        task = rq->head[i];
+        if (task != NULL){
+            rq->head[i] = task->queue_next;
+            if (rq->head[i] == NULL){
+                rq->tail[i] = NULL;
+            }
+            task->queue_next = NULL;
+            rq->ready--;
+            return task;
+        }
+    }
+    return NULL;
+}
 
-    flush_tlb(terminal_arr[next_terminal].curr_pid);            // flushing tlb and mapping memory for the next terminal
+/* rq_steal
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: a task taken from the busiest other cpu, NULL if every queue is empty
+* DESCRIPTION: work stealing for a cpu whose own queue ran dry. The victim loses the task it would have
+*              run next, task_resume moves it over. Interrupts must be off
+*/
+static pcb_t* rq_steal(){
+    uint32_t self = this_cpu()->id;
+    uint32_t i, victim = self;
+    pcb_t* task;
 
-    if (terminal_id == next_terminal){      // if upcoming terminal is the same as current terminal, write to video memory
-        schedule_visible_page();
+    for (i = 0; i < smp_cpus; i++){
+        if (i != self && run_queues[i].ready > 0 &&
+            (victim == self || run_queues[i].ready > run_queues[victim].ready)){
+            victim = i;
+        }
+    }
+    if (victim == self){
+        return NULL;
     }
-    else{                                   // else write to corresponding build buffer
-        schedule_invisible_page(terminal_arr[next_terminal].vmem_location);
+    task = rq_take(&run_queues[victim]);
+    run_queues[self].steals++;
+    return task;
+}
+
+/* rq_pop
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: the next task for this cpu to run, NULL if nothing is ready anywhere
+* DESCRIPTION: takes from this cpu's own run queue first and steals when it is empty, interrupts must be off
+*/
+static pcb_t* rq_pop(){
+    pcb_t* task = rq_take(&run_queues[this_cpu()->id]);
+
+    if (task == NULL && smp_cpus > 1){
+        task = rq_steal();
     }
+    return task;
+}
 
-    // setting esp, ebp for new process that must be run
-    uint32_t temp_esp, temp_ebp = 0;
-    temp_esp = terminal_arr[next_terminal].esp_saved;
-    temp_ebp = terminal_arr[next_terminal].ebp_saved;
+/* rq_higher_ready
+* INPUTS: priority
+* OUTPUTS: none
+* RETURN: 1 if a task of a higher priority than the given one is ready on this cpu, 0 otherwise
+* DESCRIPTION: used to preempt a task as soon as an interactive task wakes up
+*/
+static int rq_higher_ready(uint32_t priority){
+    run_queue_t* rq = &run_queues[this_cpu()->id];
+    uint32_t i;
+    for (i = 0; i < priority; i++){
+        if (rq->head[i] != NULL){
+            return 1;
+        }
+    }
+    return 0;
+}
 
-    tss.esp0 = terminal_arr[next_terminal].esp0_term;           // saving context switch information
-    tss.ss0 = terminal_arr[next_terminal].ss0_term;
+/* task_resume
+* INPUTS: next
+* OUTPUTS: none
+* RETURN: none (never returns)
+* DESCRIPTION: makes next the running task and continues it where it last left switch_to, from
+*              whatever stack the caller is on. Interrupts must be off
+*/
+static void __attribute__((noinline)) task_resume(pcb_t* next){
+    TRACE(TRACE_SWITCH, next->pid);
+    next->state = TASK_RUNNING;
+    next->timeslice = priority_timeslice[next->priority];
+    next->cpu = this_cpu()->id;
+    pcb_ptr = next;
+    global_pid = next->pid;
+    running_terminal = next->terminal;
 
-    running_terminal = next_terminal;
+    flush_tlb(next->pid);            // flushing tlb and mapping memory for the next task
+    vidmem_switch(terminal_arr[next->terminal].vidmapped ? terminal_arr[next->terminal].vidmap_location : 0);
+    fpu_switch(next);                // cr0.ts defers the restore to the first fpu instruction
 
-    send_eoi(0);        // IRQ for PIT
-    sti();
+    this_cpu()->tss->esp0 = next->parent_esp0;    // kernel stack of the next task, recorded by execute
+    this_cpu()->tss->ss0 = next->parent_ss0;
 
     // inline assembly to update esp, ebp
     asm volatile(" \n\
@@ -106,10 +389,362 @@ void scheduler(){
         ret \n\
         "
         :
-        : "r"(temp_esp), "r"(temp_ebp)
+        : "r"(next->esp_saved), "r"(next->ebp_saved)
         : "cc"
     );
+}
 
-    return;
+/* switch_to
+* INPUTS: next
+* OUTPUTS: none
+* RETURN: none (returns when the current task is scheduled again)
+* DESCRIPTION: saves the context of the running task and resumes next where it last left switch_to,
+*              interrupts must be off
+*/
+static void __attribute__((noinline)) switch_to(pcb_t* next){
+    pcb_t* prev = pcb_ptr;
+
+    register uint32_t local_esp_saved asm("esp");       // saving context switch information
+    prev->esp_saved = local_esp_saved;
+    register uint32_t local_ebp_saved asm("ebp");
+    prev->ebp_saved = local_ebp_saved;
+
+    task_resume(next);
+}
+
+/* scheduler
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: helper called by pit_handler, charges the tick to the running task and switches to the
+*              next ready task once its time slice is used up or a higher priority task is ready
+*/
+void scheduler(){
+    cli();
+
+    pcb_t* curr = pcb_ptr;
+    pcb_t* next;
+
+    sched_ticks++;
+    this_cpu()->ticks++;
+    if (curr->state == TASK_BLOCKED){       // tick landed in the idle hlt of a sleeping task
+        sched_idle_ticks++;
+    }
+
+    if (curr->state == TASK_RUNNING){
+        if (curr->timeslice > 0){
+            curr->timeslice--;
+        }
+        if (curr->timeslice > 0 && !rq_higher_ready(curr->priority)){      // keep running
+            tick_eoi();
+            sti();
+            return;
+        }
+    }
+
+    if (curr->state == TASK_RUNNING){       // only a cpu that would idle steals, a busy one keeps its cache
+        next = rq_take(&run_queues[this_cpu()->id]);
+    }
+    else{
+        next = rq_pop();
+    }
+    if (next == NULL){          // nothing else is ready, the current task keeps the cpu
+        curr->timeslice = priority_timeslice[curr->priority];
+        tick_eoi();
+        sti();
+        return;
+    }
+
+    if (curr->state == TASK_RUNNING){
+        if (curr->timeslice == 0 && curr->priority < NUM_PRIORITIES - 1){      // used the whole slice, treat as cpu bound
+            curr->priority++;
+        }
+        rq_push(curr);
+    }
+
+    tick_eoi();
+    switch_to(next);
+    sti();
+}
+
+/* sched_task_init
+* INPUTS: task, terminal
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: sets up the scheduling fields of a task that starts running right away on the given terminal
+*/
+void sched_task_init(pcb_t* task, uint32_t terminal){
+    task->state = TASK_RUNNING;
+    task->priority = PRIO_NORMAL;
+    task->timeslice = priority_timeslice[PRIO_NORMAL];
+    task->terminal = terminal;
+    task->cpu = this_cpu()->id;
+    task->wait_queue = NULL;
+    task->queue_next = NULL;
+}
+
+/* wait_queue_init
+* INPUTS: wq
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: empties a wait queue
+*/
+void wait_queue_init(wait_queue_t* wq){
+    wq->head = NULL;
+}
+
+/* wait_queue_remove
+* INPUTS: wq, task
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: unlinks a task from a wait queue if it is on it, interrupts must be off
+*/
+static void wait_queue_remove(wait_queue_t* wq, pcb_t* task){
+    pcb_t* prev;
+
+    if (wq->head == task){
+        wq->head = task->queue_next;
+        task->queue_next = NULL;
+        return;
+    }
+    for (prev = wq->head; prev != NULL; prev = prev->queue_next){
+        if (prev->queue_next == task){
+            prev->queue_next = task->queue_next;
+            task->queue_next = NULL;
+            return;
+        }
+    }
+}
+
+/* sleep_on
+* INPUTS: wq - queue of the event the task waits for
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: takes the running task off the cpu until wake_up is called on wq. Must be called with
+*              interrupts off and returns with interrupts off, callers re-check their condition in a loop.
+*              When nothing else is ready the cpu halts until the next interrupt instead
+*/
+void sleep_on(wait_queue_t* wq){
+    pcb_t* curr = pcb_ptr;
+    pcb_t* last;
+    pcb_t* next;
+
+    if (curr != NULL){
+        curr->state = TASK_BLOCKED;
+        curr->wait_queue = wq;
+        curr->queue_next = NULL;
+        if (wq->head == NULL){
+            wq->head = curr;
+        }
+        else{                       // FIFO so waiters are woken in the order they slept
+            for (last = wq->head; last->queue_next != NULL; last = last->queue_next){}
+            last->queue_next = curr;
+        }
+
+        next = rq_pop();
+        if (next != NULL){
+            switch_to(next);
+            return;
+        }
+    }
+
+    cpu_halt();
+
+    if (curr != NULL && curr->state == TASK_BLOCKED){       // some other interrupt, the caller re-checks and sleeps again
+        wait_queue_remove(wq, curr);
+        curr->state = TASK_RUNNING;
+        curr->wait_queue = NULL;
+    }
 }
 
+/* wake_up
+* INPUTS: wq
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: makes every task sleeping on wq ready again, woken tasks get the highest priority
+*/
+void wake_up(wait_queue_t* wq){
+    uint32_t flags;
+    pcb_t* task;
+
+    cli_and_save(flags);
+    while (wq->head != NULL){
+        task = wq->head;
+        wq->head = task->queue_next;
+        task->queue_next = NULL;
+        task->wait_queue = NULL;
+        task->priority = PRIO_HIGH;         // blocked before using its slice, treat as interactive
+        if (cpus[task->cpu].current == task){       // halted in sleep_on with nothing else to run
+            task->state = TASK_RUNNING;
+            smp_kick(task->cpu);
+        }
+        else{
+            rq_push(task);
+        }
+    }
+    restore_flags(flags);
+}
+
+/* spawn_shell
+* INPUTS: terminal
+* OUTPUTS: none
+* RETURN: none (returns when the interrupted task is scheduled again)
+* DESCRIPTION: saves the running task like switch_to does and starts a base shell on the terminal
+*/
+static void __attribute__((noinline)) spawn_shell(uint32_t terminal){
+    pcb_t* prev = pcb_ptr;
+
+    if (prev != NULL){
+        register uint32_t local_esp_saved asm("esp");       // saving context switch information
+        prev->esp_saved = local_esp_saved;
+        register uint32_t local_ebp_saved asm("ebp");
+        prev->ebp_saved = local_ebp_saved;
+        if (prev->state == TASK_RUNNING){
+            rq_push(prev);
+        }
+    }
+
+    running_terminal = terminal;
+    execute((uint8_t*)"shell");
+}
+
+/* sched_spawn_shell
+* INPUTS: terminal
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: starts the base shell of a terminal that has none, the interrupted task goes back in the run queue
+*/
+void sched_spawn_shell(uint32_t terminal){
+    cli();
+    spawn_shell(terminal);
+}
+
+/* sched_start
+* INPUTS: task
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: puts a task built by spawn on the run queue, it first runs from the frame spawn left
+*              at the top of its kernel stack
+*/
+void sched_start(pcb_t* task){
+    uint32_t flags;
+
+    cli_and_save(flags);
+    rq_push(task);
+    restore_flags(flags);
+}
+
+/* sched_idle
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: none (never returns)
+* DESCRIPTION: halts on the cpu's idle stack until an interrupt makes a task ready and resumes it
+*/
+static void __attribute__((noinline)) sched_idle(){
+    pcb_t* next;
+
+    while (1){
+        cpu_halt();
+        next = rq_pop();
+        if (next != NULL){
+            task_resume(next);
+        }
+    }
+}
+
+/* sched_exit
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: none (never returns)
+* DESCRIPTION: gives the cpu away for good, used by halt for tasks nobody waits on and by a cpu that just
+*              started. Interrupts must be off since the caller may still run on its freed kernel stack.
+*              The cpu waits on its own idle stack when nothing is ready
+*/
+void sched_exit(){
+    pcb_t* next;
+
+    pcb_ptr = NULL;
+    next = rq_pop();
+    if (next != NULL){
+        task_resume(next);
+    }
+
+    asm volatile("              \n\
+        movl %0, %%esp          \n\
+        xorl %%ebp, %%ebp       \n\
+        call *%1                \n\
+        "
+        :
+        : "g"(this_cpu()->idle_stack), "r"(sched_idle)
+        : "memory"
+    );
+}
+
+/* tick_open
+* INPUTS: filename
+* OUTPUTS: none
+* RETURN: 0
+* DESCRIPTION: nothing to set up
+*/
+int32_t tick_open(const uint8_t* filename){
+    return 0;
+}
+
+/* tick_close
+* INPUTS: fd
+* OUTPUTS: none
+* RETURN: 0
+* DESCRIPTION: nothing to release
+*/
+int32_t tick_close(int32_t fd){
+    return 0;
+}
+
+/* tick_read
+* INPUTS: fd, buf, nbytes
+* OUTPUTS: one counter per line in buf: whether the apic drives the tick, cpus running, scheduler ticks,
+*          ticks that found the cpu idle, wakeups from hlt, idle periods with no tick armed, tasks stolen
+*          from another cpu's run queue, then milliseconds since boot
+* RETURN: bytes read, 0 at the end of the file
+* DESCRIPTION: the "ticks" file. Reading it twice gives the wakeup rate over the time in between
+*/
+int32_t tick_read(int32_t fd, void* buf, int32_t nbytes){
+    static const uint8_t width = 10;
+    static const int8_t* names[TICK_LINES] = {"tickless", "cpus    ", "ticks   ", "idle    ", "wakeups ", "stops   ", "steals  ", "ms      "};
+    uint32_t values[TICK_LINES];
+    uint8_t line[TICK_LINE_LEN];
+    uint8_t* out = (uint8_t*)buf;
+    uint32_t pos = pcb_ptr->fd_array[fd].fpos;
+    uint32_t copied = 0;
+    uint32_t offset, len, i;
+
+    if (buf == NULL || nbytes < 0){
+        return -1;
+    }
+    values[0] = tickless;
+    values[1] = smp_cpus;
+    values[2] = sched_ticks;
+    values[3] = sched_idle_ticks;
+    values[4] = tick_wakeups;
+    values[5] = tick_idle_stops;
+    values[6] = 0;
+    for (i = 0; i < smp_cpus; i++){
+        values[6] += run_queues[i].steals;
+    }
+    values[7] = (tsc_khz != 0) ? udiv64_sat(rdtsc(), tsc_khz) : 0;
+
+    while (copied < nbytes && pos < TICK_LINES * TICK_LINE_LEN){
+        put_stat_line(line, names[pos / TICK_LINE_LEN], &values[pos / TICK_LINE_LEN], &width, 1);
+
+        offset = pos % TICK_LINE_LEN;
+        len = TICK_LINE_LEN - offset;
+        if (len > nbytes - copied){
+            len = nbytes - copied;
+        }
+        memcpy(out + copied, line + offset, len);
+        copied += len;
+        pos += len;
+    }
+    pcb_ptr->fd_array[fd].fpos = pos;
+    return copied;
+}
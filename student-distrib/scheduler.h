@@ -1,9 +1,18 @@
 #if !defined(SCHEDULER_H)
 #define SCHEDULER_H
 
+struct pcb_struct;
+
+// tasks sleeping until the same event, linked through pcb->queue_next
+typedef struct wait_queue_struct
+{
+    struct pcb_struct* head;
+} wait_queue_t;
+
 #include "lib.h"
 #include "i8259.h"
 #include "x86_desc.h"
+#include "smp.h"
 
 #define PIT_INPUT_CLOCK 1193180
 #define FREQ 100
@@ -11,11 +20,64 @@
 #define CMD_REG 0x43
 #define BYTE_LOWER_MASK 0xFF
 #define CHANNEL0 0x40
+#define CHANNEL2 0x42
+#define PIT_GATE_PORT 0x61         // bit 0 gates channel 2, bit 5 reads its output
+#define CHANNEL2_ONESHOT 0xB0      // channel 2, low then high byte, mode 0
+#define CALIBRATE_MS 10
+
+// task states
+#define TASK_RUNNING 0
+#define TASK_READY 1
+#define TASK_BLOCKED 2
+#define TASK_WAITING 3      // parent waiting in execute for its child to halt
+
+// task priorities, 0 is the highest
+#define PRIO_HIGH 0
+#define PRIO_NORMAL 1
+#define PRIO_LOW 2
+#define NUM_PRIORITIES 3
+
+// ready tasks of one cpu: a FIFO per priority level, linked through pcb->queue_next
+typedef struct run_queue_struct
+{
+    struct pcb_struct* head[NUM_PRIORITIES];
+    struct pcb_struct* tail[NUM_PRIORITIES];
+    uint32_t ready;             // tasks on the queue, how busy a thief finds it
+    uint32_t steals;            // tasks this cpu took from the others' queues
+} run_queue_t;
+
+#define IDLE_STACK_WORDS 1024       // stack of the cpu while no task exists to run on
+
+#define TICK_LINES 8
+#define TICK_LINE_LEN 20            // bytes per counter when the ticks file is read
 
 void pit_init();
 void pit_handler();
+void pit_calibrate_wait(void);
+uint32_t pit_calibrate_tsc(void);
+void tick_init();
+void tick_arm();
 void scheduler();
 
-extern volatile int running_terminal;
+void sched_task_init(struct pcb_struct* task, uint32_t terminal);
+void wait_queue_init(wait_queue_t* wq);
+void sleep_on(wait_queue_t* wq);
+void wake_up(wait_queue_t* wq);
+void sched_spawn_shell(uint32_t terminal);
+void sched_start(struct pcb_struct* task);
+void sched_exit();
+
+int32_t tick_open(const uint8_t* filename);
+int32_t tick_close(int32_t fd);
+int32_t tick_read(int32_t fd, void* buf, int32_t nbytes);
+
+#define running_terminal (this_cpu()->terminal)        // terminal of the task this cpu runs
+extern run_queue_t run_queues[MAX_CPUS];
+extern volatile uint32_t sched_ticks;
+extern volatile uint32_t sched_idle_ticks;
+extern uint32_t tsc_khz;
+extern uint32_t tickless;
+extern volatile uint32_t tick_wakeups;
+extern volatile uint32_t tick_idle_stops;
 
 #endif
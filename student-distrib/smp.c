@@ -0,0 +1,451 @@
+#include "smp.h"
+#include "lib.h"
+#include "apic.h"
+#include "ioapic.h"
+#include "frame.h"
+#include "timer.h"
+#include "scheduler.h"
+#include "system_calls.h"
+#include "fpu.h"
+
+#define AP_TSS_OFFSET 128           // an application processor's tss, after its gdt in the same frame
+
+cpu_t cpus[MAX_CPUS];
+uint32_t smp_cpus = 1;              // cpus running, the boot cpu is cpus[0]
+static uint32_t mp_cpus = 1;        // enabled cpus the MP table lists
+
+// big kernel lock: user programs run on every cpu, the kernel on one at a time. The boot cpu holds it
+// until the first program starts
+static volatile uint32_t bkl = 1;
+volatile uint32_t bkl_waits = 0;    // kernel entries that found another cpu in the kernel
+
+// the boot cpu waits here when every task is blocked, the others get a frame each
+static uint32_t boot_idle_stack[IDLE_STACK_WORDS];
+
+// the cpu smp_init is starting, ap_main picks it up
+static cpu_t* volatile ap_boot_cpu;
+
+extern uint8_t ap_trampoline[];
+extern uint8_t ap_trampoline_end[];
+extern uint32_t ap_boot_esp;
+extern uint32_t ap_boot_cr3;
+
+/* percpu_desc_set
+* INPUTS: desc - gdt entry, cpu
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: builds the data segment %gs uses, based at the cpu's cpu_t
+*/
+static void percpu_desc_set(seg_desc_t* desc, cpu_t* cpu){
+    seg_desc_t the_percpu_desc;
+    the_percpu_desc.granularity = 0x0;
+    the_percpu_desc.opsize      = 0x1;
+    the_percpu_desc.reserved    = 0x0;
+    the_percpu_desc.avail       = 0x0;
+    the_percpu_desc.present     = 0x1;
+    the_percpu_desc.dpl         = 0x0;
+    the_percpu_desc.sys         = 0x1;
+    the_percpu_desc.type        = 0x2;         // read/write data
+
+    SET_TSS_PARAMS(the_percpu_desc, cpu, sizeof(cpu_t) - 1);
+    *desc = the_percpu_desc;
+}
+
+/* tss_desc_set
+* INPUTS: desc - gdt entry, tss
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: builds a tss descriptor the way entry does for the boot cpu
+*/
+static void tss_desc_set(seg_desc_t* desc, tss_t* tss){
+    seg_desc_t the_tss_desc;
+    the_tss_desc.granularity   = 0x0;
+    the_tss_desc.opsize        = 0x0;
+    the_tss_desc.reserved      = 0x0;
+    the_tss_desc.avail         = 0x0;
+    the_tss_desc.present       = 0x1;
+    the_tss_desc.dpl           = 0x0;
+    the_tss_desc.sys           = 0x0;
+    the_tss_desc.type          = 0x9;
+
+    SET_TSS_PARAMS(the_tss_desc, tss, TSS_SIZE - 1);
+    *desc = the_tss_desc;
+}
+
+/* smp_boot_cpu
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: makes the boot cpu cpus[0] and points %gs at it. Runs first in entry, everything that
+*              reads pcb_ptr, global_pid or running_terminal goes through %gs
+*/
+void smp_boot_cpu(void){
+    cpu_t* cpu = &cpus[0];
+
+    cpu->self = cpu;
+    cpu->id = 0;
+    cpu->tss = &tss;
+    cpu->gdt = gdt;
+    cpu->page_dir = pde;
+    cpu->vidmap_table = vidmem_pte;
+    cpu->idle_stack = &boot_idle_stack[IDLE_STACK_WORDS];
+    cpu->online = 1;
+    cpu->bkl_held = 1;
+    percpu_desc_set(&gdt[KERNEL_PERCPU >> 3], cpu);
+    load_percpu();
+}
+
+/* mp_checksum
+* INPUTS: start, len
+* OUTPUTS: none
+* RETURN: byte sum of the range, 0 for a valid MP structure
+* DESCRIPTION: both MP structures carry a byte that makes them sum to 0
+*/
+static uint8_t mp_checksum(const void* start, uint32_t len){
+    const uint8_t* p = (const uint8_t*)start;
+    uint8_t sum = 0;
+
+    while (len-- > 0){
+        sum += *p++;
+    }
+    return sum;
+}
+
+/* mp_scan
+* INPUTS: start, len - physical range
+* OUTPUTS: none
+* RETURN: the MP floating pointer in the range, NULL if there is none
+* DESCRIPTION: the structure sits on a 16 byte boundary
+*/
+static mp_float_t* mp_scan(uint32_t start, uint32_t len){
+    uint32_t addr;
+    mp_float_t* mp;
+
+    for (addr = start; addr + sizeof(mp_float_t) <= start + len; addr += 16){
+        mp = (mp_float_t*)addr;
+        if (mp->signature == MP_FLOAT_SIG && mp->length == 1 && mp_checksum(mp, sizeof(mp_float_t)) == 0){
+            return mp;
+        }
+    }
+    return NULL;
+}
+
+/* mp_find
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: the MP floating pointer, NULL on a machine without one
+* DESCRIPTION: looks where the MP spec says to: the first KB of the ebda, the last KB of base memory,
+*              then the bios rom
+*/
+static mp_float_t* mp_find(void){
+    uint32_t ebda = (uint32_t)(*(volatile uint16_t*)BDA_EBDA_SEGMENT) << 4;
+    mp_float_t* mp;
+
+    if (ebda != 0 && (mp = mp_scan(ebda, 1024)) != NULL){
+        return mp;
+    }
+    if ((mp = mp_scan(BASE_MEM_LAST_KB, 1024)) != NULL){
+        return mp;
+    }
+    return mp_scan(BIOS_ROM_START, BIOS_ROM_END - BIOS_ROM_START);
+}
+
+/* mp_init
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: reads the MP configuration table for the cpus, the io apic and how the isa irqs are wired
+*              to it. Runs before paging is on, the tables are in low memory initialize_paging leaves out
+*/
+void mp_init(void){
+    mp_float_t* mp = mp_find();
+    mp_config_t* config;
+    mp_processor_t* proc;
+    mp_intr_t* intr;
+    uint8_t* entry;
+    uint32_t i;
+    int32_t isa_bus = -1;
+    int32_t ioapic = -1;
+
+    if (mp == NULL || mp->default_config != 0 || mp->config == 0 || mp->config >= LOW_MEM_END){
+        return;
+    }
+    config = (mp_config_t*)mp->config;
+    if (config->signature != MP_CONFIG_SIG || mp_checksum(config, config->length) != 0){
+        return;
+    }
+
+    entry = (uint8_t*)(config + 1);
+    for (i = 0; i < config->entry_count; i++){
+        switch (*entry){
+            case MP_PROCESSOR:
+                proc = (mp_processor_t*)entry;
+                if (!(proc->flags & MP_CPU_ENABLED)){
+                    break;
+                }
+                if (proc->flags & MP_CPU_BSP){
+                    cpus[0].apic_id = proc->apic_id;
+                }
+                else if (mp_cpus < MAX_CPUS){
+                    cpus[mp_cpus].id = mp_cpus;
+                    cpus[mp_cpus].apic_id = proc->apic_id;
+                    mp_cpus++;
+                }
+                break;
+            case MP_BUS:
+                if (strncmp((int8_t*)((mp_bus_t*)entry)->bus_type, "ISA", 3) == 0){
+                    isa_bus = ((mp_bus_t*)entry)->bus_id;
+                }
+                break;
+            case MP_IOAPIC:
+                if (ioapic < 0 && (((mp_ioapic_t*)entry)->flags & MP_IOAPIC_ENABLED)){
+                    ioapic = ((mp_ioapic_t*)entry)->apic_id;
+                    ioapic_set_base(((mp_ioapic_t*)entry)->addr);
+                }
+                break;
+            case MP_IOINTR:
+                intr = (mp_intr_t*)entry;
+                if (intr->intr_type == MP_INTR_INT && intr->src_bus == isa_bus && intr->dst_apic == ioapic){
+                    ioapic_set_irq(intr->src_irq, intr->dst_pin, intr->flags);
+                }
+                break;
+            case MP_LOCALINTR:
+                break;
+            default:            // unknown entry, its length is unknown too
+                return;
+        }
+        entry += (*entry == MP_PROCESSOR) ? MP_PROCESSOR_LEN : MP_ENTRY_LEN;
+    }
+}
+
+/* smp_delay
+* INPUTS: nsec
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: spins on the time stamp counter, for the waits of the startup sequence
+*/
+static void smp_delay(uint32_t nsec){
+    uint64_t end = rdtsc() + ns_to_cycles(0, nsec);
+
+    while (rdtsc() < end){
+        cpu_relax();
+    }
+}
+
+/* cpu_prepare
+* INPUTS: cpu
+* OUTPUTS: none
+* RETURN: 0 on success, -1 if memory is exhausted
+* DESCRIPTION: gives an application processor a frame for its gdt and tss, a copy of the kernel page
+*              directory, its own 132 MB page table and an idle stack. Its gdt is the boot cpu's with its own tss and %gs
+*/
+static int32_t cpu_prepare(cpu_t* cpu){
+    uint32_t desc_frame = frame_alloc();
+    uint32_t dir_frame = frame_alloc();
+    uint32_t table_frame = frame_alloc();
+    uint32_t stack_frame = frame_alloc();
+
+    if (desc_frame == 0 || dir_frame == 0 || table_frame == 0 || stack_frame == 0){
+        if (desc_frame != 0){
+            frame_free(desc_frame);
+        }
+        if (dir_frame != 0){
+            frame_free(dir_frame);
+        }
+        if (table_frame != 0){
+            frame_free(table_frame);
+        }
+        if (stack_frame != 0){
+            frame_free(stack_frame);
+        }
+        return -1;
+    }
+
+    cpu->self = cpu;
+    cpu->gdt = (seg_desc_t*)desc_frame;
+    cpu->tss = (tss_t*)(desc_frame + AP_TSS_OFFSET);
+    memcpy(cpu->gdt, gdt, GDT_ENTRIES * sizeof(seg_desc_t));
+    memset(cpu->tss, 0, sizeof(tss_t));
+    cpu->tss->ss0 = KERNEL_DS;
+    tss_desc_set(&cpu->gdt[KERNEL_TSS >> 3], cpu->tss);
+    percpu_desc_set(&cpu->gdt[KERNEL_PERCPU >> 3], cpu);
+
+    memcpy((void*)dir_frame, pde, FRAME_SIZE);
+    cpu->page_dir = (page_dir_entry_t*)dir_frame;
+    cpu->vidmap_table = (page_table_entry_t*)table_frame;
+    vidmap_table_init(cpu->page_dir, cpu->vidmap_table);
+    cpu->idle_stack = (uint32_t*)(stack_frame + FRAME_SIZE);
+    return 0;
+}
+
+/* smp_init
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: moves the isa irqs to the io apic and starts every other cpu the MP table lists with
+*              init, startup, startup. Needs the apic one shot running, it is the only tick the other
+*              cpus get. Called last in entry with the kernel lock held, so the cpus wait in ap_main
+*              until the first program runs
+*/
+void smp_init(void){
+    cpu_t* cpu;
+    uint64_t deadline;
+    uint32_t i;
+
+    if (mp_cpus < 2 || !tickless){
+        return;
+    }
+    cpus[0].apic_id = apic_id();
+    if (ioapic_init(cpus[0].apic_id) == -1){
+        return;
+    }
+    apic_lint0_mask();
+
+    low_page_map(AP_TRAMPOLINE);
+    memcpy((void*)AP_TRAMPOLINE, ap_trampoline, ap_trampoline_end - ap_trampoline);
+
+    for (i = 1; i < mp_cpus; i++){
+        cpu = &cpus[i];
+        if (cpu_prepare(cpu) == -1){
+            break;
+        }
+        ap_boot_cpu = cpu;
+        ap_boot_esp = (uint32_t)cpu->idle_stack;
+        ap_boot_cr3 = (uint32_t)cpu->page_dir;
+
+        apic_send_ipi(cpu->apic_id, ICR_INIT);
+        smp_delay(INIT_DELAY_NS);
+        apic_send_ipi(cpu->apic_id, ICR_STARTUP | (AP_TRAMPOLINE >> 12));
+        smp_delay(SIPI_DELAY_NS);
+        if (!cpu->online){
+            apic_send_ipi(cpu->apic_id, ICR_STARTUP | (AP_TRAMPOLINE >> 12));
+        }
+
+        deadline = rdtsc() + ns_to_cycles(0, AP_START_WAIT_NS);
+        while (!cpu->online && rdtsc() < deadline){
+            cpu_relax();
+        }
+        if (!cpu->online){
+            printf("cpu %d (apic %d) did not start\n", i, cpu->apic_id);
+            break;
+        }
+        smp_cpus++;
+    }
+    printf("smp: %d of %d cpus running\n", smp_cpus, mp_cpus);
+}
+
+/* ap_main
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: none (never returns)
+* DESCRIPTION: C entry of an application processor, on its idle stack with paging on. Loads its own
+*              gdt, tss and %gs, then takes the kernel lock and goes idle until there is a task to run
+*/
+void ap_main(void){
+    cpu_t* cpu = ap_boot_cpu;
+    x86_desc_t gdtr;
+
+    gdtr.size = GDT_ENTRIES * sizeof(seg_desc_t) - 1;
+    gdtr.addr = (uint32_t)cpu->gdt;
+    asm volatile ("lgdt (%0)" : : "r"(&gdtr.size) : "memory");
+    ltr(KERNEL_TSS);
+    load_percpu();
+    lidt(idt_desc_ptr);
+
+    apic_ap_init();
+    sysenter_init();
+    fpu_init();
+    cpu->online = 1;
+
+    kernel_enter();
+    tick_arm();
+    sched_exit();
+}
+
+/* kernel_enter
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: 1 if this took the kernel lock, 0 if the cpu already held it
+* DESCRIPTION: called first by every way into the kernel. Reloads %gs, which the return to user mode
+*              clears, and takes the kernel lock unless the cpu interrupted itself in the kernel. The
+*              result goes to kernel_exit on the way out
+*/
+uint32_t kernel_enter(void){
+    uint32_t flags;
+    uint32_t waited = 0;
+    cpu_t* cpu;
+
+    cli_and_save(flags);        // the lock and bkl_held change together, and the task cannot move cpus
+    load_percpu();
+    cpu = this_cpu();
+    if (cpu->bkl_held){
+        restore_flags(flags);
+        return 0;
+    }
+    while (xchg(&bkl, 1)){
+        waited = 1;
+        while (bkl){
+            cpu_relax();
+        }
+    }
+    cpu->bkl_held = 1;
+    bkl_waits += waited;
+    restore_flags(flags);
+    return 1;
+}
+
+/* kernel_exit
+* INPUTS: taken - what the matching kernel_enter returned
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: drops the kernel lock if the matching entry took it
+*/
+void kernel_exit(uint32_t taken){
+    uint32_t flags;
+
+    if (!taken){
+        return;
+    }
+    cli_and_save(flags);
+    this_cpu()->bkl_held = 0;
+    barrier();
+    bkl = 0;
+    restore_flags(flags);
+}
+
+/* smp_kick
+* INPUTS: id - cpu index
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: gets another cpu out of hlt to look at the run queue or its halted task again
+*/
+void smp_kick(uint32_t id){
+    if (id != this_cpu()->id && cpus[id].online){
+        apic_send_ipi(cpus[id].apic_id, ICR_FIXED | APIC_IPI_VECTOR);
+    }
+}
+
+/* smp_kick_idle
+* INPUTS: id - cpu whose run queue just got a task
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: called when a task becomes ready, wakes the cpu it was queued on if that one is halted,
+*              or else another halted cpu to steal it. The flag is cleared here so the next ready task
+*              goes to another cpu
+*/
+void smp_kick_idle(uint32_t id){
+    uint32_t i;
+
+    if (cpus[id].idle && id != this_cpu()->id){
+        cpus[id].idle = 0;
+        smp_kick(id);
+        return;
+    }
+    for (i = 0; i < smp_cpus; i++){
+        if (cpus[i].idle && i != this_cpu()->id){
+            cpus[i].idle = 0;
+            smp_kick(i);
+            return;
+        }
+    }
+}
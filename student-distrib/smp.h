@@ -0,0 +1,168 @@
+#if !defined(SMP_H)
+#define SMP_H
+
+#define MAX_CPUS 8
+#define AP_TRAMPOLINE 0x8000        // the startup ipi starts application processors here, in real mode
+#define CPU_TSS 4                   // offset of cpu_t.tss, sysenter_linkage reads it through %gs
+
+#if !defined(ASM)
+
+#include "types.h"
+#include "x86_desc.h"
+#include "paging.h"
+
+struct pcb_struct;
+
+// MP floating pointer structure, found on a 16 byte boundary in the ebda or the bios rom
+#define MP_FLOAT_SIG 0x5F504D5F     // "_MP_"
+#define MP_CONFIG_SIG 0x504D4350    // "PCMP"
+#define BDA_EBDA_SEGMENT 0x40E
+#define BASE_MEM_LAST_KB 0x9FC00
+#define BIOS_ROM_START 0xF0000
+#define BIOS_ROM_END 0x100000
+#define LOW_MEM_END 0x100000
+
+// MP configuration table entries
+#define MP_PROCESSOR 0
+#define MP_BUS 1
+#define MP_IOAPIC 2
+#define MP_IOINTR 3
+#define MP_LOCALINTR 4
+#define MP_PROCESSOR_LEN 20
+#define MP_ENTRY_LEN 8
+#define MP_CPU_ENABLED 0x1
+#define MP_CPU_BSP 0x2
+#define MP_IOAPIC_ENABLED 0x1
+#define MP_INTR_INT 0
+
+// init, then two startup ipis, per the MP spec
+#define INIT_DELAY_NS 10000000
+#define SIPI_DELAY_NS 200000
+#define AP_START_WAIT_NS 100000000
+
+#define SYSENTER_STACK_WORDS 32
+
+typedef struct __attribute__((packed)) mp_float_struct
+{
+    uint32_t signature;
+    uint32_t config;
+    uint8_t length;             // in 16 byte units
+    uint8_t spec_rev;
+    uint8_t checksum;
+    uint8_t default_config;     // nonzero when there is no configuration table
+    uint8_t features[4];
+} mp_float_t;
+
+typedef struct __attribute__((packed)) mp_config_struct
+{
+    uint32_t signature;
+    uint16_t length;
+    uint8_t spec_rev;
+    uint8_t checksum;
+    uint8_t oem_id[8];
+    uint8_t product_id[12];
+    uint32_t oem_table;
+    uint16_t oem_table_size;
+    uint16_t entry_count;
+    uint32_t lapic_addr;
+    uint16_t ext_length;
+    uint8_t ext_checksum;
+    uint8_t reserved;
+} mp_config_t;
+
+typedef struct __attribute__((packed)) mp_processor_struct
+{
+    uint8_t type;
+    uint8_t apic_id;
+    uint8_t apic_version;
+    uint8_t flags;
+    uint32_t signature;
+    uint32_t features;
+    uint32_t reserved[2];
+} mp_processor_t;
+
+typedef struct __attribute__((packed)) mp_bus_struct
+{
+    uint8_t type;
+    uint8_t bus_id;
+    uint8_t bus_type[6];        // "ISA   ", "PCI   "
+} mp_bus_t;
+
+typedef struct __attribute__((packed)) mp_ioapic_struct
+{
+    uint8_t type;
+    uint8_t apic_id;
+    uint8_t version;
+    uint8_t flags;
+    uint32_t addr;
+} mp_ioapic_t;
+
+typedef struct __attribute__((packed)) mp_intr_struct
+{
+    uint8_t type;
+    uint8_t intr_type;
+    uint16_t flags;             // polarity and trigger mode
+    uint8_t src_bus;
+    uint8_t src_irq;
+    uint8_t dst_apic;
+    uint8_t dst_pin;
+} mp_intr_t;
+
+// everything that differs between processors, %gs points at the running one's
+typedef struct cpu_struct
+{
+    struct cpu_struct* self;            // this_cpu reads it through %gs
+    tss_t* tss;                         // esp0 of the task it runs, at CPU_TSS
+    struct pcb_struct* current;         // pcb_ptr, NULL on the idle stack
+    uint32_t pid;                       // global_pid
+    volatile int32_t terminal;          // running_terminal
+    uint32_t id;                        // index in cpus
+    uint32_t apic_id;
+    volatile uint32_t online;
+    uint32_t bkl_held;                  // entries past the first one leave the kernel lock alone
+    volatile uint32_t idle;             // halted with the kernel lock dropped, rq_push kicks it
+    seg_desc_t* gdt;
+    page_dir_entry_t* page_dir;         // the 128 MB entry is rewritten for every task it runs
+    page_table_entry_t* vidmap_table;   // 132 MB table, its vidmap entry follows the running task's terminal
+    uint32_t* idle_stack;               // top of the stack sched_idle runs on
+    struct pcb_struct* fpu_owner;
+    uint8_t fpu_ts_set;
+    uint32_t ticks;                     // scheduler ticks taken here
+    uint32_t sysenter_stack[SYSENTER_STACK_WORDS];
+} cpu_t;
+
+/* Returns the cpu_t of the processor running the caller */
+static inline cpu_t* this_cpu(void) {
+    cpu_t* cpu;
+    asm volatile ("movl %%gs:0, %0"
+            : "=r"(cpu)
+    );
+    return cpu;
+}
+
+/* Loads %gs with the per-cpu segment of the gdt in use */
+#define load_percpu()                   \
+do {                                    \
+    asm volatile ("movw %w0, %%gs"      \
+            :                           \
+            : "r"(KERNEL_PERCPU)        \
+            : "memory"                  \
+    );                                  \
+} while (0)
+
+extern cpu_t cpus[MAX_CPUS];
+extern uint32_t smp_cpus;
+extern volatile uint32_t bkl_waits;
+
+void smp_boot_cpu(void);
+void mp_init(void);
+void smp_init(void);
+void ap_main(void);
+uint32_t kernel_enter(void);
+void kernel_exit(uint32_t taken);
+void smp_kick(uint32_t id);
+void smp_kick_idle(uint32_t id);
+
+#endif /* ASM */
+
+#endif
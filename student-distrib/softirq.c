@@ -0,0 +1,170 @@
+#include "softirq.h"
+#include "lib.h"
+#include "system_calls.h"
+
+volatile uint32_t softirq_pending = 0;      // one bit per softirq raised since its last run
+volatile uint32_t softirq_active = 0;       // a bottom half runs, the scheduler must not leave its stack
+softirq_stat_t softirq_stats[NUM_SOFTIRQS];
+
+static softirq_handler_t softirq_vec[NUM_SOFTIRQS];
+static const int8_t* softirq_names[NUM_SOFTIRQS] = {"keyboard", "video   ", "rtc     ", "timer   "};
+
+/* softirq_register
+* INPUTS: nr, handler
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: sets the bottom half run for softirq nr, done once by the driver's init
+*/
+void softirq_register(uint32_t nr, softirq_handler_t handler){
+    softirq_vec[nr] = handler;
+}
+
+/* softirq_raise
+* INPUTS: nr
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: marks softirq nr pending, it runs when the interrupt linkage calls do_softirq. Raising it
+*              again before then runs it once, so bottom halves drain whatever their top half queued
+*/
+void softirq_raise(uint32_t nr){
+    uint32_t flags;
+
+    cli_and_save(flags);
+    softirq_pending |= 1 << nr;
+    softirq_stats[nr].raised++;
+    restore_flags(flags);
+}
+
+/* softirq_top_time
+* INPUTS: nr, start - rdtsc value at the top of the interrupt handler
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: charges a top half to the statistics of its softirq, called with interrupts still off
+*/
+void softirq_top_time(uint32_t nr, uint64_t start){
+    uint32_t cycles = cycles_since(start);
+
+    if (cycles > softirq_stats[nr].top_max){
+        softirq_stats[nr].top_max = cycles;
+    }
+}
+
+/* do_softirq
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: called by the interrupt linkage after every handler. Runs the pending bottom halves with
+*              interrupts on until none is left. An interrupt taken meanwhile only queues its work, the
+*              run below picks it up, so bottom halves never nest and each runs on one stack at a time
+*/
+void do_softirq(void){
+    uint32_t flags, pending, nr, cycles;
+    uint64_t start;
+
+    cli_and_save(flags);
+    if (softirq_active || softirq_pending == 0){
+        restore_flags(flags);
+        return;
+    }
+    softirq_active = 1;
+
+    while ((pending = softirq_pending) != 0){
+        softirq_pending = 0;
+        sti();
+        for (nr = 0; nr < NUM_SOFTIRQS; nr++){
+            if (!(pending & (1 << nr)) || softirq_vec[nr] == NULL){
+                continue;
+            }
+            start = rdtsc();
+            softirq_vec[nr]();
+            cycles = cycles_since(start);
+            softirq_stats[nr].runs++;
+            if (cycles > softirq_stats[nr].bottom_max){
+                softirq_stats[nr].bottom_max = cycles;
+            }
+        }
+        cli();
+    }
+
+    softirq_active = 0;
+    restore_flags(flags);
+}
+
+/* softirq_open
+* INPUTS: filename
+* OUTPUTS: none
+* RETURN: 0
+* DESCRIPTION: nothing to set up
+*/
+int32_t softirq_open(const uint8_t* filename){
+    return 0;
+}
+
+/* softirq_close
+* INPUTS: fd
+* OUTPUTS: none
+* RETURN: 0
+* DESCRIPTION: nothing to release
+*/
+int32_t softirq_close(int32_t fd){
+    return 0;
+}
+
+/* softirq_read
+* INPUTS: fd, buf, nbytes
+* OUTPUTS: one line per softirq in buf: name, times raised, bottom half runs, then the longest top
+*          half and the longest bottom half in nanoseconds
+* RETURN: bytes read, 0 at the end of the file
+* DESCRIPTION: the "softirq" file. The top half column is the longest interrupts stay off for the
+*              interrupt, the bottom half column what it was before the work was deferred
+*/
+int32_t softirq_read(int32_t fd, void* buf, int32_t nbytes){
+    static const uint8_t widths[4] = {10, 10, 8, 8};
+    uint32_t values[4];
+    uint8_t line[SOFTIRQ_LINE_LEN];
+    uint8_t* out = (uint8_t*)buf;
+    uint32_t pos = pcb_ptr->fd_array[fd].fpos;
+    uint32_t total = NUM_SOFTIRQS * SOFTIRQ_LINE_LEN;
+    uint32_t copied = 0;
+    uint32_t offset, len;
+    softirq_stat_t* stat;
+
+    if (buf == NULL || nbytes < 0){
+        return -1;
+    }
+    while (copied < nbytes && pos < total){
+        stat = &softirq_stats[pos / SOFTIRQ_LINE_LEN];
+        values[0] = stat->raised;
+        values[1] = stat->runs;
+        values[2] = cycles_to_ns(stat->top_max);
+        values[3] = cycles_to_ns(stat->bottom_max);
+        put_stat_line(line, softirq_names[pos / SOFTIRQ_LINE_LEN], values, widths, 4);
+
+        offset = pos % SOFTIRQ_LINE_LEN;
+        len = SOFTIRQ_LINE_LEN - offset;
+        if (len > nbytes - copied){
+            len = nbytes - copied;
+        }
+        memcpy(out + copied, line + offset, len);
+        copied += len;
+        pos += len;
+    }
+    pcb_ptr->fd_array[fd].fpos = pos;
+    return copied;
+}
+
+/* softirq_write
+* INPUTS: fd, buf, nbytes
+* OUTPUTS: none
+* RETURN: nbytes
+* DESCRIPTION: any write clears the maxima so a new measurement can start
+*/
+int32_t softirq_write(int32_t fd, const void* buf, int32_t nbytes){
+    uint32_t nr;
+
+    for (nr = 0; nr < NUM_SOFTIRQS; nr++){
+        softirq_stats[nr].top_max = 0;
+        softirq_stats[nr].bottom_max = 0;
+    }
+    return nbytes;
+}
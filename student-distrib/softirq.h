@@ -0,0 +1,40 @@
+#if !defined(SOFTIRQ_H)
+#define SOFTIRQ_H
+
+#include "types.h"
+
+// deferred halves of the interrupt handlers, run in this order
+#define SOFTIRQ_KEYBOARD 0
+#define SOFTIRQ_VIDEO 1
+#define SOFTIRQ_RTC 2
+#define SOFTIRQ_TIMER 3
+#define NUM_SOFTIRQS 4
+
+#define SOFTIRQ_LINE_LEN 49         // bytes per softirq when the softirq file is read
+
+typedef void (*softirq_handler_t)(void);
+
+// cycles are kept as 32 bits, anything longer saturates
+typedef struct softirq_stat_struct
+{
+    uint32_t raised;
+    uint32_t runs;
+    uint32_t top_max;           // longest top half, all of it with interrupts off
+    uint32_t bottom_max;        // longest bottom half, the work the top half used to do with interrupts off
+} softirq_stat_t;
+
+extern volatile uint32_t softirq_pending;
+extern volatile uint32_t softirq_active;
+extern softirq_stat_t softirq_stats[NUM_SOFTIRQS];
+
+void softirq_register(uint32_t nr, softirq_handler_t handler);
+void softirq_raise(uint32_t nr);
+void softirq_top_time(uint32_t nr, uint64_t start);
+void do_softirq(void);
+
+int32_t softirq_open(const uint8_t* filename);
+int32_t softirq_close(int32_t fd);
+int32_t softirq_read(int32_t fd, void* buf, int32_t nbytes);
+int32_t softirq_write(int32_t fd, const void* buf, int32_t nbytes);
+
+#endif
@@ -0,0 +1,223 @@
+#include "spinlock.h"
+#include "system_calls.h"
+
+// every lock taken at least once, for the locks file
+static lock_stat_t* lock_table[MAX_LOCKS];
+static volatile uint32_t lock_count = 0;
+
+/* lock_register
+* INPUTS: stat
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: lists a lock in the locks file, called by its holder so a lock is never listed twice
+*/
+static void lock_register(lock_stat_t* stat){
+    uint32_t slot;
+
+    if (stat->listed){
+        return;
+    }
+    stat->listed = 1;
+    slot = fetch_add(&lock_count, 1);
+    if (slot < MAX_LOCKS){
+        lock_table[slot] = stat;
+    }
+}
+
+/* lock_acquired
+* INPUTS: stat, start - rdtsc value when the caller asked for the lock, contended
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: charges an acquisition to the statistics and starts timing the hold, called by the new holder
+*/
+static void lock_acquired(lock_stat_t* stat, uint64_t start, uint32_t contended){
+    uint32_t cycles;
+
+    lock_register(stat);
+    stat->acquired++;
+    if (contended){
+        stat->contended++;
+        cycles = cycles_since(start);
+        if (cycles > stat->wait_max){
+            stat->wait_max = cycles;
+        }
+    }
+    stat->hold_start = rdtsc();
+}
+
+/* lock_released
+* INPUTS: stat
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: charges the hold that ends to the statistics, called by the holder before it lets go
+*/
+static void lock_released(lock_stat_t* stat){
+    uint32_t cycles = cycles_since(stat->hold_start);
+
+    stat->hold_total += cycles;
+    if (cycles > stat->hold_max){
+        stat->hold_max = cycles;
+    }
+}
+
+/* spin_lock
+* INPUTS: lock
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: draws a ticket and spins until it is served. Taking a lock the cpu already holds never
+*              returns, and a lock an interrupt handler takes must be taken with spin_lock_irqsave
+*/
+void spin_lock(spinlock_t* lock){
+    uint64_t start = rdtsc();
+    uint32_t ticket = fetch_add(&lock->next, 1);
+    uint32_t contended = 0;
+
+    while (lock->serving != ticket){
+        contended = 1;
+        cpu_relax();
+    }
+    lock_acquired(&lock->stat, start, contended);
+}
+
+/* spin_unlock
+* INPUTS: lock
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: serves the next ticket. Only the holder writes serving, so no locked cycle is needed
+*/
+void spin_unlock(spinlock_t* lock){
+    lock_released(&lock->stat);
+    barrier();
+    lock->serving++;
+}
+
+/* mutex_lock
+* INPUTS: mutex
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: takes the mutex, sleeping while another task holds it. Interrupts stay on while it is held.
+*              Only for process context, an interrupt handler can't sleep
+*/
+void mutex_lock(mutex_t* mutex){
+    uint64_t start = rdtsc();
+    uint32_t flags, contended = 0;
+
+    cli_and_save(flags);
+    while (mutex->locked){
+        contended = 1;
+        sleep_on(&mutex->waiters);
+    }
+    mutex->locked = 1;
+    mutex->owner = pcb_ptr;
+    lock_acquired(&mutex->stat, start, contended);
+    restore_flags(flags);
+}
+
+/* mutex_unlock
+* INPUTS: mutex
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: releases the mutex and wakes its waiters, the first one scheduled takes it
+*/
+void mutex_unlock(mutex_t* mutex){
+    uint32_t flags;
+
+    cli_and_save(flags);
+    lock_released(&mutex->stat);
+    mutex->owner = NULL;
+    mutex->locked = 0;
+    wake_up(&mutex->waiters);
+    restore_flags(flags);
+}
+
+/* lock_open
+* INPUTS: filename
+* OUTPUTS: none
+* RETURN: 0
+* DESCRIPTION: nothing to set up
+*/
+int32_t lock_open(const uint8_t* filename){
+    return 0;
+}
+
+/* lock_close
+* INPUTS: fd
+* OUTPUTS: none
+* RETURN: 0
+* DESCRIPTION: nothing to release
+*/
+int32_t lock_close(int32_t fd){
+    return 0;
+}
+
+/* lock_read
+* INPUTS: fd, buf, nbytes
+* OUTPUTS: one line per lock in buf: name, acquisitions, acquisitions that had to wait, then the longest
+*          wait, the average hold and the longest hold in nanoseconds
+* RETURN: bytes read, 0 at the end of the file
+* DESCRIPTION: the "locks" file. A lock shows up once it has been taken
+*/
+int32_t lock_read(int32_t fd, void* buf, int32_t nbytes){
+    static const uint8_t widths[5] = {10, 10, 8, 8, 8};
+    uint32_t values[5];
+    uint8_t line[LOCK_LINE_LEN];
+    uint8_t* out = (uint8_t*)buf;
+    uint32_t pos = pcb_ptr->fd_array[fd].fpos;
+    uint32_t count = (lock_count < MAX_LOCKS) ? lock_count : MAX_LOCKS;
+    uint32_t copied = 0;
+    uint32_t offset, len, hold_avg;
+    lock_stat_t* stat;
+
+    if (buf == NULL || nbytes < 0){
+        return -1;
+    }
+    while (copied < nbytes && pos < count * LOCK_LINE_LEN){
+        stat = lock_table[pos / LOCK_LINE_LEN];
+        if (stat == NULL){          // registered by another cpu right now
+            break;
+        }
+        hold_avg = (stat->acquired != 0) ? udiv64_sat(stat->hold_total, stat->acquired) : 0;
+        values[0] = stat->acquired;
+        values[1] = stat->contended;
+        values[2] = cycles_to_ns(stat->wait_max);
+        values[3] = cycles_to_ns(hold_avg);
+        values[4] = cycles_to_ns(stat->hold_max);
+        put_stat_line(line, stat->name, values, widths, 5);
+
+        offset = pos % LOCK_LINE_LEN;
+        len = LOCK_LINE_LEN - offset;
+        if (len > nbytes - copied){
+            len = nbytes - copied;
+        }
+        memcpy(out + copied, line + offset, len);
+        copied += len;
+        pos += len;
+    }
+    pcb_ptr->fd_array[fd].fpos = pos;
+    return copied;
+}
+
+/* lock_write
+* INPUTS: fd, buf, nbytes
+* OUTPUTS: none
+* RETURN: nbytes
+* DESCRIPTION: any write clears the statistics so a new measurement can start
+*/
+int32_t lock_write(int32_t fd, const void* buf, int32_t nbytes){
+    uint32_t i, flags;
+    lock_stat_t* stat;
+
+    cli_and_save(flags);
+    for (i = 0; i < lock_count && i < MAX_LOCKS; i++){
+        stat = lock_table[i];
+        if (stat != NULL){
+            stat->acquired = 0;
+            stat->contended = 0;
+            stat->wait_max = 0;
+            stat->hold_max = 0;
+            stat->hold_total = 0;
+        }
+    }
+    restore_flags(flags);
+    return nbytes;
+}
@@ -0,0 +1,70 @@
+#if !defined(SPINLOCK_H)
+#define SPINLOCK_H
+
+#include "types.h"
+#include "lib.h"
+#include "scheduler.h"
+
+#define MAX_LOCKS 16                // locks listed in the locks file
+#define LOCK_LINE_LEN 58            // bytes per lock when the locks file is read
+
+struct pcb_struct;
+
+// cycles are kept as 32 bits like the softirq statistics, anything longer saturates
+typedef struct lock_stat_struct
+{
+    const int8_t* name;             // 8 characters, padded, as the locks file shows it
+    uint32_t acquired;
+    uint32_t contended;             // acquisitions that found the lock held
+    uint32_t wait_max;              // longest spin or sleep before getting it
+    uint32_t hold_max;
+    uint64_t hold_total;
+    uint64_t hold_start;
+    uint32_t listed;                // in the locks file, done the first time the lock is taken
+} lock_stat_t;
+
+// ticket lock, cpus get it in the order they asked for it
+typedef struct spinlock_struct
+{
+    volatile uint32_t next;         // ticket the next cpu to ask draws
+    volatile uint32_t serving;      // ticket of the holder
+    lock_stat_t stat;
+} spinlock_t;
+
+// sleeping lock for long sections in process context, waiters leave the cpu
+typedef struct mutex_struct
+{
+    volatile uint32_t locked;
+    struct pcb_struct* owner;       // NULL when taken before any task runs
+    wait_queue_t waiters;
+    lock_stat_t stat;
+} mutex_t;
+
+#define SPINLOCK_INIT(lock_name) { .next = 0, .serving = 0, .stat = { .name = lock_name } }
+#define MUTEX_INIT(lock_name) { .locked = 0, .owner = NULL, .waiters = { NULL }, .stat = { .name = lock_name } }
+
+/* Takes a spinlock with interrupts off on this cpu, for locks an interrupt handler takes too */
+#define spin_lock_irqsave(lock, flags)  \
+do {                                    \
+    cli_and_save(flags);                \
+    spin_lock(lock);                    \
+} while (0)
+
+/* Releases a spinlock taken with spin_lock_irqsave */
+#define spin_unlock_irqrestore(lock, flags) \
+do {                                    \
+    spin_unlock(lock);                  \
+    restore_flags(flags);               \
+} while (0)
+
+void spin_lock(spinlock_t* lock);
+void spin_unlock(spinlock_t* lock);
+void mutex_lock(mutex_t* mutex);
+void mutex_unlock(mutex_t* mutex);
+
+int32_t lock_open(const uint8_t* filename);
+int32_t lock_close(int32_t fd);
+int32_t lock_read(int32_t fd, void* buf, int32_t nbytes);
+int32_t lock_write(int32_t fd, const void* buf, int32_t nbytes);
+
+#endif
@@ -0,0 +1,159 @@
+#include "sysstat.h"
+#include "lib.h"
+#include "system_calls.h"
+
+#define SYSSTAT_HALT 0          // jump table indices
+#define SYSSTAT_READ 2
+#define SYSSTAT_WRITE 3
+
+extern int32_t (*jumptable_asm[SYSSTAT_CALLS])(uint32_t arg1, uint32_t arg2, uint32_t arg3);
+
+sysstat_t sysstat;
+
+/* sysstat_add
+* INPUTS: row, cycles
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: counts a call of the row's kind and puts it in the log2 bucket of its latency
+*/
+static void sysstat_add(uint32_t row, uint64_t cycles){
+    uint32_t hi = (uint32_t)(cycles >> 32);
+    uint32_t lo = (uint32_t)cycles;
+    uint32_t bucket = 0;
+
+    if (hi != 0){
+        bucket = 32 + find_last_set(hi);
+    }
+    else if (lo != 0){
+        bucket = find_last_set(lo);
+    }
+    if (bucket >= SYSSTAT_BUCKETS){
+        bucket = SYSSTAT_BUCKETS - 1;
+    }
+    sysstat.rows[row].calls++;
+    sysstat.rows[row].cycles += cycles;
+    sysstat.rows[row].buckets[bucket]++;
+}
+
+/* syscall_dispatch
+* INPUTS: index - jump table index, arg1, arg2, arg3
+* OUTPUTS: none
+* RETURN: what the system call returns
+* DESCRIPTION: called by both system call linkages, times the call with the tsc and charges it to
+*              the call, to the filetype of the fd for read and write, and to the calling pid. The
+*              time is wall time, so it includes sleeping in read and the whole child for execute
+*/
+int32_t syscall_dispatch(uint32_t index, uint32_t arg1, uint32_t arg2, uint32_t arg3){
+    uint32_t pid = SYSSTAT_PIDS;
+    uint32_t file_row = 0;
+    uint32_t flags;
+    uint64_t start, cycles;
+    int32_t ret;
+
+    if (pcb_ptr != NULL){
+        pid = pcb_ptr->pid;
+        if ((index == SYSSTAT_READ || index == SYSSTAT_WRITE) && arg1 < 8 && pcb_ptr->fd_array[arg1].flags != 0 &&
+                pcb_ptr->fd_array[arg1].filetype < SYSSTAT_FILETYPES){
+            file_row = ((index == SYSSTAT_READ) ? SYSSTAT_READ_ROW : SYSSTAT_WRITE_ROW) + pcb_ptr->fd_array[arg1].filetype;
+        }
+    }
+
+    if (index == SYSSTAT_HALT){     // halt returns through the parent's execute, only count it
+        cli_and_save(flags);
+        sysstat_add(SYSSTAT_HALT, 0);
+        restore_flags(flags);
+    }
+
+    start = rdtsc();
+    ret = jumptable_asm[index](arg1, arg2, arg3);
+    cycles = rdtsc() - start;
+
+    cli_and_save(flags);
+    sysstat_add(index, cycles);
+    if (file_row != 0){
+        sysstat_add(file_row, cycles);
+    }
+    if (pid < SYSSTAT_PIDS){
+        sysstat.pids[pid].calls++;
+        sysstat.pids[pid].cycles += cycles;
+    }
+    restore_flags(flags);
+    return ret;
+}
+
+/* sysstat_pid_reset
+* INPUTS: pid
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: starts the counters of a newly executed process from zero
+*/
+void sysstat_pid_reset(uint32_t pid){
+    if (pid < SYSSTAT_PIDS){
+        sysstat.pids[pid].calls = 0;
+        sysstat.pids[pid].cycles = 0;
+    }
+}
+
+/* sysstat_open
+* INPUTS: filename
+* OUTPUTS: none
+* RETURN: 0
+* DESCRIPTION: nothing to set up
+*/
+int32_t sysstat_open(const uint8_t* filename){
+    return 0;
+}
+
+/* sysstat_close
+* INPUTS: fd
+* OUTPUTS: none
+* RETURN: 0
+* DESCRIPTION: nothing to tear down
+*/
+int32_t sysstat_close(int32_t fd){
+    return 0;
+}
+
+/* sysstat_read
+* INPUTS: fd, buf, nbytes
+* OUTPUTS: the sysstat_t structure from the file position on
+* RETURN: bytes copied, 0 at the end
+* DESCRIPTION: binary, the reader formats it
+*/
+int32_t sysstat_read(int32_t fd, void* buf, int32_t nbytes){
+    uint32_t pos = pcb_ptr->fd_array[fd].fpos;
+    uint32_t flags;
+
+    if (buf == NULL || nbytes < 0){
+        return -1;
+    }
+    if (pos >= sizeof(sysstat)){
+        return 0;
+    }
+    if (nbytes > sizeof(sysstat) - pos){
+        nbytes = sizeof(sysstat) - pos;
+    }
+    cli_and_save(flags);
+    memcpy(buf, (uint8_t*)&sysstat + pos, nbytes);
+    restore_flags(flags);
+    pcb_ptr->fd_array[fd].fpos = pos + nbytes;
+    return nbytes;
+}
+
+/* sysstat_write
+* INPUTS: fd, buf, nbytes
+* OUTPUTS: none
+* RETURN: nbytes, -1 for an unknown command
+* DESCRIPTION: 'c' clears every counter
+*/
+int32_t sysstat_write(int32_t fd, const void* buf, int32_t nbytes){
+    uint32_t flags;
+
+    if (buf == NULL || nbytes < 1 || *(uint8_t*)buf != 'c'){
+        return -1;
+    }
+    cli_and_save(flags);
+    memset(&sysstat, 0, sizeof(sysstat));
+    restore_flags(flags);
+    return nbytes;
+}
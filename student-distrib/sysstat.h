@@ -0,0 +1,44 @@
+#if !defined(SYSSTAT_H)
+#define SYSSTAT_H
+
+#include "types.h"
+
+#define SYSSTAT_CALLS 14            // entries of jumptable_asm
+#define SYSSTAT_FILETYPES 6         // rtc, directory, file, kernel file, terminal, pipe
+#define SYSSTAT_READ_ROW SYSSTAT_CALLS                              // read split by filetype
+#define SYSSTAT_WRITE_ROW (SYSSTAT_CALLS + SYSSTAT_FILETYPES)       // write split by filetype
+#define SYSSTAT_ROWS (SYSSTAT_CALLS + 2 * SYSSTAT_FILETYPES)
+#define SYSSTAT_BUCKETS 40          // bucket i counts calls taking [2^i, 2^(i+1)) cycles
+#define SYSSTAT_PIDS 64             // MAX_PIDS
+
+typedef struct __attribute__((packed)) sysstat_row_struct
+{
+    uint32_t calls;
+    uint64_t cycles;
+    uint32_t buckets[SYSSTAT_BUCKETS];
+} sysstat_row_t;
+
+typedef struct __attribute__((packed)) sysstat_pid_struct
+{
+    uint32_t calls;
+    uint64_t cycles;
+} sysstat_pid_t;
+
+// layout of the "sysstat" file, syscalls/ece391sysstat.c reads the same structure
+typedef struct __attribute__((packed)) sysstat_struct
+{
+    sysstat_row_t rows[SYSSTAT_ROWS];
+    sysstat_pid_t pids[SYSSTAT_PIDS];
+} sysstat_t;
+
+extern sysstat_t sysstat;
+
+int32_t syscall_dispatch(uint32_t index, uint32_t arg1, uint32_t arg2, uint32_t arg3);
+void sysstat_pid_reset(uint32_t pid);
+
+int32_t sysstat_open(const uint8_t* filename);
+int32_t sysstat_close(int32_t fd);
+int32_t sysstat_read(int32_t fd, void* buf, int32_t nbytes);
+int32_t sysstat_write(int32_t fd, const void* buf, int32_t nbytes);
+
+#endif
@@ -1,4 +1,10 @@
 #include "system_calls.h"
+#include "interrupts.h"
+#include "kfile.h"
+#include "trace.h"
+#include "sysstat.h"
+#include "pipe.h"
+#include "spinlock.h"
 
 
 
@@ -6,23 +12,110 @@ uint32_t previous_ebp;
 uint32_t previous_esp;
 uint32_t user_eip;
 
-uint32_t global_pid = 0;
-uint8_t pid_num[6] = {0, 0, 0, 0, 0, 0};
+
+// one bit per pid in use, and the pcb (bottom of the 8kb kernel stack) of each live pid
+static uint32_t pid_bitmap[MAX_PIDS / 32];
+static pcb_t* pcb_table[MAX_PIDS];
+static spinlock_t pid_lock = SPINLOCK_INIT("pids    ");     // the two above, halt frees a pid with interrupts off
+uint8_t loader_zero_copy = 1;
+uint8_t loader_demand_paging = 1;
+uint32_t last_halt_page_faults = 0;
+uint32_t last_halt_text_pages = 0;
 
 /* get_free_pid
 * INPUTS: none
 * OUTPUTS: none
 * RETURN: get the next free pid
-* DESCRIPTION: iterate through the array of pid indices and find the next free pid
+* DESCRIPTION: finds the lowest clear bit of the pid bitmap, one bsf per 32 pids
 */
 extern int32_t get_free_pid(){
+    uint32_t flags;
+    int32_t pid = -1;
     int i = 0;
-    for(i = 0; i < 6; i++){
-        if(pid_num[i] == 0){
-            return i;
+
+    spin_lock_irqsave(&pid_lock, flags);
+    for(i = 0; i < MAX_PIDS / 32; i++){
+        if(pid_bitmap[i] != 0xFFFFFFFF){
+            pid = (i << 5) + find_first_zero(pid_bitmap[i]);
+            break;
         }
     }
-    return -1;
+    spin_unlock_irqrestore(&pid_lock, flags);
+    return pid;
+}
+
+/* get_pcb
+* INPUTS: pid
+* OUTPUTS: none
+* RETURN: pointer to the pcb of the given pid, NULL if the pid is not in use
+* DESCRIPTION: pcbs sit at the bottom of each process' 8kb kernel stack
+*/
+extern pcb_t* get_pcb(uint32_t pid){
+    if (pid >= MAX_PIDS){
+        return NULL;
+    }
+    return pcb_table[pid];
+}
+
+/* task_alloc
+* INPUTS: pid
+* OUTPUTS: none
+* RETURN: pcb of the new process, NULL if memory is exhausted or the pid was taken meanwhile
+* DESCRIPTION: claims the pid and allocates the kernel stack (with the pcb at its bottom) and the page table
+*/
+static pcb_t* task_alloc(uint32_t pid){
+    pcb_t* task = (pcb_t*)frame_alloc_pair();
+    page_table_entry_t* table = user_table_alloc();
+    uint32_t flags;
+
+    if (task == NULL || table == NULL){
+        if (task != NULL){
+            frame_free_pair((uint32_t)task);
+        }
+        if (table != NULL){
+            frame_free((uint32_t)table);
+        }
+        return NULL;
+    }
+    task->pid = pid;
+    task->page_table = table;
+    task->text_pages = 0;
+
+    spin_lock_irqsave(&pid_lock, flags);
+    if (pid_bitmap[pid >> 5] & (1 << (pid & 31))){      // taken since get_free_pid looked
+        spin_unlock_irqrestore(&pid_lock, flags);
+        frame_free_pair((uint32_t)task);
+        frame_free((uint32_t)table);
+        return NULL;
+    }
+    pcb_table[pid] = task;
+    pid_bitmap[pid >> 5] |= 1 << (pid & 31);
+    spin_unlock_irqrestore(&pid_lock, flags);
+    return task;
+}
+
+/* task_release
+* INPUTS: task
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: gives the pid, the user frames, the page table and the kernel stack of a process back. The
+*              caller must have switched away from its page table and keep interrupts off while it still runs
+*              on the freed kernel stack
+*/
+static void task_release(pcb_t* task){
+    uint32_t pid = task->pid;
+    uint32_t flags;
+
+    fpu_release(task);
+    if (task->text_pages > 0){      // the filesystem blocks its text was shared with can be written again
+        text_map_put(task->exe_inode);
+    }
+    user_table_free(task->page_table);
+    spin_lock_irqsave(&pid_lock, flags);
+    pcb_table[pid] = NULL;
+    pid_bitmap[pid >> 5] &= ~(1 << (pid & 31));
+    spin_unlock_irqrestore(&pid_lock, flags);
+    frame_free_pair((uint32_t)task);
 }
 
 /* get_global_pid
@@ -35,6 +128,113 @@ extern int32_t get_global_pid(){
     return global_pid;
 }
 
+/* page_is_read_only
+* INPUTS: phdr, phnum, vaddr
+* OUTPUTS: none
+* RETURN: 1 if the 4kb page at vaddr only holds read-only loadable segments, 0 otherwise
+* DESCRIPTION: the page can then be shared with the filesystem image instead of copied, which
+*              needs the segment's file offset to match its place in the flat program image
+*/
+static int32_t page_is_read_only(elf_phdr_t* phdr, uint32_t phnum, uint32_t vaddr){
+    uint32_t i;
+    int32_t covered = 0;
+
+    for (i = 0; i < phnum; i++){
+        if (phdr[i].type != PT_LOAD ||
+            phdr[i].vaddr >= vaddr + FOUR_KB ||
+            phdr[i].vaddr + phdr[i].memsz <= vaddr){        // segment does not touch this page
+            continue;
+        }
+        if ((phdr[i].flags & PF_W) || (phdr[i].vaddr - PROGRAM_IMAGE_ADDR) != phdr[i].offset){
+            return 0;
+        }
+        covered = 1;
+    }
+    return covered;
+}
+
+/* load_program
+* INPUTS: inode, size
+* OUTPUTS: none
+* RETURN: number of pages shared with the filesystem on success, -1 on failure
+* DESCRIPTION: loads the executable into the 128 MB window of the current process. When loader_zero_copy
+*              is set, pages that only hold read-only segments are mapped straight onto the filesystem
+*              datablocks. The remaining pages are copied into newly allocated frames, or left for
+*              user_page_fault when loader_demand_paging is set
+*/
+static int32_t load_program(uint32_t inode, uint32_t size){
+    uint8_t ehdr[ELF_HEADER_SIZE];
+    elf_phdr_t phdr[ELF_PHDR_MAX];
+    inode_t* inode_curr = inode_ptr + inode;
+    uint32_t phoff, phnum, page, num_pages, vaddr, block;
+    int32_t shared = 0;
+
+    phnum = 0;
+    if (loader_zero_copy && read_data(inode, 0, ehdr, ELF_HEADER_SIZE) == ELF_HEADER_SIZE){
+        phoff = *(uint32_t*)(ehdr + ELF_PHOFF);
+        phnum = *(uint16_t*)(ehdr + ELF_PHNUM);
+        if (phnum > ELF_PHDR_MAX ||
+            *(uint16_t*)(ehdr + ELF_PHENTSIZE) != sizeof(elf_phdr_t) ||
+            read_data(inode, phoff, (uint8_t*)phdr, phnum * sizeof(elf_phdr_t)) != (int32_t)(phnum * sizeof(elf_phdr_t))){
+            phnum = 0;      // unexpected header, fall back to copying the whole image
+        }
+    }
+
+    num_pages = (size + FOUR_KB - 1) / FOUR_KB;
+    for (page = 0; page < num_pages; page++){
+        vaddr = PROGRAM_IMAGE_ADDR + (page * FOUR_KB);
+        block = inode_curr->datablock[page];
+        if (page_is_read_only(phdr, phnum, vaddr) && block < bootblock_ptr->datablocks_num){
+            user_page_map(global_pid, vaddr, (uint32_t)(datablock_ptr + block), 0);     // text is never written so share the block
+            shared++;
+        }
+        else if (!loader_demand_paging &&
+                 (user_page_alloc(global_pid, vaddr) == 0 || read_data(inode, page * FOUR_KB, (uint8_t*)vaddr, FOUR_KB) == -1)){
+            return -1;
+        }
+    }
+
+    flush_tlb(global_pid);      // drop any stale translation of the pages that were remapped
+    return shared;
+}
+
+/* user_page_fault
+* INPUTS: fault_addr
+* OUTPUTS: none
+* RETURN: 0 if the page was loaded or already present, -1 if the address is not a user page of the running program
+* DESCRIPTION: demand pager called on a not-present fault. Backs the page with a new frame and
+*              fills it from the executable's inode, pages past the end of the file are zero filled
+*/
+int32_t user_page_fault(uint32_t fault_addr){
+    pcb_t* curr_pcb = pcb_ptr;
+    uint32_t page_addr = fault_addr & ~(FOUR_KB - 1);
+    int32_t bytes = 0;
+
+    if (curr_pcb == NULL || fault_addr < ONETWENTYEIGHT_MB || fault_addr >= ONETHIRTYTWO_MB){
+        return -1;
+    }
+
+    if (curr_pcb->page_table[(page_addr >> 12) & 0x3FF].present){
+        return 0;       // mapped since the fault was raised, the instruction just runs again
+    }
+
+    // not-present pages are never cached in the tlb so no flush is needed after mapping
+    if (user_page_alloc(curr_pcb->pid, page_addr) == 0){
+        return -1;      // out of memory, the fault kills the program
+    }
+
+    if (page_addr >= PROGRAM_IMAGE_ADDR && page_addr < PROGRAM_IMAGE_ADDR + curr_pcb->exe_size){
+        bytes = read_data(curr_pcb->exe_inode, page_addr - PROGRAM_IMAGE_ADDR, (uint8_t*)page_addr, FOUR_KB);
+        if (bytes < 0){
+            bytes = 0;
+        }
+    }
+    memset((uint8_t*)page_addr + bytes, 0, FOUR_KB - bytes);      // bss, heap and stack start out zeroed
+
+    curr_pcb->page_faults++;
+    return 0;
+}
+
 /* halt
 * INPUTS: none
 * OUTPUTS: none
@@ -44,71 +244,91 @@ extern int32_t get_global_pid(){
 int32_t halt(uint8_t status){
 
     cli();
-    pcb_t* curr_pcb = terminal_arr[terminal_id].curr_pcb;
+    pcb_t* curr_pcb = pcb_ptr;
     int temp_pid = curr_pcb->pid;
     uint32_t curr_ebp, curr_esp;
 
+    TRACE(TRACE_HALT, status);
 
     if (temp_pid < 0){    // should never be executed but sanity check
         return 0;
     } 
 
+    int i;
+    // close any open files while the task is still pcb_ptr, the close ops look the fd up through it
+    for (i = 0; i < 8; i++)
+    {
+        if (curr_pcb->fd_array[i].flags == 1)
+        {
+            if (curr_pcb->fd_array[i].file_op_table.close != NULL){     // the terminal has nothing to close
+                curr_pcb->fd_array[i].file_op_table.close(i);
+            }
+            curr_pcb->fd_array[i].file_op_table.read = NULL;
+            curr_pcb->fd_array[i].file_op_table.write = NULL;
+            curr_pcb->fd_array[i].file_op_table.open = NULL;
+            curr_pcb->fd_array[i].file_op_table.close = NULL;
+            curr_pcb->fd_array[i].inode = 0;
+            curr_pcb->fd_array[i].fpos = 0;
+            curr_pcb->fd_array[i].flags = 0;
+            curr_pcb->fd_array[i].filetype = 0;
+        }
+    }
+
+    if (!curr_pcb->background){
+        terminal_arr[running_terminal].vidmapped = 0;      // a vidmap mapping goes away with its program
+        vidmem_switch(0);
+    }
+
+    if (curr_pcb->detached){        // started by spawn, nobody waits in execute for the status
+        task_release(curr_pcb);
+        sched_exit();
+    }
+
     if (curr_pcb->parent_pid < 0){ // if trying to exit base shell
         printf("\n Can't exit base shell. Restarting shell.\n\n");
         terminal_arr[running_terminal].curr_pid = -1;
-        pid_num[temp_pid] = 0;
+        terminal_arr[running_terminal].curr_pcb = NULL;
+        pcb_ptr = NULL;
+        task_release(curr_pcb);     // execute keeps interrupts off until the new shell runs
         execute((uint8_t *)"shell"); // restart shell
     }
 
-    pid_num[temp_pid] = 0;
+    // keeping the paging statistics of the finished program
+    last_halt_page_faults = curr_pcb->page_faults;
+    last_halt_text_pages = curr_pcb->text_pages;
 
     global_pid = pcb_ptr->parent_pid;
 
     pcb_ptr = (pcb_t*)(curr_pcb)->parent_pcb;
+    fpu_switch(pcb_ptr);
     curr_ebp = curr_pcb->parent_ebp;
     curr_esp = curr_pcb->parent_esp;
 
+    // the parent takes over the cpu and whatever is left of the time slice
+    pcb_ptr->state = TASK_RUNNING;
+    pcb_ptr->timeslice = curr_pcb->timeslice;
     
     // set tss.esp0 and tss.ss0 for task switch
-    tss.esp0 = pcb_ptr->parent_esp0;
-    tss.ss0 = pcb_ptr->parent_ss0;
+    this_cpu()->tss->esp0 = pcb_ptr->parent_esp0;
+    this_cpu()->tss->ss0 = pcb_ptr->parent_ss0;
 
-    terminal_arr[terminal_id].curr_pcb = pcb_ptr;
-    terminal_arr[terminal_id].curr_pid = global_pid;
-    terminal_arr[terminal_id].esp0_term = tss.esp0;
-    terminal_arr[terminal_id].ss0_term = tss.ss0;
-    terminal_arr[terminal_id].ebp_saved = curr_ebp;
-    terminal_arr[terminal_id].esp_saved = curr_esp;
+    if (!curr_pcb->background){     // a background parent never was the terminal's program
+        terminal_arr[running_terminal].curr_pcb = pcb_ptr;
+        terminal_arr[running_terminal].curr_pid = global_pid;
+    }
 
     // flush tlb to restore paging of previous program
     flush_tlb(global_pid);
 
-    int i;
-    // close any open files
-    for (i = 2; i < 8; i++)
-    {
-        if (curr_pcb->fd_array[i].flags == 1)
-        {
-            if (curr_pcb->fd_array[i].file_op_table.close != NULL){
-                curr_pcb->fd_array[i].file_op_table.close(i);
-            }
-            curr_pcb->fd_array[i].file_op_table.read = NULL;
-            curr_pcb->fd_array[i].file_op_table.write = NULL;
-            curr_pcb->fd_array[i].file_op_table.open = NULL;
-            curr_pcb->fd_array[i].file_op_table.close = NULL;
-            curr_pcb->fd_array[i].inode = 0;
-            curr_pcb->fd_array[i].fpos = 0;
-            curr_pcb->fd_array[i].flags = 0;
-            curr_pcb->fd_array[i].filetype = 0;
-        }
-    }
+    // the kernel stack we run on is freed here, so interrupts stay off until esp is on the parent's stack
+    task_release(curr_pcb);
 
-    sti();
     // store ebp value and status (return val) to eax
     // return to parent program
     asm volatile("            \n\
             movl %0, %%ebx      \n\
             movl %2, %%esp      \n\
+            sti                 \n\
             xorl %%eax, %%eax   \n\
             movb %1, %%al      \n\
             movl %%ebx, %%ebp   \n\
@@ -132,59 +352,23 @@ int32_t jumpTable(){
     return 0;
 }
 
-/* execute
-* INPUTS: command
-* OUTPUTS: none
-* RETURN: -1 if command can't be executed, 0-255 based on call's halt
-* DESCRIPTION: attempts to load and execute a new program, handing off the processor to the new program
+/* program_load
+* INPUTS: command - executable name followed by its arguments
+* OUTPUTS: user_eip set to the entry point of the program
+* RETURN: pcb of the new process, NULL if the command can't be executed
+* DESCRIPTION: the part of execute that spawn shares. Checks the executable, takes a pid, loads the program
+*              and sets up the arguments and fds (stdin and stdout on the terminal). The 128 MB window is
+*              left on the new process, interrupts must be off
 */
-int32_t execute(const uint8_t* command){
-
-    uint32_t val;
-
-
-    if((terminal_switch_flag == 1) && (terminal_arr[terminal_id].curr_pid == -1)){
-        running_terminal = terminal_id;
-    }
-    else{
-        while (running_terminal != terminal_id){}
-    }
-    terminal_switch_flag = 0;
-    
-
-    cli();
-
-    
-
-    // paramter validation
-    if(command == NULL){ 
-        sti();
-        return -1;
-    }
+static pcb_t* program_load(const uint8_t* command){
 
     //intializing the local variable
     uint32_t i = 0;
     uint32_t size = strlen((int8_t*)command);
-    uint8_t file_name[size];
-    uint8_t local_name[size];
-    int flag = 0;
+    uint8_t file_name[size + 1];
     dentry_t temp;
-    int8_t* temp1;
-    int index = 0;
-    uint32_t old_ebp;
-    uint32_t old_esp;
-
-
-    // local name variable holds the command input on the terminal to be passed down to getargs
-    while(i < size){
-        local_name[i] = command[i];
-        i++;
-    }
-
-    //terminate the string with a null charcater
-    local_name[i]='\0';
-
-    i = 0;
+    int32_t text_pages;
+    pcb_t* new_pcb;
 
     // file name variables used to executable
     while ((i < size) && (command[i] != 0x20)) {
@@ -193,82 +377,176 @@ int32_t execute(const uint8_t* command){
     }
     file_name[i] = '\0';
     
-    for(i = 0; i < bootblock_ptr->directory_num; i++){     // iterating through all directory entry files
-        temp = dentry_ptr[i];
-        temp1 = (int8_t*)(temp.filename);
-        if(strncmp((int8_t*)file_name, temp1, 32) == 0){        // checking if file names are equivalent
-            flag = 1;
-            index = i;
-            break;
-        }
+    if (read_dentry_by_name(file_name, &temp) == -1){      // hashed lookup of the executable's directory entry
+        return NULL;
     }
 
-    if (flag == 0){
-        sti();
-        return -1;
-    }
-
-    int temp_pid = get_free_pid();
-        if(temp_pid == -1){
-            puts((int8_t*)"Can't run more than 6 processes");
-            sti();
-            return -1;
-        }
-        else{
-            global_pid = temp_pid;
-            pid_num[temp_pid] = 1;
-        }
-
-
     // getting exact file size of file to be loaded
-    size = (inode_ptr + dentry_ptr[index].inode)->length;
+    size = (inode_ptr + temp.inode)->length;
 
     uint8_t buf[4];
 
 	// loading file contents into buf
-    if (read_data(dentry_ptr[index].inode, 0, buf, 4) == -1) {  
-        sti();
-		return -1;
+    if (read_data(temp.inode, 0, buf, 4) == -1) {  
+		return NULL;
 	}
 
     // checking for magic constant to see if it is an executable
     if (!((buf[0]==0x7F) && (buf[1]==0x45) && (buf[2]==0x4C) && (buf[3]==0x46))) {     
-        sti();
-        return -1;
+        return NULL;
     } 
 
-    //initialize page
-    executable_page();    
-
     // loading file contents into buf
-    if (read_data(dentry_ptr[index].inode, 0, (uint8_t*)0x08048000, size) == -1) {  
-        sti();
-		return -1;
+    if (read_data(temp.inode, 24, buf, 4) == -1) {  
+		return NULL;
 	}
 
-    //intializing a process control block
-    pcb_ptr = (pcb_t*)(EIGHT_MB - (EIGHT_KB * (global_pid + 1)));
-    pcb_ptr->parent_pcb = (uint32_t) terminal_arr[terminal_id].curr_pcb;
+    // starting address of first instructions to be executed (given in doc)
+    user_eip = (buf[3] << 24) + (buf[2] << 16) + (buf[1] << 8) + buf[0];
 
-    pcb_ptr->parent_pid = terminal_arr[terminal_id].curr_pid;
-    
-    terminal_arr[terminal_id].curr_pid = global_pid;
-    terminal_arr[terminal_id].curr_pcb = pcb_ptr;
+    int temp_pid = get_free_pid();
+    if(temp_pid == -1){
+        printf("Can't run more than %d processes", MAX_PIDS);
+        return NULL;
+    }
+    new_pcb = task_alloc(temp_pid);
+    if(new_pcb == NULL){
+        puts((int8_t*)"Out of memory");
+        return NULL;
+    }
+    global_pid = temp_pid;
+
+    //switch the 128 MB window to the new program's page table, every page starts out not present
+    flush_tlb(global_pid);
+
+    // mapping read-only text onto the filesystem and copying (or deferring) everything else
+    text_pages = load_program(temp.inode, size);
+    if (text_pages == -1) {  
+        if (pcb_ptr != NULL){       // give the caller its window back
+            global_pid = pcb_ptr->pid;
+            flush_tlb(global_pid);
+        }
+        task_release(new_pcb);
+		return NULL;
+	}
+
+    // the command is kept in the pcb for getargs, the caller's copy may be gone by the time it asks
+    for (i = 0; i < ARGS_MAX - 1 && command[i] != '\0'; i++){
+        new_pcb->args[i] = command[i];
+    }
+    new_pcb->args[i] = '\0';
 
     // initializing entry for stdin (fd0)
-    pcb_ptr->fd_array[0].file_op_table.read = terminal_read;
-    pcb_ptr->fd_array[0].inode = 0;
-    pcb_ptr->fd_array[0].fpos = 0;
-    pcb_ptr->fd_array[0].flags = 1;
+    new_pcb->fd_array[0].file_op_table.read = terminal_read;
+    new_pcb->fd_array[0].file_op_table.write = NULL;
+    new_pcb->fd_array[0].file_op_table.open = NULL;
+    new_pcb->fd_array[0].file_op_table.close = NULL;
+    new_pcb->fd_array[0].inode = 0;
+    new_pcb->fd_array[0].fpos = 0;
+    new_pcb->fd_array[0].flags = 1;
+    new_pcb->fd_array[0].filetype = FILETYPE_TERMINAL;
+    new_pcb->fd_array[0].oflags = 0;
 
     // initializing entry for stdout (fd1)
-    pcb_ptr->fd_array[1].file_op_table.write = terminal_write;
-    pcb_ptr->fd_array[1].inode = 0;
-    pcb_ptr->fd_array[1].fpos = 0;
-    pcb_ptr->fd_array[1].flags = 1;
+    new_pcb->fd_array[1].file_op_table.read = NULL;
+    new_pcb->fd_array[1].file_op_table.write = terminal_write;
+    new_pcb->fd_array[1].file_op_table.open = NULL;
+    new_pcb->fd_array[1].file_op_table.close = NULL;
+    new_pcb->fd_array[1].inode = 0;
+    new_pcb->fd_array[1].fpos = 0;
+    new_pcb->fd_array[1].flags = 1;
+    new_pcb->fd_array[1].filetype = FILETYPE_TERMINAL;
+    new_pcb->fd_array[1].oflags = 0;
 
-    pcb_ptr->pid = global_pid;
-    pcb_ptr->args = local_name;
+    // initializing entries for fd 2-7 (i.e all except stdin and stdout) to NULL
+    for (i = 2; i < 8; i++){
+        new_pcb->fd_array[i].file_op_table.read = NULL;
+        new_pcb->fd_array[i].file_op_table.write = NULL;
+        new_pcb->fd_array[i].file_op_table.open = NULL;
+        new_pcb->fd_array[i].file_op_table.close = NULL;
+        new_pcb->fd_array[i].inode = 0;
+        new_pcb->fd_array[i].fpos = 0;
+        new_pcb->fd_array[i].flags = 0;
+        new_pcb->fd_array[i].oflags = 0;
+    }
+
+    // executable info used by the demand pager
+    new_pcb->exe_inode = temp.inode;
+    new_pcb->exe_size = size;
+    new_pcb->page_faults = 0;
+    new_pcb->text_pages = text_pages;
+    if (text_pages > 0){
+        text_map_get(temp.inode);
+    }
+
+    return new_pcb;
+}
+
+/* execute
+* INPUTS: command
+* OUTPUTS: none
+* RETURN: -1 if command can't be executed, 0-255 based on call's halt
+* DESCRIPTION: attempts to load and execute a new program, handing off the processor to the new program
+*/
+int32_t execute(const uint8_t* command){
+
+    uint32_t val;
+
+    // paramter validation
+    if(command == NULL){ 
+        return -1;
+    }
+
+    // the new program runs on the caller's terminal, so there is no need to wait for it to be scheduled.
+    // Interrupts stay off while this cpu's 128 MB window is on a page table no task owns yet
+    cli();
+
+    pcb_t* new_pcb;
+    pcb_t* parent;
+    int32_t parent_pid;
+    uint8_t background;
+    uint32_t old_ebp;
+    uint32_t old_esp;
+
+    new_pcb = program_load(command);
+    if (new_pcb == NULL){
+        sti();
+        return -1;
+    }
+
+    // a program started by spawn is not the terminal's foreground program, so its children are its own
+    background = pcb_ptr != NULL && pcb_ptr->background && pcb_ptr->terminal == running_terminal;
+    if (background){
+        parent = pcb_ptr;
+        parent_pid = pcb_ptr->pid;
+    }
+    else{
+        parent = terminal_arr[running_terminal].curr_pcb;
+        parent_pid = terminal_arr[running_terminal].curr_pid;
+    }
+
+    // the parent sleeps in execute until its child halts
+    if (parent != NULL){
+        parent->state = TASK_WAITING;
+    }
+
+    //intializing a process control block
+    pcb_ptr = new_pcb;
+    pcb_ptr->parent_pcb = (uint32_t) parent;
+
+    pcb_ptr->parent_pid = parent_pid;
+    pcb_ptr->detached = 0;
+    pcb_ptr->background = background;
+    
+    if (!background){
+        terminal_arr[running_terminal].curr_pid = global_pid;
+        terminal_arr[running_terminal].curr_pcb = pcb_ptr;
+    }
+    sched_task_init(pcb_ptr, running_terminal);
+    fpu_task_init(pcb_ptr);
+    fpu_switch(pcb_ptr);
+    TRACE(TRACE_EXECUTE, global_pid);
+    sysstat_pid_reset(global_pid);
 
     //restoring old ebp
     asm volatile ("             \n\
@@ -282,47 +560,25 @@ int32_t execute(const uint8_t* command){
     pcb_ptr->parent_ebp = old_ebp;
     pcb_ptr->parent_esp = old_esp;
 
-
-    // initializing entries for fd 2-7 (i.e all except stdin and stdout) to NULL
-    for (i = 2; i < 8; i++){
-        pcb_ptr->fd_array[i].file_op_table.read = NULL;
-        pcb_ptr->fd_array[i].file_op_table.write = NULL;
-        pcb_ptr->fd_array[i].file_op_table.open = NULL;
-        pcb_ptr->fd_array[i].file_op_table.close = NULL;
-        pcb_ptr->fd_array[i].inode = 0;
-        pcb_ptr->fd_array[i].fpos = 0;
-        pcb_ptr->fd_array[i].flags = 0;
-    }
-
-    // loading file contents into buf
-    if (read_data(dentry_ptr[index].inode, 24, buf, 4) == -1) {  
-        sti();
-		return -1;
-	}
-
-    // starting address of first instructions to be executed (given in doc)
-    user_eip = (buf[3] << 24) + (buf[2] << 16) + (buf[1] << 8) + buf[0];
-    
     // setting fields to tss to switch to the kernel stack
-    tss.esp0 = EIGHT_MB - (EIGHT_KB * (global_pid)) - 4;
-    tss.ss0 = KERNEL_DS;
-    terminal_arr[terminal_id].esp0_term = tss.esp0;
-    terminal_arr[terminal_id].ss0_term = tss.ss0;
+    this_cpu()->tss->esp0 = (uint32_t)pcb_ptr + EIGHT_KB - 4;
+    this_cpu()->tss->ss0 = KERNEL_DS;
 
     val = pcb_ptr->parent_pcb;
-    pcb_ptr->parent_esp0 = tss.esp0;
-    pcb_ptr->parent_ss0 = tss.ss0;
+    pcb_ptr->parent_esp0 = this_cpu()->tss->esp0;
+    pcb_ptr->parent_ss0 = this_cpu()->tss->ss0;
 
+    kernel_exit(1);         // the program runs outside the kernel lock, interrupts stay off until the iret
 
-    // inline assembly to push iret context to stack
-    sti();
 
+    // inline assembly to push iret context to stack, interrupts come back on with the user program's eflags
     //$0x083FFFFC: (132MB-4Bytes): User program ESP
     asm volatile ("                 \n\
             pushl   %0              \n\
             movl $0x083FFFFC, %%esi \n\
             pushl %%esi             \n\
             pushfl                  \n\
+            orl $0x200, (%%esp)     \n\
             pushl   %1              \n\
             pushl   %2              \n\
             iret                    \n\
@@ -337,6 +593,88 @@ int32_t execute(const uint8_t* command){
     return 0;
 }
 
+/* spawn_fd_init
+* INPUTS: child, fd, src - fd of the caller to copy, -1 to keep the terminal
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: gives the child a copy of one of the caller's fds, pipes and the rtc count the extra end
+*/
+static void spawn_fd_init(pcb_t* child, int32_t fd, int32_t src){
+    if (src < 0){
+        return;
+    }
+    child->fd_array[fd] = pcb_ptr->fd_array[src];
+    if (child->fd_array[fd].filetype == FILETYPE_PIPE){
+        pipe_dup(child->fd_array[fd].inode, child->fd_array[fd].fpos);
+    }
+    if (child->fd_array[fd].filetype == 0){      // the child closes its rtc file too
+        rtc_open(NULL);
+    }
+}
+
+/* spawn
+* INPUTS: command, fd_in, fd_out - fds of the caller that become the child's stdin and stdout,
+*         -1 leaves that one on the terminal
+* OUTPUTS: none
+* RETURN: pid of the new process, -1 if the command can't be executed
+* DESCRIPTION: starts a program that runs next to the caller instead of in its place. Nobody waits for
+*              it, halt just frees it. The shell runs the stages of a pipeline this way
+*/
+int32_t spawn(const uint8_t* command, int32_t fd_in, int32_t fd_out){
+    pcb_t* caller = pcb_ptr;
+    pcb_t* child;
+    uint32_t* frame;
+    int32_t pid;
+
+    // parameter validation
+    if (command == NULL || caller == NULL ||
+        fd_in < -1 || fd_in > 7 || (fd_in >= 0 && caller->fd_array[fd_in].flags == 0) ||
+        fd_out < -1 || fd_out > 7 || (fd_out >= 0 && caller->fd_array[fd_out].flags == 0)){
+        return -1;
+    }
+
+    cli();
+    child = program_load(command);
+    if (child == NULL){
+        sti();
+        return -1;
+    }
+    global_pid = caller->pid;       // the caller keeps running, give it its window back
+    flush_tlb(global_pid);
+
+    child->parent_pcb = (uint32_t)caller;
+    child->parent_pid = caller->pid;
+    child->detached = 1;
+    child->background = 1;
+    sched_task_init(child, caller->terminal);
+    fpu_task_init(child);
+    sysstat_pid_reset(child->pid);
+    spawn_fd_init(child, 0, fd_in);
+    spawn_fd_init(child, 1, fd_out);
+
+    child->parent_esp0 = (uint32_t)child + EIGHT_KB - 4;
+    child->parent_ss0 = KERNEL_DS;
+
+    // what task_resume pops at the top of the kernel stack: a saved ebp, a return address into an
+    // iret, and the iret frame entering the program with interrupts on
+    frame = (uint32_t*)child->parent_esp0 - SPAWN_FRAME_WORDS;
+    frame[0] = 0;
+    frame[1] = (uint32_t)task_start_linkage;
+    frame[2] = user_eip;
+    frame[3] = USER_CS;
+    frame[4] = EFLAGS_IF;
+    frame[5] = USER_STACK;
+    frame[6] = USER_DS;
+    child->esp_saved = (uint32_t)frame;
+    child->ebp_saved = (uint32_t)frame;
+
+    pid = child->pid;       // the child may run and halt as soon as interrupts are back on
+    TRACE(TRACE_EXECUTE, pid);
+    sched_start(child);
+    sti();
+    return pid;
+}
+
 
 /* read
 * INPUTS: fd, buf, nbytes
@@ -347,7 +685,7 @@ int32_t execute(const uint8_t* command){
 int32_t read(int32_t fd, void* buf, int32_t nbytes){
     // printf("system_calls.c: System Call Read\n");
 
-    pcb_t* curr_pcb = terminal_arr[terminal_id].curr_pcb;
+    pcb_t* curr_pcb = pcb_ptr;
 
     if (nbytes == 0){ 
         return 0;
@@ -357,15 +695,8 @@ int32_t read(int32_t fd, void* buf, int32_t nbytes){
         return -1;
     }
 
-    if(fd == 0){        // stdin case
-        return terminal_read(fd, buf, nbytes);
-    }
-
-    if(fd == 1){        // nothing to be done for stdout
-        return -1;
-    }
-
-    if(pcb_ptr->fd_array[fd].flags == 0){       // if not present return -1
+    // stdin and stdout go through their table too, either may be a pipe
+    if(pcb_ptr->fd_array[fd].flags == 0 || curr_pcb->fd_array[fd].file_op_table.read == NULL){
     return -1;
     }
     
@@ -380,7 +711,7 @@ int32_t read(int32_t fd, void* buf, int32_t nbytes){
 */
 int32_t write(int32_t fd, const void* buf, int32_t nbytes){
     // printf("system_calls.c: System Call Write\n");
-    pcb_t* curr_pcb = terminal_arr[terminal_id].curr_pcb;
+    pcb_t* curr_pcb = pcb_ptr;
 
     if (nbytes == 0) {
         return 0;
@@ -390,15 +721,8 @@ int32_t write(int32_t fd, const void* buf, int32_t nbytes){
         return -1;
     }
 
-    if(fd == 0){        // nothing to be done for stdin
-        return -1;
-    }
-
-    if(fd == 1){       // stdout case
-        return terminal_write(fd, buf, nbytes);
-    }
-
-    if(pcb_ptr->fd_array[fd].flags == 0){       // if not present return -1
+    // stdin and stdout go through their table too, either may be a pipe
+    if(pcb_ptr->fd_array[fd].flags == 0 || curr_pcb->fd_array[fd].file_op_table.write == NULL){
     return -1;
     }
 
@@ -408,22 +732,35 @@ int32_t write(int32_t fd, const void* buf, int32_t nbytes){
 /* open
 * INPUTS: filename
 * OUTPUTS: none
-* RETURN: number of bytes written or -1 on failure
+* RETURN: file descriptor or -1 on failure
 * DESCRIPTION: provides access to file system by finding directory entry corresponding to filename
 */
 int32_t open(const uint8_t* filename){
+    return open_flags(filename, 0);
+}
+
+/* open_flags
+* INPUTS: filename, oflags - O_CREATE, O_TRUNC, O_APPEND
+* OUTPUTS: none
+* RETURN: file descriptor or -1 on failure
+* DESCRIPTION: open with flags for writable files. A separate call so programs built for the old
+*              one argument open, which leave garbage in ecx, keep working
+*/
+int32_t open_flags(const uint8_t* filename, int32_t oflags){
     // printf("System Call Open\n");
     int temp_flag = 0;
     int fd = 0;
     int i = 0;
+    int found;
 
     if(filename == NULL){ //parameter validation
         return -1;
     }
 
-    pcb_t* curr_pcb = terminal_arr[terminal_id].curr_pcb;
+    pcb_t* curr_pcb = pcb_ptr;
     dentry_t temp_dentry;
-    if(read_dentry_by_name(filename, (&temp_dentry)) == -1){
+    found = read_dentry_by_name(filename, (&temp_dentry)) == 0 || kfile_lookup(filename, (&temp_dentry)) == 0;
+    if(!found && !(oflags & O_CREATE)){
         return -1;
     }
 
@@ -437,6 +774,9 @@ int32_t open(const uint8_t* filename){
     if(temp_flag == 0){ // if no entry in fd table available, return error
         return -1; 
     }
+    if(!found && file_create(filename, (&temp_dentry)) == -1){     // only once there is an fd for it
+        return -1;
+    }
 
     switch(temp_dentry.filetype){
         case 0:     // RTC file
@@ -445,6 +785,9 @@ int32_t open(const uint8_t* filename){
         (curr_pcb->fd_array[fd]).file_op_table.open = rtc_open;
         (curr_pcb->fd_array[fd]).file_op_table.close = rtc_close;
         (curr_pcb->fd_array[fd]).fpos = -1;
+        (curr_pcb->fd_array[fd]).rtc_divider = MAX_RTC_FREQ / MIN_RTC_FREQ;     // 2 Hz, required by addendum
+        (curr_pcb->fd_array[fd]).rtc_counter = MAX_RTC_FREQ / MIN_RTC_FREQ;
+        (curr_pcb->fd_array[fd]).rtc_pending = 0;
         break;
 
         case 1:     // Directory
@@ -461,6 +804,14 @@ int32_t open(const uint8_t* filename){
         (curr_pcb->fd_array[fd]).file_op_table.open = file_open;
         (curr_pcb->fd_array[fd]).file_op_table.close = file_close;
         (curr_pcb->fd_array[fd]).fpos = 0;
+        if((oflags & O_TRUNC) && truncate_data(temp_dentry.inode, 0) == -1){     // the text of a running program
+            return -1;
+        }
+        break;
+
+        case FILETYPE_KFILE:     // file provided by the kernel
+        (curr_pcb->fd_array[fd]).file_op_table = kfile_table[temp_dentry.inode].ops;
+        (curr_pcb->fd_array[fd]).fpos = 0;
         break;
 
         default:
@@ -470,9 +821,11 @@ int32_t open(const uint8_t* filename){
     (curr_pcb->fd_array[fd]).inode = temp_dentry.inode;
     (curr_pcb->fd_array[fd]).flags = 1;
     (curr_pcb->fd_array[fd]).filetype = temp_dentry.filetype;
+    (curr_pcb->fd_array[fd]).oflags = oflags;
 
     // checking if file can be opened or not
     if((curr_pcb->fd_array[fd]).file_op_table.open(filename) < 0){
+        (curr_pcb->fd_array[fd]).flags = 0;     // give the fd back
         return -1;
     }
 
@@ -487,7 +840,7 @@ int32_t open(const uint8_t* filename){
 */
 int32_t close(int32_t fd){
     // printf("System Call Close\n");
-    pcb_t* curr_pcb = terminal_arr[terminal_id].curr_pcb;
+    pcb_t* curr_pcb = pcb_ptr;
     
     // parameter validation
     if (fd < 2 || fd > 7) {
@@ -511,6 +864,7 @@ int32_t close(int32_t fd){
     (curr_pcb->fd_array[fd]).fpos = 0;
     (curr_pcb->fd_array[fd]).filetype = -1;
     (curr_pcb->fd_array[fd]).flags = 0;
+    (curr_pcb->fd_array[fd]).oflags = 0;
 
     return 0;
 }
@@ -525,7 +879,7 @@ int32_t getargs(uint8_t* buf, int32_t nbytes){
     // printf("System Call getargs\n");
     uint32_t i = 0;
     uint32_t counter = 0;
-    pcb_t* curr_pcb = terminal_arr[terminal_id].curr_pcb;
+    pcb_t* curr_pcb = pcb_ptr;
     uint8_t *tmp = curr_pcb->args;
     uint32_t size = strlen((int8_t*)tmp);
 
@@ -578,10 +932,13 @@ int32_t vidmap(uint8_t** screen_start){
     (int)screen_start > (int)ONETHIRTYTWO_MB){
         return -1;
     }
-    // creating 4kB page at 132 MB virtual
-    vidmem_assign(terminal_arr[terminal_id].vmem_location);
+    // creating 4kB page at 132 MB virtual, it starts out as a copy of the screen
+    memcpy((uint8_t*)terminal_arr[running_terminal].vidmap_location,
+           (uint8_t*)(terminal_arr[running_terminal].vmem_location + terminal_arr[running_terminal].top_line * LINE_BYTES), SCREEN_BYTES);
+    vidmem_assign(terminal_arr[running_terminal].vidmap_location);
+    terminal_arr[running_terminal].vidmapped = 1;
 
-    *screen_start = (uint8_t*)(terminal_arr[terminal_id].vmem_location); 
+    *screen_start = (uint8_t*)VIDMAP_ADDR; 
     return (int32_t)(*screen_start);
 }
 
@@ -607,3 +964,23 @@ int32_t sigreturn(void){
     return 0;
 }
 
+/* sysenter_init
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: 1 if sysenter is set up, 0 if the cpu lacks it and only int $0x80 works
+* DESCRIPTION: points the sysenter msrs of the running cpu at sysenter_linkage. The gdt already has the
+*              layout sysenter and sysexit assume: kernel data right after kernel code, then user code and
+*              user data
+*/
+int32_t sysenter_init(void){
+    uint32_t eax, ebx, ecx, edx;
+
+    cpuid(1, &eax, &ebx, &ecx, &edx);
+    if (!(edx & CPUID_SEP)){
+        return 0;
+    }
+    wrmsr(MSR_SYSENTER_CS, KERNEL_CS);
+    wrmsr(MSR_SYSENTER_ESP, (uint32_t)&this_cpu()->sysenter_stack[SYSENTER_STACK_WORDS]);     // per cpu, sysenter_linkage moves to tss.esp0 right away
+    wrmsr(MSR_SYSENTER_EIP, (uint32_t)sysenter_linkage);
+    return 1;
+}
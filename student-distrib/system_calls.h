@@ -6,6 +6,8 @@
 #include "rtc.h"
 #include "x86_desc.h"
 #include "paging.h"
+#include "frame.h"
+#include "fpu.h"
 
 #if !defined(SYSTEM_CALLS_H)
 #define SYSTEM_CALLS_H
@@ -15,6 +17,29 @@
 #define ADDR_OFFSET 0x4
 #define ONETWENTYEIGHT_MB 0x8000000
 #define ONETHIRTYTWO_MB 0x8400000
+#define PROGRAM_IMAGE_ADDR 0x08048000
+#define MAX_PIDS 64     // pids come from a bitmap, kernel stacks and pages from the frame allocator
+#define ARGS_MAX 128    // command line kept for getargs, as long as a terminal line
+
+// first frame of a task made by spawn: saved ebp, return address, then eip, cs, eflags, esp, ss for iret
+#define SPAWN_FRAME_WORDS 7
+#define EFLAGS_IF 0x202
+#define USER_STACK 0x083FFFFC
+
+// ELF header fields used by the program loader
+#define ELF_HEADER_SIZE 52
+#define ELF_PHOFF 28
+#define ELF_PHENTSIZE 42
+#define ELF_PHNUM 44
+#define ELF_PHDR_MAX 8
+#define PT_LOAD 1
+#define PF_W 0x2
+
+// fast system calls
+#define CPUID_SEP (1 << 11)
+#define MSR_SYSENTER_CS 0x174
+#define MSR_SYSENTER_ESP 0x175
+#define MSR_SYSENTER_EIP 0x176
 
 
 extern int32_t halt(uint8_t status);
@@ -23,17 +48,33 @@ extern int32_t execute(const uint8_t* command);
 extern int32_t read(int32_t fd, void* buf, int32_t nbytes);
 extern int32_t write(int32_t fd, const void* buf, int32_t nbytes);
 extern int32_t open(const uint8_t* filename);
+extern int32_t open_flags(const uint8_t* filename, int32_t oflags);
 extern int32_t close(int32_t fd);
 extern int32_t getargs(uint8_t* buf, int32_t nbytes);
 extern int32_t vidmap(uint8_t** screen_start);
 extern int32_t set_handler(int32_t signum, void* handler_address);
 extern int32_t sigreturn(void);
+extern int32_t spawn(const uint8_t* command, int32_t fd_in, int32_t fd_out);
+extern int32_t sysenter_init(void);
 
 extern int32_t get_global_pid();
 extern int32_t get_free_pid();
+extern struct pcb_struct* get_pcb(uint32_t pid);
 
 // extern void hardcodepcb();
 
+typedef struct __attribute__((packed)) elf_phdr_struct
+{
+    uint32_t type;
+    uint32_t offset;
+    uint32_t vaddr;
+    uint32_t paddr;
+    uint32_t filesz;
+    uint32_t memsz;
+    uint32_t flags;
+    uint32_t align;
+} elf_phdr_t;
+
 typedef struct __attribute__((packed)) helper_struct
 {
     int32_t (*open)(const uint8_t* filename);
@@ -50,6 +91,12 @@ typedef struct __attribute__((packed)) fd_struct
     uint32_t fpos;
     uint8_t filetype;
     uint32_t flags;
+    uint32_t oflags;        // O_APPEND and friends from open_flags
+
+    // virtual rtc, counted in MAX_RTC_FREQ hardware ticks
+    uint32_t rtc_divider;
+    uint32_t rtc_counter;
+    uint32_t rtc_pending;
 } fd_t;
 
 typedef struct __attribute__((packed)) pcb_struct         
@@ -59,17 +106,47 @@ typedef struct __attribute__((packed)) pcb_struct
     uint32_t pid;
     uint32_t parent_ebp;
     uint32_t parent_esp;
-    uint8_t* args;
+    uint8_t args[ARGS_MAX];
     uint32_t parent_esp0;
     uint16_t parent_ss0;
     //uint32_t terminal_id;
     int32_t parent_pid;
+    uint8_t detached;       // started by spawn, halt frees it without returning to a parent
+    uint8_t background;     // not on the terminal's chain of foreground programs
+
+    // demand paging
+    uint32_t exe_inode;
+    uint32_t exe_size;
+    uint32_t page_faults;
+    uint32_t text_pages;
+    page_table_entry_t* page_table;     // 128 MB window, from user_table_alloc
+
+    // scheduling
+    uint32_t esp_saved;
+    uint32_t ebp_saved;
+    uint8_t terminal;
+    uint8_t cpu;            // where it last ran
+    uint8_t state;
+    uint8_t priority;
+    uint32_t timeslice;
+    wait_queue_t* wait_queue;
+    struct pcb_struct* queue_next;      // run queue or wait queue link
+
+    // lazy fpu, the registers only come here when another task takes the fpu
+    uint8_t fpu_used;
+    uint8_t fpu_state[FPU_STATE_BYTES + FPU_STATE_ALIGN];
 } pcb_t;
 
-pcb_t* pcb_ptr;
-extern uint32_t global_pid;
+// the task running on this cpu and its pid, kept in the cpu's cpu_t
+#define pcb_ptr (this_cpu()->current)
+#define global_pid (this_cpu()->pid)
+
+extern uint8_t loader_zero_copy;
+extern uint8_t loader_demand_paging;
+extern uint32_t last_halt_page_faults;
+extern uint32_t last_halt_text_pages;
 
-extern uint8_t pid_num[6];
+extern int32_t user_page_fault(uint32_t fault_addr);
 
 
 #endif
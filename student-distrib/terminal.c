@@ -1,16 +1,23 @@
 #include "terminal.h"
 #include "system_calls.h"
+#include "spinlock.h"
 
-// #define TERM1_BUFFER 0xB9000
-// #define TERM2_BUFFER 0xBA000
-// #define TERM3_BUFFER 0xBB000
 // #define FOUR_KB 0x1000
 // #define VIDEO 0xB8000
 
+static uint8_t terminal_text[3][TERM_BUF_BYTES];       // screen and scrollback of each terminal
+static uint8_t terminal_vidmap[3][FOUR_KB] __attribute__((aligned(FOUR_KB)));      // pages handed out by vidmap
 
 volatile uint32_t terminal_id;
-int8_t terminal_switch_flag = 0;
-terminal_t terminal_arr[3];
+// the buffers are set here rather than in terminal_init since the kernel prints before calling it
+terminal_t terminal_arr[3] = {
+    {.vmem_location = (uint32_t)terminal_text[0], .vidmap_location = (uint32_t)terminal_vidmap[0]},
+    {.vmem_location = (uint32_t)terminal_text[1], .vidmap_location = (uint32_t)terminal_vidmap[1]},
+    {.vmem_location = (uint32_t)terminal_text[2], .vidmap_location = (uint32_t)terminal_vidmap[2]}
+};
+wait_queue_t terminal_read_queue[3];    // tasks blocked in terminal_read until a line is entered on that terminal
+volatile int32_t terminal_shell_pending = -1;       // terminal switched to without a base shell, -1 if none
+static spinlock_t terminal_lock = SPINLOCK_INIT("terminal");     // the visible terminal and terminal_shell_pending
 
 /*
  * 	terminal_open
@@ -38,11 +45,11 @@ int32_t terminal_close(int32_t fd){
 
 /*
  * 	terminal_read
- *   DESCRIPTION: Read keyboard buffer and copy it to user buffer
+ *   DESCRIPTION: Copy the next line typed on the task's terminal to user buffer
  *   INPUTS: unsigned char* buf, int32_t count
  *   OUTPUTS: none
  *   RETURN VALUE: number of bytes copied
- *   SIDE EFFECTS: keyboard buffer gets cleared after copy
+ *   SIDE EFFECTS: the line is taken out of the input ring, what does not fit in buf is dropped
  */
 int32_t terminal_read(int32_t fd, void* buf_arg, int32_t count){
     //check if number of bytes to be read between 0 and 128 or buf == NULL, return -1
@@ -51,48 +58,33 @@ int32_t terminal_read(int32_t fd, void* buf_arg, int32_t count){
     }
     uint8_t* buf = (uint8_t*)buf_arg;
     if (buf == NULL || count < 0 || count > 128){return -1;}
-    unsigned int num, final_count;
-
-    //run in an infinite loop until a newline character printed
-    while (line_buffer[line_buf_index] != '\n'){}
-
-    //critical section
-    cli();
-    //check if the line buffer index is less than count (if so, only read number of bytes as typed) 
-    if (line_buf_index < count){
-        final_count = line_buf_index;
-    }
-    else{
-        final_count = count;
-    }
-
-    //if count <= terminal_arr[terminal_id].terminal_buf_index, add a newline manually at the end
-    if (count <= line_buf_index){
-        for (num = 0; num < final_count; num++){
-            buf[num] = line_buffer[num]; 
-        }
-        buf[num] = '\n';
+    uint32_t id = (pcb_ptr != NULL) ? pcb_ptr->terminal : terminal_id;
+    terminal_t* term = &terminal_arr[id];
+    uint32_t head, tail, flags, num = 0;
+    uint8_t c;
+
+    //sleep until a line is entered on the terminal this task belongs to, lines typed earlier are already there
+    cli_and_save(flags);
+    while (term->input_head == term->input_tail){
+        sleep_on(&terminal_read_queue[id]);
     }
-    //copy all the bytes from line buffer to user buffer
-    else{
-        //add extra count to final to account for newline character
-        for (num = 0; num < final_count + 1; num++){
-            buf[num] = line_buffer[num]; 
+    restore_flags(flags);
+
+    //only whole lines are published, so a newline comes before head
+    head = term->input_head;
+    tail = term->input_tail;
+    do {
+        c = term->input_ring[tail & (INPUT_RING_SIZE - 1)];
+        tail++;
+        if (num < count){
+            buf[num++] = c;
         }
-        final_count++;
-    }
-        
-    // clear line buffer by setting each character to NULL
-    for (num = 0; num < line_buf_index + 1; num++){ //add extra count to final count to account for newline character
-        line_buffer[num] = NULL;
-    }
+    } while (c != '\n' && tail != head);
 
-    sti();
+    barrier();      // done with the bytes before the keyboard handler may reuse them
+    term->input_tail = tail;
 
-    //reset index to 0
-    line_buf_index = 0;
-
-    return final_count;
+    return num;
 }
 
 /*
@@ -114,8 +106,8 @@ int32_t terminal_write(int32_t fd, const void* buf_arg, int32_t count){
             putc(buf[num]);
         }
     }
+    video_flush(running_terminal);
 
-    
     //return number of bytes written
     return count;
 }
@@ -130,25 +122,22 @@ void terminal_init(void){
     terminal_id = 0;
     int i = 0;
     for(i = 0; i < 3; i++){         // initializing fields of terminal structs for all terminals
-        terminal_arr[i].ebp_saved = 0;
-        terminal_arr[i].esp_saved = 0;
-        terminal_arr[i].terminal_buf[0] = (uint8_t)'\0';
-        terminal_arr[i].terminal_buf_index = 0;
+        terminal_arr[i].input_head = 0;
+        terminal_arr[i].input_tail = 0;
+        terminal_arr[i].input_edit = 0;
 
         terminal_arr[i].key_curr = -1;
         terminal_arr[i].cursor_xpos = 0;
         terminal_arr[i].cursor_ypos = 0;
-        
+        terminal_arr[i].vidmapped = 0;
+        video_reset(i);
+
         terminal_arr[i].curr_pcb = NULL;
         terminal_arr[i].curr_pid = -1;
         terminal_arr[i].curr_rtc = -1;
+        wait_queue_init(&terminal_read_queue[i]);
 
     }
-    // assinging video memory locations for terminals
-    terminal_arr[0].vmem_location = (uint32_t)TERM1_BUFFER;
-    terminal_arr[1].vmem_location = (uint32_t)TERM2_BUFFER;
-    terminal_arr[2].vmem_location = (uint32_t)TERM3_BUFFER;
-
     return;
 }
 
@@ -156,56 +145,155 @@ void terminal_init(void){
 * INPUTS: new_terminal
 * OUTPUTS: none
 * RETURN: none
-* DESCRIPTION: used for terminal switching
+* DESCRIPTION: used for terminal switching, called from the keyboard bottom half with interrupts on
 */
 void terminal_switch(uint32_t new_terminal){
+    uint32_t flags;
 
-    cli();
-
+    spin_lock_irqsave(&terminal_lock, flags);
     if (new_terminal == terminal_id){       //  no need to switch to the same terminal
+        spin_unlock_irqrestore(&terminal_lock, flags);
         return;
     }
 
-    disable_page(terminal_arr[terminal_id].vmem_location);      // disabling paging
+    terminal_id = new_terminal;
 
-    memcpy((uint8_t*)(VIDEO + (FOUR_KB * (terminal_id+1))), (uint8_t*)(VIDEO), FOUR_KB);        // copying from vmem to terminal buffer
-    memcpy((uint8_t*)(VIDEO), (uint8_t*)(VIDEO + (FOUR_KB * (new_terminal+1))), FOUR_KB);       // copying from terminal buffer to vmem
+    // the buffers always hold each terminal's text, so only the new one has to be copied in
+    video_show(new_terminal);
+    terminal_switch_cursor(terminal_arr[new_terminal].cursor_xpos, terminal_arr[new_terminal].cursor_ypos);
 
-    
-    memcpy((uint8_t*)(terminal_arr[terminal_id].terminal_buf), (uint8_t*)(line_buffer), 128);      // copying over from global line buffer to corresponding terminal buffer
-    terminal_arr[terminal_id].terminal_buf_index = line_buf_index;
-    memcpy((uint8_t*)(line_buffer), (uint8_t*)(terminal_arr[new_terminal].terminal_buf), 128);
-    line_buf_index = terminal_arr[new_terminal].terminal_buf_index;
+    // dynamically initializing shells in new terminals if they dont have a base shell. A bottom half
+    // can't leave the task it runs on, so the next pit tick starts it
+    if((terminal_arr[new_terminal].curr_pcb == NULL)){
+        terminal_shell_pending = new_terminal;
+    }
+    spin_unlock_irqrestore(&terminal_lock, flags);
 
-    enable_page(terminal_arr[new_terminal].vmem_location);      // enabling paging for the new terminal's video memory
+    return;
 
-    // updating cursor positions and saving previous terminal's cursor
-    int* pos = get_screen_coords();
-    terminal_arr[terminal_id].cursor_xpos = pos[0];
-    terminal_arr[terminal_id].cursor_ypos = pos[1];
+}
 
-    change_cursor(terminal_arr[new_terminal].cursor_xpos, terminal_arr[new_terminal].cursor_ypos);
+/* terminal_shell_take
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: the terminal waiting for a base shell, -1 if none
+* DESCRIPTION: claims the pending base shell so exactly one cpu starts it, called from the pit handler
+*/
+int32_t terminal_shell_take(void){
+    uint32_t flags;
+    int32_t terminal;
+
+    spin_lock_irqsave(&terminal_lock, flags);
+    terminal = terminal_shell_pending;
+    terminal_shell_pending = -1;
+    spin_unlock_irqrestore(&terminal_lock, flags);
+    return terminal;
+}
 
-       if((terminal_arr[new_terminal].curr_pcb == NULL)){       // dynamically initializing shells in new terminals if they dont have a base shell
-        send_eoi(1);
-        sti();
-        terminal_id = new_terminal;
-        terminal_switch_flag = 1;
-        running_terminal = new_terminal;
-        execute((uint8_t*)"shell");
-    }
+/* visible_begin
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: the terminal that was running
+* DESCRIPTION: lets the keyboard handler print to the visible terminal whichever task it interrupted
+*/
+static int32_t visible_begin(void){
+    int32_t saved = running_terminal;
+    running_terminal = terminal_id;
+    return saved;
+}
 
-    if (terminal_arr[new_terminal].curr_pcb != NULL){
-        pcb_ptr = terminal_arr[new_terminal].curr_pcb;
-    }
+/* visible_end
+* INPUTS: saved - value returned by visible_begin
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: shows what was echoed and gives the interrupted task its terminal back
+*/
+static void visible_end(int32_t saved){
+    video_flush(terminal_id);
+    running_terminal = saved;
+}
 
-    terminal_id = new_terminal;
-    running_terminal = new_terminal;        // updating running terminal
+/* terminal_echo
+* INPUTS: c
+* OUTPUTS: c on the visible terminal
+* RETURN: none
+* DESCRIPTION: echoes a typed character, called from the keyboard bottom half
+*/
+void terminal_echo(uint8_t c){
+    int32_t saved = visible_begin();
+    terminal_arr[terminal_id].view_back = 0;       // typing jumps back to the live screen
+    putc(c);
+    visible_end(saved);
+}
+
+/* terminal_clear
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: clears the visible terminal (ctrl-l), called from the keyboard bottom half
+*/
+void terminal_clear(void){
+    int32_t saved = visible_begin();
+    clear();
+    visible_end(saved);
+}
 
-    send_eoi(1);        // sending eoi signal
-    sti();
+/* terminal_input_room
+* INPUTS: terminal
+* OUTPUTS: none
+* RETURN: number of characters that can still be typed on the line being edited
+* DESCRIPTION: a line holds INPUT_LINE_MAX characters, and the ring always keeps a byte for its newline
+*/
+uint32_t terminal_input_room(uint32_t terminal){
+    terminal_t* term = &terminal_arr[terminal];
+    uint32_t used = term->input_edit - term->input_tail;
+    uint32_t line = term->input_edit - term->input_head;
 
-    return;
+    if (used >= INPUT_RING_SIZE - 1 || line >= INPUT_LINE_MAX){
+        return 0;
+    }
+    if (INPUT_RING_SIZE - 1 - used < INPUT_LINE_MAX - line){
+        return INPUT_RING_SIZE - 1 - used;
+    }
+    return INPUT_LINE_MAX - line;
+}
+
+/* terminal_input_put
+* INPUTS: terminal, c
+* OUTPUTS: none
+* RETURN: 1 if c went on the line, 0 if there is no room for it
+* DESCRIPTION: producer side of the input ring, only the keyboard handler calls it. A newline
+*              publishes the line to terminal_read and wakes the reader
+*/
+int32_t terminal_input_put(uint32_t terminal, uint8_t c){
+    terminal_t* term = &terminal_arr[terminal];
+
+    if (c == '\n' ? term->input_edit - term->input_tail >= INPUT_RING_SIZE : terminal_input_room(terminal) == 0){
+        return 0;
+    }
+    term->input_ring[term->input_edit & (INPUT_RING_SIZE - 1)] = c;
+    term->input_edit++;
 
+    if (c == '\n'){
+        barrier();      // the line is in the ring before terminal_read can see it
+        term->input_head = term->input_edit;
+        wake_up(&terminal_read_queue[terminal]);
+    }
+    return 1;
 }
 
+/* terminal_input_erase
+* INPUTS: terminal
+* OUTPUTS: none
+* RETURN: 1 if a character was taken off the line, 0 if the line is empty
+* DESCRIPTION: backspace, only the unpublished line can be edited
+*/
+int32_t terminal_input_erase(uint32_t terminal){
+    terminal_t* term = &terminal_arr[terminal];
+
+    if (term->input_edit == term->input_head){
+        return 0;
+    }
+    term->input_edit--;
+    return 1;
+}
@@ -8,26 +8,34 @@
 
 
 
-#define TERM1_BUFFER 0xB9000
-#define TERM2_BUFFER 0xBA000
-#define TERM3_BUFFER 0xBB000
 #define FOUR_KB 0x1000
+#define SCREEN_BYTES 4000       // 80x25 cells of character and attribute
+#define LINE_BYTES 160
+#define TERM_LINES 200          // lines per terminal buffer, all of them fit in the 32 kb vga text window
+#define TERM_BUF_BYTES (TERM_LINES * LINE_BYTES)
+#define SCROLLBACK_KEEP 100     // lines of history kept when a full buffer is compacted
+#define SCROLLBACK_STEP 12      // lines moved by shift+pgup/pgdn
+#define FILETYPE_TERMINAL 4     // filetype of stdin and stdout, never found in a dentry
+#define INPUT_RING_SIZE 512     // typed bytes a terminal holds, a power of two
+#define INPUT_LINE_MAX 127      // characters on one line, the newline makes 128
 
 int32_t terminal_open(const uint8_t* filename);
 int32_t terminal_close(int32_t fd);
 int32_t terminal_read(int32_t fd, void* buf_arg, int32_t count);
 int32_t terminal_write(int32_t fd, const void* buf_arg, int32_t count);
 
-extern int8_t terminal_switch_flag;
-
 // terminal struct
 typedef struct __attribute__((packed)) terminal_struct         
 {
     int8_t curr_pid;
-    uint32_t esp_saved;
-    uint32_t ebp_saved;
-    uint8_t terminal_buf[128];        // max 128 allowed in line buf
-    uint32_t terminal_buf_index; 
+
+    // typed input, a single producer single consumer ring. The keyboard handler fills
+    // [input_head, input_edit) with the line being edited and publishes it by moving input_head
+    // past the newline, terminal_read consumes from input_tail. Each index has one writer
+    uint8_t input_ring[INPUT_RING_SIZE];
+    volatile uint32_t input_head;
+    volatile uint32_t input_tail;
+    uint32_t input_edit;
 
     // pcb-related
     pcb_t* curr_pcb;
@@ -37,22 +45,35 @@ typedef struct __attribute__((packed)) terminal_struct
     uint8_t cursor_xpos;
     uint8_t cursor_ypos;
 
-    //vmem
+    //vmem, the screen is lines [top_line, top_line + 25) of the buffer and the lines above it are
+    //scrollback. The visible buffer is mirrored at the same offsets in video memory, where
+    //[dirty_start, dirty_end) still has to be copied
     uint32_t vmem_location;
-
-    uint32_t esp0_term;
-    uint16_t ss0_term;
+    uint16_t top_line;
+    uint16_t view_back;     // lines the view is scrolled back from top_line
+    uint16_t dirty_start;
+    uint16_t dirty_end;
+    uint32_t vidmap_location;
+    uint8_t vidmapped;      // a program draws into vidmap_location, copied to the screen every tick
 
     // rtc
     volatile uint32_t curr_rtc;
 } terminal_t; 
 
 extern terminal_t terminal_arr[3];
+extern wait_queue_t terminal_read_queue[3];
 
 extern volatile uint32_t terminal_id;
+extern volatile int32_t terminal_shell_pending;
 
 void terminal_init(void);
 void terminal_switch(uint32_t new_terminal);
+int32_t terminal_shell_take(void);
+void terminal_echo(uint8_t c);
+void terminal_clear(void);
+uint32_t terminal_input_room(uint32_t terminal);
+int32_t terminal_input_put(uint32_t terminal, uint8_t c);
+int32_t terminal_input_erase(uint32_t terminal);
 
 #endif
 
@@ -6,6 +6,15 @@
 #include "filesystem.h"
 #include "system_calls.h"
 #include "rtc.h"
+#include "trace.h"
+#include "sysstat.h"
+#include "pipe.h"
+#include "softirq.h"
+#include "timer.h"
+#include "apic.h"
+#include "clock.h"
+#include "smp.h"
+#include "spinlock.h"
 
 #define PASS 1
 #define FAIL 0
@@ -714,6 +723,1223 @@ int generic_system_call(){
 /* Checkpoint 4 tests */
 /* Checkpoint 5 tests */
 
+/* Performance tests */
+
+#define READ_BENCH_REPS 16
+
+static uint8_t read_bench_buf[40 * 1024];		// large enough for fish (36 KB)
+
+/* read_data_benchmark
+ * 
+ * Times read_data over whole files and reports the copy cost
+ * Inputs: None
+ * Outputs: cycles per KB for fish and the large text file
+ * Side Effects: None
+ * Coverage: read_data
+ * Files: filesystem.h/c
+ */
+int read_data_benchmark(){
+	TEST_HEADER;
+
+	uint8_t* names[2] = {(uint8_t*)"fish", (uint8_t*)"verylargetextwithverylongname.txt"};
+	dentry_t dentry;
+	uint32_t length, kb, cycles;
+	uint64_t start;
+	int i, rep;
+
+	for (i = 0; i < 2; i++){
+		if (read_dentry_by_name(names[i], &dentry) == -1){
+			return FAIL;
+		}
+		length = (inode_ptr + dentry.inode)->length;
+		if (length > sizeof(read_bench_buf)){
+			length = sizeof(read_bench_buf);
+		}
+
+		start = rdtsc();
+		for (rep = 0; rep < READ_BENCH_REPS; rep++){
+			if (read_data(dentry.inode, 0, read_bench_buf, length) != length){
+				return FAIL;
+			}
+		}
+		cycles = (uint32_t)(rdtsc() - start);		// 32 bits is plenty for a few hundred KB of copying
+
+		kb = (length * READ_BENCH_REPS + 1023) / 1024;
+		printf("%s: %u bytes, %u cycles/KB\n", names[i], length, cycles / kb);
+	}
+	return PASS;
+}
+
+
+/* demand_paging_fish_test
+ * 
+ * Runs fish and compares the pages it touched with the size of its file
+ * Inputs: None
+ * Outputs: PASS/FAIL, page counts
+ * Side Effects: Runs fish on the current terminal until it exits
+ * Coverage: execute, load_program, user_page_fault
+ * Files: system_calls.h/c, handlers.h/c
+ */
+int demand_paging_fish_test(){
+	TEST_HEADER;
+
+	dentry_t dentry;
+	uint32_t file_pages;
+
+	if (read_dentry_by_name((uint8_t*)"fish", &dentry) == -1){
+		return FAIL;
+	}
+	file_pages = ((inode_ptr + dentry.inode)->length + FOUR_KB - 1) / FOUR_KB;
+
+	if (execute((uint8_t*)"fish") == -1){
+		return FAIL;
+	}
+	printf("fish: %u file pages, %u shared text pages, %u pages faulted in\n",
+		file_pages, last_halt_text_pages, last_halt_page_faults);
+
+	return (last_halt_page_faults != 0) ? PASS : FAIL;
+}
+
+/* wake_up_test
+ * 
+ * Queues the current task on a wait queue and wakes it through the scheduler
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Resets the current task's priority to normal
+ * Coverage: wake_up
+ * Files: scheduler.h/c
+ */
+int wake_up_test(){
+	TEST_HEADER;
+
+	uint32_t flags;
+	wait_queue_t wq, other_wq;
+	int result = PASS;
+
+	if (pcb_ptr == NULL){
+		return FAIL;
+	}
+
+	cli_and_save(flags);
+	wait_queue_init(&wq);
+	wait_queue_init(&other_wq);
+	pcb_ptr->priority = PRIO_LOW;
+	pcb_ptr->state = TASK_BLOCKED;
+	pcb_ptr->wait_queue = &wq;
+	pcb_ptr->queue_next = NULL;
+	wq.head = pcb_ptr;
+
+	wake_up(&other_wq);		// other queues must leave the task alone
+	if (pcb_ptr->state != TASK_BLOCKED || wq.head != pcb_ptr){
+		result = FAIL;
+	}
+
+	wake_up(&wq);
+	if (pcb_ptr->state != TASK_RUNNING || pcb_ptr->priority != PRIO_HIGH || wq.head != NULL){
+		result = FAIL;
+	}
+
+	pcb_ptr->state = TASK_RUNNING;
+	pcb_ptr->priority = PRIO_NORMAL;
+	restore_flags(flags);
+
+	return result;
+}
+
+/* rtc_idle_test
+ * 
+ * Blocks on the rtc for about a second and reports how much of it the cpu spent halted.
+ * Tickless, the halted cpu should see wakeups from the rtc but almost no ticks, and once the
+ * rtc file is closed a quarter second of sleep should not see the rtc wake it at all
+ * Inputs: None
+ * Outputs: PASS/FAIL, idle pit ticks, wakeups with and without an rtc file
+ * Side Effects: Opens and closes the rtc
+ * Coverage: sleep_on, wake_up, rtc_open, rtc_read, rtc_close, nanosleep, scheduler idle accounting
+ * Files: scheduler.h/c, rtc.h/c, timer.h/c
+ */
+int rtc_idle_test(){
+	TEST_HEADER;
+
+	int32_t freq = 16;
+	uint32_t ticks, idle_ticks, wakeups, closed_wakeups;
+	int32_t fd;
+	int i;
+
+	if (pcb_ptr == NULL){
+		return FAIL;
+	}
+
+	fd = open((uint8_t*)"rtc");
+	if (fd == -1){
+		return FAIL;
+	}
+	write(fd, &freq, 4);
+	read(fd, &freq, 4);		// line up with the first interrupt
+
+	ticks = sched_ticks;
+	idle_ticks = sched_idle_ticks;
+	wakeups = tick_wakeups;
+	for (i = 0; i < 16; i++){
+		read(fd, &freq, 4);
+	}
+	ticks = sched_ticks - ticks;
+	idle_ticks = sched_idle_ticks - idle_ticks;
+	wakeups = tick_wakeups - wakeups;
+	close(fd);
+
+	closed_wakeups = tick_wakeups;
+	if (nanosleep(0, NSEC_PER_SEC / 4) == -1){
+		return FAIL;
+	}
+	closed_wakeups = tick_wakeups - closed_wakeups;
+
+	printf("rtc_read x16 at 16 Hz: %u of %u pit ticks idle, %u wakeups, %u with the rtc closed\n", idle_ticks, ticks, wakeups, closed_wakeups);
+
+	if (tickless){
+		// the chip runs at MAX_RTC_FREQ while a file is open, it would have woken the cpu MAX_RTC_FREQ / 4 times
+		return (wakeups != 0 && ticks < FREQ / 10 && closed_wakeups < 16) ? PASS : FAIL;		// a periodic tick would have fired about FREQ times
+	}
+	return (ticks != 0 && idle_ticks * 2 > ticks) ? PASS : FAIL;
+}
+
+/* rtc_virtual_rate_test
+ * 
+ * Runs two rtc files at different rates and checks that each keeps its own
+ * Inputs: None
+ * Outputs: PASS/FAIL, ticks counted on the fast file
+ * Side Effects: Opens and closes two rtc files
+ * Coverage: rtc_handler, rtc_read, rtc_write
+ * Files: rtc.h/c
+ */
+int rtc_virtual_rate_test(){
+	TEST_HEADER;
+
+	int32_t fast_freq = 64;
+	int32_t slow_freq = 8;
+	int32_t fast_fd, slow_fd;
+	uint32_t fast_ticks;
+	int i;
+
+	if (pcb_ptr == NULL){
+		return FAIL;
+	}
+
+	fast_fd = open((uint8_t*)"rtc");
+	slow_fd = open((uint8_t*)"rtc");
+	if (fast_fd == -1 || slow_fd == -1){
+		return FAIL;
+	}
+	if (write(fast_fd, &fast_freq, 4) != 4 || write(slow_fd, &slow_freq, 4) != 4){
+		return FAIL;
+	}
+
+	// one second on the slow file, the fast file counts its ticks meanwhile
+	for (i = 0; i < slow_freq; i++){
+		read(slow_fd, &slow_freq, 4);
+	}
+	fast_ticks = pcb_ptr->fd_array[fast_fd].rtc_pending;
+	close(fast_fd);
+	close(slow_fd);
+
+	printf("64 Hz file counted %u ticks while the 8 Hz file counted 8\n", fast_ticks);
+
+	return (fast_ticks >= 63 && fast_ticks <= 65) ? PASS : FAIL;
+}
+
+/* frame_alloc_test
+ * 
+ * Allocates and frees frames and a kernel stack pair
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None, every frame is given back
+ * Coverage: frame_alloc, frame_alloc_pair, frame_free, frame_free_pair
+ * Files: frame.h/c
+ */
+int frame_alloc_test(){
+	TEST_HEADER;
+
+	uint32_t free_before = frames_free;
+	uint32_t frame, pair;
+	int result = PASS;
+
+	frame = frame_alloc();
+	pair = frame_alloc_pair();
+	if (frame < FRAME_LOW_LIMIT || (frame & (FRAME_SIZE - 1)) != 0){
+		result = FAIL;
+	}
+	if (pair < FRAME_LOW_LIMIT || (pair & (EIGHT_KB - 1)) != 0){
+		result = FAIL;
+	}
+	if (frames_free != free_before - 3){
+		result = FAIL;
+	}
+
+	*(uint32_t*)frame = 0x391;		// frames are reachable through the kernel's identity map
+	*(uint32_t*)(pair + EIGHT_KB - 4) = 0x391;
+
+	frame_free(frame);
+	frame_free_pair(pair);
+	if (frames_free != free_before || frame_alloc() != frame){		// first fit hands the same frame back
+		result = FAIL;
+	}
+	frame_free(frame);
+
+	return result;
+}
+
+/* video_flush_test
+ * 
+ * Prints one character and checks only its cell is copied to video memory
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Prints a character on the visible terminal
+ * Coverage: putc dirty tracking, video_flush
+ * Files: lib.h/c, terminal.h/c
+ */
+int video_flush_test(){
+	TEST_HEADER;
+
+	terminal_t* term = &terminal_arr[terminal_id];
+	uint32_t offset, cycles;
+	uint64_t start;
+	int result = PASS;
+
+	if (running_terminal != terminal_id){
+		return FAIL;
+	}
+	video_flush(terminal_id);
+	offset = ((term->top_line + term->cursor_ypos) * 80 + term->cursor_xpos) << 1;
+
+	start = rdtsc();
+	putc('#');
+	if (term->dirty_start != offset || term->dirty_end < offset + 2){		// a plain character dirties its own cell
+		result = FAIL;
+	}
+	video_flush(terminal_id);
+	cycles = (uint32_t)(rdtsc() - start);
+
+	if (term->dirty_start < term->dirty_end){
+		result = FAIL;
+	}
+	if (*(uint8_t*)(VIDEO + offset) != '#' || *(uint8_t*)(term->vmem_location + offset) != '#'){
+		result = FAIL;
+	}
+	printf("\nputc and flush took %u cycles\n", cycles);
+
+	return result;
+}
+
+/* hw_scroll_test
+ * 
+ * Scrolls the visible terminal through a buffer compaction
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Prints TERM_LINES blank lines on the visible terminal
+ * Coverage: putc scrolling, crtc start address, scrollback view
+ * Files: lib.h/c, terminal.h/c
+ */
+int hw_scroll_test(){
+	TEST_HEADER;
+
+	terminal_t* term = &terminal_arr[terminal_id];
+	uint32_t cycles, cell;
+	uint64_t start;
+	int i;
+	int result = PASS;
+
+	if (running_terminal != terminal_id){
+		return FAIL;
+	}
+
+	start = rdtsc();
+	for (i = 0; i < TERM_LINES; i++){
+		putc('\n');
+		video_flush(terminal_id);
+	}
+	cycles = (uint32_t)(rdtsc() - start);
+
+	if (term->top_line + 25 > TERM_LINES || term->top_line < SCROLLBACK_KEEP){		// compacted at least once
+		result = FAIL;
+	}
+
+	// the crtc has to show the top screen line
+	outb(0x0C, 0x3D4);
+	cell = inb(0x3D5) << 8;
+	outb(0x0D, 0x3D4);
+	cell |= inb(0x3D5);
+	if (cell != term->top_line * 80){
+		result = FAIL;
+	}
+
+	video_scroll_view(terminal_id, SCROLLBACK_STEP);
+	if (term->view_back != SCROLLBACK_STEP){
+		result = FAIL;
+	}
+	video_scroll_view(terminal_id, -TERM_LINES);
+	if (term->view_back != 0){
+		result = FAIL;
+	}
+
+	printf("%u cycles per scrolled line\n", cycles / TERM_LINES);
+
+	return result;
+}
+
+/* trace_test
+ * 
+ * Records events with tracing off and on and reads them back
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Leaves tracing off
+ * Coverage: TRACE, trace_record, trace_read
+ * Files: trace.h/c
+ */
+int trace_test(){
+	TEST_HEADER;
+
+	uint32_t head, off_cycles, on_cycles;
+	uint64_t start;
+	trace_event_t* event;
+	int result = PASS;
+
+	trace_enabled = 0;
+	head = trace_head;
+	start = rdtsc();
+	TRACE(TRACE_PAGE_FAULT, 0x391);
+	off_cycles = (uint32_t)(rdtsc() - start);
+	if (trace_head != head){		// a disabled tracepoint records nothing
+		result = FAIL;
+	}
+
+	trace_enabled = 1;
+	start = rdtsc();
+	TRACE(TRACE_PAGE_FAULT, 0x391);
+	on_cycles = (uint32_t)(rdtsc() - start);
+	trace_enabled = 0;
+
+	event = &trace_ring[head & (TRACE_SIZE - 1)];
+	if (trace_head != head + 1 || event->type != TRACE_PAGE_FAULT || event->arg != 0x391){
+		result = FAIL;
+	}
+	if (event->tsc_lo == 0 && event->tsc_hi == 0){
+		result = FAIL;
+	}
+
+	printf("tracepoint: %u cycles off, %u cycles on\n", off_cycles, on_cycles);
+
+	return result;
+}
+
+/* sysstat_test
+ * 
+ * Dispatches a failing close through the timed jump table
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Adds one call to the close row of the sysstat file
+ * Coverage: syscall_dispatch, histogram buckets
+ * Files: sysstat.h/c
+ */
+int sysstat_test(){
+	TEST_HEADER;
+
+	sysstat_row_t* row = &sysstat.rows[5];		// close
+	uint32_t calls = row->calls;
+	uint32_t bucketed = 0;
+	int i;
+
+	if (syscall_dispatch(5, 9, 0, 0) != -1){		// fd 9 does not exist
+		return FAIL;
+	}
+	for (i = 0; i < SYSSTAT_BUCKETS; i++){
+		bucketed += row->buckets[i];
+	}
+	return (row->calls == calls + 1 && bucketed == row->calls) ? PASS : FAIL;
+}
+
+#define MEM_BENCH_BYTES (256 * 1024)		// copied per variant and size
+#define MEM_BENCH_MAX (32 * 1024)
+
+static uint8_t mem_bench_src[MEM_BENCH_MAX];
+static uint8_t mem_bench_dst[MEM_BENCH_MAX + 16];
+
+/* memset variants with the memcpy signature, so one table can time both */
+static void* bench_memset_stosl(void* dest, const void* src, uint32_t n){
+	return memset_stosl(dest, 0x5A, n);
+}
+static void* bench_memset_erms(void* dest, const void* src, uint32_t n){
+	return memset_erms(dest, 0x5A, n);
+}
+
+/* mem_bandwidth_test
+ * 
+ * Times every memcpy and memset variant at a few sizes and checks what they wrote
+ * Inputs: None
+ * Outputs: PASS/FAIL, GB/s per variant and size
+ * Side Effects: Calibrates the tsc if boot has not
+ * Coverage: memcpy_movsl, memcpy_erms, memcpy_nt, memset_stosl, memset_erms
+ * Files: lib.h/c, scheduler.h/c
+ */
+int mem_bandwidth_test(){
+	TEST_HEADER;
+
+	static const uint32_t sizes[4] = {64, 512, 4096, MEM_BENCH_MAX};
+	struct {
+		int8_t* name;
+		void* (*fn)(void* dest, const void* src, uint32_t n);
+		uint32_t needs;
+		uint8_t is_set;
+	} variants[5] = {
+		{"memcpy_movsl", memcpy_movsl, 0, 0},
+		{"memcpy_erms", memcpy_erms, 0, 0},		// rep movsb runs everywhere, erms only makes it fast
+		{"memcpy_nt", memcpy_nt, MEM_SSE2, 0},
+		{"memset_stosl", bench_memset_stosl, 0, 1},
+		{"memset_erms", bench_memset_erms, 0, 1},
+	};
+	uint32_t mhz, v, i, j, rep, reps, cycles, us, mbps;
+	uint64_t start;
+
+	mhz = (tsc_khz ? tsc_khz : pit_calibrate_tsc()) / 1000;
+	if (mhz == 0){
+		return FAIL;
+	}
+	for (j = 0; j < MEM_BENCH_MAX; j++){
+		mem_bench_src[j] = j * 7;
+	}
+	printf("features %x, tsc %u MHz\n", mem_features, mhz);
+
+	for (v = 0; v < 5; v++){
+		if ((mem_features & variants[v].needs) != variants[v].needs){
+			printf("%s: not supported\n", variants[v].name);
+			continue;
+		}
+		for (i = 0; i < 4; i++){
+			reps = MEM_BENCH_BYTES / sizes[i];
+			memset_stosl(mem_bench_dst, 0, sizeof(mem_bench_dst));
+
+			start = rdtsc();
+			for (rep = 0; rep < reps; rep++){
+				variants[v].fn(mem_bench_dst, mem_bench_src, sizes[i]);
+			}
+			cycles = (uint32_t)(rdtsc() - start);
+
+			for (j = 0; j < sizes[i]; j++){
+				if (mem_bench_dst[j] != (variants[v].is_set ? 0x5A : mem_bench_src[j])){
+					return FAIL;
+				}
+			}
+			if (mem_bench_dst[sizes[i]] != 0){		// nothing past the end
+				return FAIL;
+			}
+
+			us = cycles / mhz;
+			mbps = MEM_BENCH_BYTES / (us ? us : 1);		// bytes per microsecond is MB/s
+			printf("%s %u bytes: %u.%u%u%u GB/s\n", variants[v].name, sizes[i],
+					mbps / 1000, (mbps / 100) % 10, (mbps / 10) % 10, mbps % 10);
+		}
+	}
+	return PASS;
+}
+
+/* string_word_test
+ * 
+ * Runs strlen, strncmp and an overlapping memmove at every alignment
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: word at a time strlen and strncmp, backward memmove
+ * Files: lib.h/c
+ */
+int string_word_test(){
+	TEST_HEADER;
+
+	int8_t a[40], b[40];
+	uint32_t off, len, j;
+
+	for (off = 0; off < 4; off++){
+		for (len = 0; len < 20; len++){
+			memset(a, 'x', sizeof(a));
+			memset(b, 'x', sizeof(b));
+			a[off + len] = '\0';
+			b[off + len] = '\0';
+			if (strlen(a + off) != len || strncmp(a + off, b + off, 32) != 0){
+				return FAIL;
+			}
+			if (len > 0){
+				b[off + len - 1] = 'y';
+				if (strncmp(a + off, b + off, 32) >= 0 || strncmp(a + off, b + off, len - 1) != 0){
+					return FAIL;
+				}
+			}
+			if (strncmp(a + off, b + ((off + 1) & 0x3), 0) != 0){
+				return FAIL;
+			}
+		}
+	}
+
+	for (off = 1; off < 8; off++){
+		for (j = 0; j < sizeof(a); j++){
+			a[j] = j;
+		}
+		memmove(a + off, a, 23);		// backwards through the overlap
+		for (j = 0; j < 23; j++){
+			if (a[off + j] != j){
+				return FAIL;
+			}
+		}
+		for (j = 0; j < sizeof(a); j++){
+			a[j] = j;
+		}
+		memmove(a, a + off, 23);		// forwards
+		for (j = 0; j < 23; j++){
+			if (a[j] != off + j){
+				return FAIL;
+			}
+		}
+	}
+	return PASS;
+}
+
+/* fpu_lazy_test
+ * 
+ * Leaves a different value on the x87 stack of two fake tasks and pops them back after switching
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Borrows pcb_ptr with interrupts off
+ * Coverage: fpu_switch, fpu_nm_handler, fpu_release
+ * Files: fpu.h/c, system_calls.h
+ */
+int fpu_lazy_test(){
+	TEST_HEADER;
+
+	static pcb_t task_a, task_b;
+	pcb_t* saved = pcb_ptr;
+	int32_t a = 391, b = 7, out_a = 0, out_b = 0;
+	uint32_t flags, traps;
+	int result;
+
+	cli_and_save(flags);
+	fpu_task_init(&task_a);
+	fpu_task_init(&task_b);
+	traps = fpu_traps;
+
+	pcb_ptr = &task_a;
+	fpu_switch(&task_a);
+	asm volatile ("fildl %0" : : "m"(a));		// traps, a gets the clean image
+	pcb_ptr = &task_b;
+	fpu_switch(&task_b);
+	asm volatile ("fildl %0" : : "m"(b));		// traps, a's registers go to its pcb
+	pcb_ptr = &task_a;
+	fpu_switch(&task_a);
+	asm volatile ("fistpl %0" : "=m"(out_a));	// traps, a's registers come back
+	pcb_ptr = &task_a;
+	fpu_switch(&task_a);						// still the owner, no trap
+	asm volatile ("fninit");
+	pcb_ptr = &task_b;
+	fpu_switch(&task_b);
+	asm volatile ("fistpl %0" : "=m"(out_b));	// traps
+
+	result = (out_a == a && out_b == b && fpu_traps == traps + 4) ? PASS : FAIL;
+
+	fpu_release(&task_a);
+	fpu_release(&task_b);
+	pcb_ptr = saved;
+	if (saved != NULL){
+		fpu_switch(saved);
+	}
+	restore_flags(flags);
+	return result;
+}
+
+/* fs_write_test
+ * 
+ * Creates a file, appends across a block boundary, overwrites the middle and truncates it again
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Leaves an empty "fstest.tmp" in the directory
+ * Coverage: file_create, write_data, truncate_data, free block accounting
+ * Files: filesystem.h/c
+ */
+int fs_write_test(){
+	TEST_HEADER;
+
+	static uint8_t data[FOUR_KB + 100];
+	static uint8_t check[FOUR_KB + 100];
+	dentry_t dentry;
+	uint32_t free_before, i;
+
+	if (file_create((uint8_t*)"fstest.tmp", &dentry) == -1 || truncate_data(dentry.inode, 0) == -1){
+		return FAIL;
+	}
+	free_before = fs_blocks_free;
+	for (i = 0; i < sizeof(data); i++){
+		data[i] = i * 13;
+	}
+
+	if (read_data(dentry.inode, 0, check, 1) != 0){		// empty file reads as end of file
+		return FAIL;
+	}
+	if (write_data(dentry.inode, 0, data, 100) != 100 ||
+			write_data(dentry.inode, 100, data + 100, FOUR_KB) != FOUR_KB ||		// appends into a second block
+			fs_blocks_free != free_before - 2){
+		return FAIL;
+	}
+	if (write_data(dentry.inode, 10, (uint8_t*)"hello", 5) != 5 || fs_blocks_free != free_before - 2){
+		return FAIL;
+	}
+	if (write_data(dentry.inode, sizeof(data) + 1, data, 1) != -1){		// no holes
+		return FAIL;
+	}
+	memcpy(data + 10, "hello", 5);
+	if (read_data(dentry.inode, 0, check, sizeof(check)) != sizeof(data)){
+		return FAIL;
+	}
+	for (i = 0; i < sizeof(data); i++){
+		if (check[i] != data[i]){
+			return FAIL;
+		}
+	}
+
+	if (truncate_data(dentry.inode, 50) != 0 || fs_blocks_free != free_before - 1 ||
+			read_data(dentry.inode, 0, check, sizeof(check)) != 50){
+		return FAIL;
+	}
+	if (truncate_data(dentry.inode, 0) != 0 || fs_blocks_free != free_before){
+		return FAIL;
+	}
+	return PASS;
+}
+
+#define FS_BENCH_BYTES (256 * 1024)
+#define FS_BENCH_CHUNK 1000		// not a block multiple, so chunks straddle blocks
+
+/* fs_write_benchmark
+ * 
+ * Writes 256 KB to a new file in odd sized chunks, reads it back and frees it
+ * Inputs: None
+ * Outputs: PASS/FAIL, MB/s for writing and reading
+ * Side Effects: Leaves an empty "fsbench.tmp" in the directory
+ * Coverage: write_data, read_data, block allocation and freeing
+ * Files: filesystem.h/c, scheduler.h/c
+ */
+int fs_write_benchmark(){
+	TEST_HEADER;
+
+	dentry_t dentry;
+	uint32_t i, done, chunk, write_cycles, read_cycles, mhz, free_before;
+	uint64_t start;
+
+	if (file_create((uint8_t*)"fsbench.tmp", &dentry) == -1 || truncate_data(dentry.inode, 0) == -1){
+		return FAIL;
+	}
+	free_before = fs_blocks_free;
+	if (free_before < FS_BENCH_BYTES / FOUR_KB){
+		printf("only %u free blocks\n", free_before);
+		return FAIL;
+	}
+	for (i = 0; i < sizeof(read_bench_buf); i++){
+		read_bench_buf[i] = i;
+	}
+
+	start = rdtsc();
+	for (done = 0; done < FS_BENCH_BYTES; done += chunk){
+		chunk = FS_BENCH_CHUNK;
+		if (chunk > FS_BENCH_BYTES - done){
+			chunk = FS_BENCH_BYTES - done;
+		}
+		if (write_data(dentry.inode, done, read_bench_buf + (done % FOUR_KB), chunk) != chunk){
+			return FAIL;
+		}
+	}
+	write_cycles = (uint32_t)(rdtsc() - start);
+
+	start = rdtsc();
+	for (done = 0; done < FS_BENCH_BYTES; done += chunk){
+		chunk = FS_BENCH_CHUNK;
+		if (chunk > FS_BENCH_BYTES - done){
+			chunk = FS_BENCH_BYTES - done;
+		}
+		if (read_data(dentry.inode, done, mem_bench_dst, chunk) != chunk){
+			return FAIL;
+		}
+		for (i = 0; i < chunk; i++){
+			if (mem_bench_dst[i] != read_bench_buf[(done % FOUR_KB) + i]){
+				return FAIL;
+			}
+		}
+	}
+	read_cycles = (uint32_t)(rdtsc() - start);
+
+	if (truncate_data(dentry.inode, 0) != 0 || fs_blocks_free != free_before){
+		return FAIL;
+	}
+
+	mhz = (tsc_khz ? tsc_khz : pit_calibrate_tsc()) / 1000;
+	if (mhz == 0){
+		return FAIL;
+	}
+	printf("write: %u MB/s, read and check: %u MB/s\n",
+			FS_BENCH_BYTES / (write_cycles / mhz + 1), FS_BENCH_BYTES / (read_cycles / mhz + 1));
+	return PASS;
+}
+
+/* text_map_test
+ * 
+ * Marks a file as the text of a running program, the way execute does for a zero-copy load, and checks
+ * that truncating, emptying through open and writing it all fail until the program is gone
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Leaves an empty "textmap.tmp" in the directory
+ * Coverage: text_map_get, text_map_put, truncate_data, write_data, open_flags with O_TRUNC
+ * Files: filesystem.h/c, system_calls.c
+ */
+int text_map_test(){
+	TEST_HEADER;
+
+	dentry_t dentry;
+	uint32_t length;
+	int32_t fd;
+	int result = PASS;
+
+	if (pcb_ptr == NULL){
+		return FAIL;
+	}
+	if (file_create((uint8_t*)"textmap.tmp", &dentry) == -1 || truncate_data(dentry.inode, 0) == -1 ||
+			write_data(dentry.inode, 0, (uint8_t*)"program text", 12) != 12){
+		return FAIL;
+	}
+	length = (inode_ptr + dentry.inode)->length;
+
+	text_map_get(dentry.inode);
+	if (truncate_data(dentry.inode, 0) != -1 || write_data(dentry.inode, 0, (uint8_t*)"x", 1) != -1){
+		result = FAIL;
+	}
+	fd = open_flags((uint8_t*)"textmap.tmp", O_TRUNC);
+	if (fd != -1){
+		close(fd);
+		result = FAIL;
+	}
+	if ((inode_ptr + dentry.inode)->length != length){
+		result = FAIL;
+	}
+	text_map_put(dentry.inode);
+
+	if (truncate_data(dentry.inode, 0) != 0 || (inode_ptr + dentry.inode)->length != 0){
+		result = FAIL;
+	}
+	return result;
+}
+
+/* pipe_test
+ * 
+ * Pushes data through a pipe so the ring wraps, then closes the write end and reads end of file
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Borrows pcb_ptr and the last pipe with interrupts off
+ * Coverage: pipe_read, pipe_write, pipe_close
+ * Files: pipe.h/c
+ */
+int pipe_test(){
+	TEST_HEADER;
+
+	static pcb_t task;
+	static uint8_t data[PIPE_SIZE];
+	static uint8_t check[PIPE_SIZE];
+	pipe_t* p = &pipe_table[MAX_PIPES - 1];
+	pcb_t* saved = pcb_ptr;
+	uint32_t flags, i;
+	int result = PASS;
+
+	cli_and_save(flags);
+	if (p->readers != 0 || p->writers != 0){		// in use by a program
+		restore_flags(flags);
+		return FAIL;
+	}
+	for (i = 0; i < PIPE_SIZE; i++){
+		data[i] = i * 7;
+	}
+	p->head = p->tail = 0;
+	p->readers = p->writers = 1;
+	wait_queue_init(&p->read_wait);
+	wait_queue_init(&p->write_wait);
+	task.fd_array[2].inode = MAX_PIPES - 1;
+	task.fd_array[2].fpos = PIPE_READ_END;
+	task.fd_array[3].inode = MAX_PIPES - 1;
+	task.fd_array[3].fpos = PIPE_WRITE_END;
+	pcb_ptr = &task;
+
+	// the stream is data over and over, so byte n of it is data[n % PIPE_SIZE]
+	if (pipe_write(3, data, 3000) != 3000 || pipe_read(2, check, 2000) != 2000){
+		result = FAIL;
+	}
+	for (i = 0; i < 2000; i++){
+		if (check[i] != data[i]){
+			result = FAIL;
+		}
+	}
+	if (pipe_write(3, data + 3000, PIPE_SIZE - 3000) != PIPE_SIZE - 3000 ||
+			pipe_write(3, data, 2000) != 2000 ||		// wraps around and fills the ring
+			pipe_read(2, check, PIPE_SIZE) != PIPE_SIZE){
+		result = FAIL;
+	}
+	for (i = 0; i < PIPE_SIZE; i++){
+		if (check[i] != data[(2000 + i) % PIPE_SIZE]){
+			result = FAIL;
+		}
+	}
+	pipe_close(3);
+	if (pipe_read(2, check, PIPE_SIZE) != 0){		// no writer left, end of file instead of sleeping
+		result = FAIL;
+	}
+	pipe_close(2);
+	if (p->readers != 0 || p->writers != 0){
+		result = FAIL;
+	}
+
+	pcb_ptr = saved;
+	restore_flags(flags);
+	return result;
+}
+
+/* terminal_input_test
+ * 
+ * Types two lines on a terminal nobody looks at, with a backspace, and reads them back in order
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Borrows pcb_ptr and the input ring of terminal 2 with interrupts off
+ * Coverage: terminal_input_put, terminal_input_erase, terminal_input_room, terminal_read
+ * Files: terminal.h/c
+ */
+int terminal_input_test(){
+	TEST_HEADER;
+
+	static pcb_t task;
+	terminal_t* term = &terminal_arr[2];
+	pcb_t* saved = pcb_ptr;
+	uint8_t buf[128];
+	uint32_t flags, i;
+	int result = PASS;
+
+	cli_and_save(flags);
+	if (term->input_head != term->input_tail || term->input_edit != term->input_head){		// typeahead of a real reader
+		restore_flags(flags);
+		return FAIL;
+	}
+	task.terminal = 2;
+	pcb_ptr = &task;
+
+	terminal_input_put(2, 'l');
+	terminal_input_put(2, 'x');
+	terminal_input_erase(2);
+	terminal_input_put(2, 's');
+	terminal_input_put(2, '\n');
+	terminal_input_put(2, 'h');
+	terminal_input_put(2, '\n');
+	if (terminal_input_erase(2) != 0){		// published lines can't be edited
+		result = FAIL;
+	}
+	for (i = 0; i < INPUT_LINE_MAX; i++){
+		terminal_input_put(2, 'a');
+	}
+	if (terminal_input_room(2) != 0 || terminal_input_put(2, 'a') != 0 || terminal_input_put(2, '\n') != 1){
+		result = FAIL;
+	}
+
+	// the lines are already there so terminal_read never sleeps
+	if (terminal_read(0, buf, sizeof(buf)) != 3 || buf[0] != 'l' || buf[1] != 's' || buf[2] != '\n'){
+		result = FAIL;
+	}
+	if (terminal_read(0, buf, 1) != 1 || buf[0] != 'h'){		// the rest of a line that does not fit is dropped
+		result = FAIL;
+	}
+	if (terminal_read(0, buf, sizeof(buf)) != INPUT_LINE_MAX + 1 || buf[INPUT_LINE_MAX] != '\n'){
+		result = FAIL;
+	}
+	if (term->input_head != term->input_tail){
+		result = FAIL;
+	}
+
+	pcb_ptr = saved;
+	restore_flags(flags);
+	return result;
+}
+
+/* softirq_test
+ * 
+ * Raises the video softirq twice and checks do_softirq runs its bottom half once
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Flushes the visible terminal, runs any other pending bottom half
+ * Coverage: softirq_raise, do_softirq
+ * Files: softirq.h/c
+ */
+int softirq_test(){
+	TEST_HEADER;
+
+	uint32_t flags, runs, raised;
+	int result = PASS;
+
+	cli_and_save(flags);
+	runs = softirq_stats[SOFTIRQ_VIDEO].runs;
+	raised = softirq_stats[SOFTIRQ_VIDEO].raised;
+	softirq_raise(SOFTIRQ_VIDEO);
+	softirq_raise(SOFTIRQ_VIDEO);
+	if (!(softirq_pending & (1 << SOFTIRQ_VIDEO)) || softirq_stats[SOFTIRQ_VIDEO].raised != raised + 2){
+		result = FAIL;
+	}
+	do_softirq();		// interrupts come on inside, ticks may raise it again meanwhile
+	if (softirq_active || softirq_stats[SOFTIRQ_VIDEO].runs < runs + 1){
+		result = FAIL;
+	}
+	restore_flags(flags);
+	return result;
+}
+
+static uint32_t timer_fired[3];
+static uint32_t timer_fired_count;
+
+/* timer_test_fn
+ * 
+ * Timer function of timer_test, records which timer fired
+ */
+static void timer_test_fn(timer_t* timer){
+	if (timer_fired_count < 3){
+		timer_fired[timer_fired_count] = (uint32_t)timer->data;
+	}
+	timer_fired_count++;
+}
+
+/* timer_test
+ * 
+ * Arms two expired timers and one far off timer out of order, then runs the timer softirq
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Runs any other pending bottom half
+ * Coverage: timer_add, timer_del, timer_next, timer softirq
+ * Files: timer.h/c
+ */
+int timer_test(){
+	TEST_HEADER;
+
+	timer_t timers[3];
+	uint32_t flags, i;
+	uint64_t now;
+	int result = PASS;
+
+	cli_and_save(flags);
+	now = rdtsc();
+	timer_fired_count = 0;
+	for (i = 0; i < 3; i++){
+		timer_setup(&timers[i], timer_test_fn, (void*)i);
+	}
+	timer_add(&timers[0], now + ns_to_cycles(60, 0));
+	timer_add(&timers[1], now - 1);
+	timer_add(&timers[2], now - 2);
+	if (timer_next() != now - 2){
+		result = FAIL;
+	}
+	softirq_raise(SOFTIRQ_TIMER);
+	do_softirq();
+	if (timer_fired_count != 2 || timer_fired[0] != 2 || timer_fired[1] != 1){
+		result = FAIL;
+	}
+	if (timers[1].index != TIMER_IDLE || timers[2].index != TIMER_IDLE || timers[0].index == TIMER_IDLE){
+		result = FAIL;
+	}
+	timer_del(&timers[0]);
+	if (timers[0].index != TIMER_IDLE){
+		result = FAIL;
+	}
+	restore_flags(flags);
+	return result;
+}
+
+/* tick_test
+ * 
+ * Checks the saturating division the apic one shot converts with, and that an armed one shot counts down
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: Rearms the tick a little early when tickless
+ * Coverage: udiv64_sat, apic_timer_oneshot, apic_timer_remaining
+ * Files: lib.h, apic.h/c
+ */
+int tick_test(){
+	TEST_HEADER;
+
+	uint32_t flags, first;
+	int result = PASS;
+
+	if (udiv64_sat(((uint64_t)3 << 32) + 8, 4) != 0xC0000002 || udiv64_sat((uint64_t)5 << 32, 5) != 0xFFFFFFFF){
+		result = FAIL;
+	}
+	if (tickless){
+		cli_and_save(flags);
+		apic_timer_oneshot(ns_to_cycles(0, NSEC_PER_SEC / FREQ));
+		first = apic_timer_remaining();
+		while (apic_timer_remaining() == first);
+		if (first == 0 || apic_timer_remaining() > first){
+			result = FAIL;
+		}
+		restore_flags(flags);
+	}
+	return result;
+}
+
+/* time_page_test
+ * 
+ * Reads the time page through its user address and checks the scale turns a second of cycles into
+ * a second of nanoseconds, and that the cmos date is past 2000
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: clock_init, time_page_assign, rtc_read_time
+ * Files: clock.h/c, paging.c, rtc.c
+ */
+int time_page_test(){
+	TEST_HEADER;
+
+	time_page_t* page = (time_page_t*)TIME_PAGE_ADDR;
+	uint32_t ns;
+
+	if (tsc_khz == 0){
+		return (page->cycles_per_sec == 0) ? PASS : FAIL;
+	}
+	if (!vidmem_pte[TIME_PAGE_INDEX].present || vidmem_pte[TIME_PAGE_INDEX].rw || !vidmem_pte[TIME_PAGE_INDEX].us){
+		return FAIL;
+	}
+	if (page->cycles_per_sec == 0 || page->base_sec < 946684800){		// 2000-01-01
+		return FAIL;
+	}
+	ns = (uint32_t)(((uint64_t)(page->cycles_per_sec - 1) * page->mult) >> page->shift);
+	return (ns > NSEC_PER_SEC - NSEC_PER_SEC / 1000 && ns < NSEC_PER_SEC) ? PASS : FAIL;
+}
+
+/* smp_test
+ * 
+ * Checks %gs reaches the boot cpu's cpu_t, that the cpus that came up have distinct apic ids, and
+ * that a nested kernel_enter leaves the kernel lock to the outer one
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: smp_boot_cpu, this_cpu, kernel_enter, kernel_exit
+ * Files: smp.h/c
+ */
+int smp_test(){
+	TEST_HEADER;
+
+	cpu_t* cpu = this_cpu();
+	uint32_t i, j;
+
+	if (cpu->self != cpu || cpu != &cpus[0] || cpu->tss != &tss){
+		return FAIL;
+	}
+	if (&pcb_ptr != &cpus[0].current || &running_terminal != &cpus[0].terminal){
+		return FAIL;
+	}
+	if (smp_cpus < 1 || smp_cpus > MAX_CPUS){
+		return FAIL;
+	}
+	for (i = 0; i < smp_cpus; i++){
+		if (!cpus[i].online || cpus[i].id != i){
+			return FAIL;
+		}
+		for (j = 0; j < i; j++){
+			if (cpus[j].apic_id == cpus[i].apic_id){
+				return FAIL;
+			}
+		}
+	}
+	if (!cpu->bkl_held || kernel_enter() != 0 || !cpu->bkl_held){
+		return FAIL;
+	}
+	kernel_exit(0);
+	return cpu->bkl_held ? PASS : FAIL;
+}
+
+/* run_queue_test
+ * 
+ * Walks every cpu's run queue and checks each queued task is ready, belongs to that cpu and is
+ * counted, and that a single cpu never stole anything
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: None
+ * Coverage: rq_push, rq_take, rq_steal
+ * Files: scheduler.h/c
+ */
+int run_queue_test(){
+	TEST_HEADER;
+
+	uint32_t flags, i, prio, count;
+	int32_t result = PASS;
+	pcb_t* task;
+
+	cli_and_save(flags);
+	for (i = 0; i < MAX_CPUS; i++){
+		count = 0;
+		for (prio = 0; prio < NUM_PRIORITIES; prio++){
+			if ((run_queues[i].head[prio] == NULL) != (run_queues[i].tail[prio] == NULL)){
+				result = FAIL;
+			}
+			for (task = run_queues[i].head[prio]; task != NULL; task = task->queue_next){
+				if (task->state != TASK_READY || task->cpu != i || task->priority != prio ||
+					(task->queue_next == NULL && task != run_queues[i].tail[prio])){
+					result = FAIL;
+				}
+				count++;
+			}
+		}
+		if (count != run_queues[i].ready || (i >= smp_cpus && count != 0)){
+			result = FAIL;
+		}
+		if (smp_cpus == 1 && run_queues[i].steals != 0){
+			result = FAIL;
+		}
+	}
+	restore_flags(flags);
+	return result;
+}
+
+/* lock_test
+ * 
+ * Takes a ticket spinlock and a mutex nobody else wants and checks the tickets, the ownership and
+ * the statistics the locks file shows
+ * Inputs: None
+ * Outputs: PASS/FAIL
+ * Side Effects: lists both locks in the locks file
+ * Coverage: spin_lock, spin_unlock, spin_lock_irqsave, mutex_lock, mutex_unlock
+ * Files: spinlock.h/c
+ */
+int lock_test(){
+	TEST_HEADER;
+
+	static spinlock_t lock = SPINLOCK_INIT("test    ");
+	static mutex_t mutex = MUTEX_INIT("test mtx");
+	uint32_t flags;
+
+	spin_lock_irqsave(&lock, flags);
+	if (lock.next != 1 || lock.serving != 0){
+		spin_unlock_irqrestore(&lock, flags);
+		return FAIL;
+	}
+	spin_unlock_irqrestore(&lock, flags);
+	spin_lock(&lock);
+	spin_unlock(&lock);
+	if (lock.next != 2 || lock.serving != 2 || lock.stat.acquired != 2 || lock.stat.contended != 0 ||
+		!lock.stat.listed || lock.stat.hold_max == 0){
+		return FAIL;
+	}
+
+	mutex_lock(&mutex);
+	if (!mutex.locked || mutex.owner != pcb_ptr){
+		mutex_unlock(&mutex);
+		return FAIL;
+	}
+	mutex_unlock(&mutex);
+	if (mutex.locked || mutex.owner != NULL || mutex.waiters.head != NULL || mutex.stat.acquired != 1 ||
+		mutex.stat.contended != 0){
+		return FAIL;
+	}
+	return PASS;
+}
 
 /* Test suite entry point */
 void launch_tests(){
@@ -776,5 +2002,32 @@ void launch_tests(){
 
     // TEST_OUTPUT("System Call Test (RTC)", rtc_freq_test_generic_sys_call());
 
+	// Performance Tests
+	TEST_OUTPUT("read_data_benchmark", read_data_benchmark());
+	TEST_OUTPUT("demand_paging_fish_test", demand_paging_fish_test());
+	TEST_OUTPUT("wake_up_test", wake_up_test());
+	TEST_OUTPUT("rtc_idle_test", rtc_idle_test());
+	TEST_OUTPUT("rtc_virtual_rate_test", rtc_virtual_rate_test());
+	TEST_OUTPUT("frame_alloc_test", frame_alloc_test());
+	TEST_OUTPUT("video_flush_test", video_flush_test());
+	TEST_OUTPUT("hw_scroll_test", hw_scroll_test());
+	TEST_OUTPUT("trace_test", trace_test());
+	TEST_OUTPUT("sysstat_test", sysstat_test());
+	TEST_OUTPUT("mem_bandwidth_test", mem_bandwidth_test());
+	TEST_OUTPUT("string_word_test", string_word_test());
+	TEST_OUTPUT("fpu_lazy_test", fpu_lazy_test());
+	TEST_OUTPUT("fs_write_test", fs_write_test());
+	TEST_OUTPUT("fs_write_benchmark", fs_write_benchmark());
+	TEST_OUTPUT("text_map_test", text_map_test());
+	TEST_OUTPUT("pipe_test", pipe_test());
+	TEST_OUTPUT("terminal_input_test", terminal_input_test());
+	TEST_OUTPUT("softirq_test", softirq_test());
+	TEST_OUTPUT("timer_test", timer_test());
+	TEST_OUTPUT("tick_test", tick_test());
+	TEST_OUTPUT("time_page_test", time_page_test());
+	TEST_OUTPUT("smp_test", smp_test());
+	TEST_OUTPUT("run_queue_test", run_queue_test());
+	TEST_OUTPUT("lock_test", lock_test());
+
 	
 }
@@ -0,0 +1,240 @@
+#include "timer.h"
+#include "lib.h"
+#include "scheduler.h"
+#include "softirq.h"
+#include "system_calls.h"
+
+// armed timers as a binary min-heap on the deadline, so the next one to fire is always timer_heap[0]
+static timer_t* timer_heap[TIMER_MAX];
+static uint32_t timer_count = 0;
+
+/* heap_swap
+* INPUTS: a, b - heap slots
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: exchanges two timers and keeps their index fields right
+*/
+static void heap_swap(uint32_t a, uint32_t b){
+    timer_t* tmp = timer_heap[a];
+
+    timer_heap[a] = timer_heap[b];
+    timer_heap[b] = tmp;
+    timer_heap[a]->index = a;
+    timer_heap[b]->index = b;
+}
+
+/* heap_up
+* INPUTS: i - heap slot
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: moves the timer at i toward the root while it fires before its parent
+*/
+static void heap_up(uint32_t i){
+    while (i > 0 && timer_heap[i]->deadline < timer_heap[(i - 1) / 2]->deadline){
+        heap_swap(i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+/* heap_down
+* INPUTS: i - heap slot
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: moves the timer at i toward the leaves while a child fires before it
+*/
+static void heap_down(uint32_t i){
+    uint32_t child;
+
+    while ((child = 2 * i + 1) < timer_count){
+        if (child + 1 < timer_count && timer_heap[child + 1]->deadline < timer_heap[child]->deadline){
+            child++;
+        }
+        if (timer_heap[i]->deadline <= timer_heap[child]->deadline){
+            break;
+        }
+        heap_swap(i, child);
+        i = child;
+    }
+}
+
+/* heap_remove
+* INPUTS: i - heap slot
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: takes the timer at i out of the heap and marks it idle, interrupts must be off
+*/
+static void heap_remove(uint32_t i){
+    timer_t* timer = timer_heap[i];
+
+    timer_count--;
+    if (i != timer_count){
+        timer_heap[i] = timer_heap[timer_count];
+        timer_heap[i]->index = i;
+        heap_up(i);
+        heap_down(timer_heap[i]->index);
+    }
+    timer->index = TIMER_IDLE;
+}
+
+/* timer_softirq
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: bottom half, runs every timer whose deadline has passed. Each one is out of the heap
+*              before its function runs, so the function may arm it again
+*/
+static void timer_softirq(void){
+    timer_t* timer;
+    uint32_t flags;
+
+    cli_and_save(flags);
+    while (timer_count > 0 && timer_heap[0]->deadline <= rdtsc()){
+        timer = timer_heap[0];
+        heap_remove(0);
+        restore_flags(flags);
+        timer->fn(timer);
+        cli_and_save(flags);
+    }
+    restore_flags(flags);
+}
+
+/* timer_init
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: hooks the timers to their softirq, deadlines need pit_calibrate_tsc to have run
+*/
+void timer_init(void){
+    timer_count = 0;
+    softirq_register(SOFTIRQ_TIMER, timer_softirq);
+}
+
+/* timer_setup
+* INPUTS: timer, fn, data
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: prepares a timer that is not armed yet
+*/
+void timer_setup(timer_t* timer, timer_fn_t fn, void* data){
+    timer->fn = fn;
+    timer->data = data;
+    timer->index = TIMER_IDLE;
+}
+
+/* timer_add
+* INPUTS: timer, deadline - tsc value
+* OUTPUTS: none
+* RETURN: 0 on success, -1 if TIMER_MAX timers are already armed
+* DESCRIPTION: arms the timer, or moves its deadline if it is armed already
+*/
+int32_t timer_add(timer_t* timer, uint64_t deadline){
+    uint32_t flags;
+
+    cli_and_save(flags);
+    if (timer->index != TIMER_IDLE){
+        heap_remove(timer->index);
+    }
+    if (timer_count == TIMER_MAX){
+        restore_flags(flags);
+        return -1;
+    }
+    timer->deadline = deadline;
+    timer->index = timer_count;
+    timer_heap[timer_count++] = timer;
+    heap_up(timer->index);
+    restore_flags(flags);
+    return 0;
+}
+
+/* timer_del
+* INPUTS: timer
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: disarms the timer if it has not fired yet
+*/
+void timer_del(timer_t* timer){
+    uint32_t flags;
+
+    cli_and_save(flags);
+    if (timer->index != TIMER_IDLE){
+        heap_remove(timer->index);
+    }
+    restore_flags(flags);
+}
+
+/* timer_next
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: deadline of the next timer to fire, all ones if none is armed
+* DESCRIPTION: interrupts must be off for the answer to stay true
+*/
+uint64_t timer_next(void){
+    return (timer_count > 0) ? timer_heap[0]->deadline : ~(uint64_t)0;
+}
+
+/* timer_tick
+* INPUTS: none
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: called by the pit top half, raises the timer softirq once a deadline has passed
+*/
+void timer_tick(void){
+    if (timer_count > 0 && timer_heap[0]->deadline <= rdtsc()){
+        softirq_raise(SOFTIRQ_TIMER);
+    }
+}
+
+/* ns_to_cycles
+* INPUTS: sec, nsec
+* OUTPUTS: none
+* RETURN: the time in tsc cycles
+* DESCRIPTION: split into milliseconds, microseconds and nanoseconds so nothing needs a 64 bit division
+*/
+uint64_t ns_to_cycles(uint32_t sec, uint32_t nsec){
+    uint32_t mhz = tsc_khz / 1000;
+
+    return (uint64_t)sec * tsc_khz * 1000 +
+           (uint64_t)(nsec / NSEC_PER_MSEC) * tsc_khz +
+           (nsec % NSEC_PER_MSEC / NSEC_PER_USEC) * mhz +
+           (nsec % NSEC_PER_USEC) * mhz / 1000;
+}
+
+/* timer_wake
+* INPUTS: timer
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: timer function of nanosleep, wakes the queue in data
+*/
+static void timer_wake(timer_t* timer){
+    wake_up((wait_queue_t*)timer->data);
+}
+
+/* nanosleep
+* INPUTS: sec, nsec - time to sleep, nsec below a second
+* OUTPUTS: none
+* RETURN: 0 once the time has passed, -1 for a bad time or when no timer is free
+* DESCRIPTION: system call, parks the caller off the run queue until its deadline. The timer and the
+*              queue live on the caller's kernel stack, which stays put while it sleeps
+*/
+int32_t nanosleep(uint32_t sec, uint32_t nsec){
+    timer_t timer;
+    wait_queue_t wq;
+    uint32_t flags;
+
+    if (nsec >= NSEC_PER_SEC || pcb_ptr == NULL || tsc_khz == 0){
+        return -1;
+    }
+    wait_queue_init(&wq);
+    timer_setup(&timer, timer_wake, &wq);
+
+    cli_and_save(flags);
+    if (timer_add(&timer, rdtsc() + ns_to_cycles(sec, nsec)) == -1){
+        restore_flags(flags);
+        return -1;
+    }
+    while (timer.index != TIMER_IDLE){
+        sleep_on(&wq);
+    }
+    restore_flags(flags);
+    return 0;
+}
@@ -0,0 +1,33 @@
+#if !defined(TIMER_H)
+#define TIMER_H
+
+#include "types.h"
+
+#define TIMER_MAX 64                // timers armed at once, a sleeping task holds one
+#define TIMER_IDLE 0xFFFFFFFF       // heap index of a timer that is not armed
+#define NSEC_PER_SEC 1000000000
+#define NSEC_PER_MSEC 1000000
+#define NSEC_PER_USEC 1000
+
+struct timer_struct;
+typedef void (*timer_fn_t)(struct timer_struct* timer);
+
+typedef struct timer_struct
+{
+    uint64_t deadline;      // tsc value it fires at
+    timer_fn_t fn;          // run by the timer softirq, with interrupts on
+    void* data;
+    uint32_t index;         // slot in the heap, TIMER_IDLE when not armed
+} timer_t;
+
+void timer_init(void);
+void timer_setup(timer_t* timer, timer_fn_t fn, void* data);
+int32_t timer_add(timer_t* timer, uint64_t deadline);
+void timer_del(timer_t* timer);
+uint64_t timer_next(void);
+void timer_tick(void);
+uint64_t ns_to_cycles(uint32_t sec, uint32_t nsec);
+
+int32_t nanosleep(uint32_t sec, uint32_t nsec);
+
+#endif
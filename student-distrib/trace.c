@@ -0,0 +1,150 @@
+#include "trace.h"
+#include "lib.h"
+#include "system_calls.h"
+
+volatile uint32_t trace_enabled = 0;
+volatile uint32_t trace_head = 0;       // events ever recorded, the next one goes to trace_head % TRACE_SIZE
+trace_event_t trace_ring[TRACE_SIZE];
+
+static uint32_t trace_resume = 0;       // trace_enabled once the reader closes the file
+
+// names padded to 8 characters for the fixed length lines of the trace file
+static const int8_t* trace_names[TRACE_NUM_TYPES] = {
+    "unknown ", "irq_in  ", "irq_out ", "sys_in  ", "sys_out ", "switch  ", "execute ", "halt    ", "pagefalt"
+};
+
+/* trace_record
+* INPUTS: type, arg
+* OUTPUTS: none
+* RETURN: none
+* DESCRIPTION: stores an event with the time stamp counter and the running pid. The slot is claimed
+*              with one locked add, so writers never wait for each other and the oldest event is
+*              overwritten when the ring is full
+*/
+void trace_record(uint32_t type, uint32_t arg){
+    uint64_t tsc = rdtsc();
+    uint32_t slot = 1;
+    trace_event_t* event;
+
+    asm volatile ("lock xaddl %0, %1"
+            : "+r"(slot), "+m"(trace_head)
+            :
+            : "memory", "cc"
+    );
+    event = &trace_ring[slot & (TRACE_SIZE - 1)];
+    event->tsc_lo = (uint32_t)tsc;
+    event->tsc_hi = (uint32_t)(tsc >> 32);
+    event->type = type;
+    event->pid = (pcb_ptr != NULL) ? pcb_ptr->pid : TRACE_NO_PID;
+    event->arg = arg;
+}
+
+/* put_hex
+* INPUTS: dst, val, digits
+* OUTPUTS: the low digits of val in hex at dst
+* RETURN: none
+* DESCRIPTION: zero padded, helper for trace_read
+*/
+static void put_hex(uint8_t* dst, uint32_t val, uint32_t digits){
+    static const int8_t hex[] = "0123456789abcdef";
+    while (digits > 0){
+        digits--;
+        dst[digits] = hex[val & 0xF];
+        val >>= 4;
+    }
+}
+
+/* trace_open
+* INPUTS: filename
+* OUTPUTS: none
+* RETURN: 0
+* DESCRIPTION: stops tracing while the file is open so the ring holds still and the reader
+*              does not trace itself
+*/
+int32_t trace_open(const uint8_t* filename){
+    trace_resume = trace_enabled;
+    trace_enabled = 0;
+    return 0;
+}
+
+/* trace_close
+* INPUTS: fd
+* OUTPUTS: none
+* RETURN: 0
+* DESCRIPTION: turns tracing back on if it was on, or if the reader asked for it
+*/
+int32_t trace_close(int32_t fd){
+    trace_enabled = trace_resume;
+    return 0;
+}
+
+/* trace_read
+* INPUTS: fd, buf, nbytes
+* OUTPUTS: events as text, one TRACE_LINE_LEN line each: tsc pid type arg, all hex
+* RETURN: bytes copied, 0 once every event has been read
+* DESCRIPTION: reads the ring from the oldest event kept to the newest
+*/
+int32_t trace_read(int32_t fd, void* buf, int32_t nbytes){
+    uint8_t line[TRACE_LINE_LEN];
+    uint8_t* out = (uint8_t*)buf;
+    uint32_t head = trace_head;
+    uint32_t oldest = (head > TRACE_SIZE) ? head - TRACE_SIZE : 0;
+    uint32_t pos = pcb_ptr->fd_array[fd].fpos;
+    uint32_t total = (head - oldest) * TRACE_LINE_LEN;
+    uint32_t copied = 0;
+    uint32_t offset, len;
+    trace_event_t* event;
+
+    if (buf == NULL || nbytes < 0){
+        return -1;
+    }
+    while (copied < nbytes && pos < total){
+        event = &trace_ring[(oldest + pos / TRACE_LINE_LEN) & (TRACE_SIZE - 1)];
+        put_hex(line, event->tsc_hi, 8);
+        put_hex(line + 8, event->tsc_lo, 8);
+        line[16] = ' ';
+        put_hex(line + 17, event->pid, 4);
+        line[21] = ' ';
+        memcpy(line + 22, (void*)trace_names[(event->type < TRACE_NUM_TYPES) ? event->type : 0], 8);
+        line[30] = ' ';
+        put_hex(line + 31, event->arg, 8);
+        line[39] = '\n';
+
+        offset = pos % TRACE_LINE_LEN;
+        len = TRACE_LINE_LEN - offset;
+        if (len > nbytes - copied){
+            len = nbytes - copied;
+        }
+        memcpy(out + copied, line + offset, len);
+        copied += len;
+        pos += len;
+    }
+    pcb_ptr->fd_array[fd].fpos = pos;
+    return copied;
+}
+
+/* trace_write
+* INPUTS: fd, buf, nbytes
+* OUTPUTS: none
+* RETURN: nbytes, -1 for an unknown command
+* DESCRIPTION: '1' turns tracing on and '0' off once the file is closed, 'c' empties the ring
+*/
+int32_t trace_write(int32_t fd, const void* buf, int32_t nbytes){
+    if (buf == NULL || nbytes < 1){
+        return -1;
+    }
+    switch (*(uint8_t*)buf){
+        case '1':
+            trace_resume = 1;
+            break;
+        case '0':
+            trace_resume = 0;
+            break;
+        case 'c':
+            trace_head = 0;
+            break;
+        default:
+            return -1;
+    }
+    return nbytes;
+}
@@ -0,0 +1,65 @@
+#if !defined(TRACE_H)
+#define TRACE_H
+
+// event types
+#define TRACE_IRQ_ENTER 1
+#define TRACE_IRQ_EXIT 2
+#define TRACE_SYSCALL_ENTER 3       // arg is the system call number
+#define TRACE_SYSCALL_EXIT 4        // arg is the return value
+#define TRACE_SWITCH 5              // arg is the pid switched to
+#define TRACE_EXECUTE 6             // arg is the new pid
+#define TRACE_HALT 7                // arg is the status
+#define TRACE_PAGE_FAULT 8          // arg is the faulting address
+#define TRACE_NUM_TYPES 9
+
+#define TRACE_SIZE 4096             // events kept, a power of two
+#define TRACE_LINE_LEN 40           // bytes per event when the trace file is read
+#define TRACE_NO_PID 0xFFFF         // event outside any process
+
+#ifndef ASM
+
+#include "types.h"
+
+typedef struct __attribute__((packed)) trace_event_struct
+{
+    uint32_t tsc_lo;
+    uint32_t tsc_hi;
+    uint16_t type;
+    uint16_t pid;
+    uint32_t arg;
+} trace_event_t;
+
+extern volatile uint32_t trace_enabled;
+extern volatile uint32_t trace_head;
+extern trace_event_t trace_ring[TRACE_SIZE];
+
+void trace_record(uint32_t type, uint32_t arg);
+
+int32_t trace_open(const uint8_t* filename);
+int32_t trace_close(int32_t fd);
+int32_t trace_read(int32_t fd, void* buf, int32_t nbytes);
+int32_t trace_write(int32_t fd, const void* buf, int32_t nbytes);
+
+// a disabled tracepoint is one load and a branch
+#define TRACE(type, arg)                        \
+do {                                            \
+    if (__builtin_expect(trace_enabled, 0)) {   \
+        trace_record((type), (uint32_t)(arg));  \
+    }                                           \
+} while (0)
+
+#else
+
+// same check for the assembly linkages, every register but eax, ecx and edx survives
+#define TRACE_ASM(type, arg)    \
+    cmpl    $0, trace_enabled   ;\
+    je      1f                  ;\
+    pushl   arg                 ;\
+    pushl   $type               ;\
+    call    trace_record        ;\
+    addl    $8, %esp            ;\
+1:
+
+#endif /* ASM */
+
+#endif
@@ -16,6 +16,10 @@
 #define USER_DS     0x002B
 #define KERNEL_TSS  0x0030
 #define KERNEL_LDT  0x0038
+#define KERNEL_PERCPU 0x0040      /* %gs, based at the running cpu's cpu_t */
+
+/* Number of descriptors in the GDT, the unusable first one included */
+#define GDT_ENTRIES 9
 
 /* Size of the task state segment (TSS) */
 #define TSS_SIZE    104
@@ -119,6 +123,7 @@ extern uint16_t ldt_desc;
 extern uint32_t ldt_size;
 extern seg_desc_t ldt_desc_ptr;
 extern seg_desc_t gdt_ptr;
+extern seg_desc_t gdt[GDT_ENTRIES];
 extern uint32_t ldt;
 
 extern uint32_t tss_size;
@@ -0,0 +1,55 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define BUFSIZE 32
+#define CALLS 1000
+
+static uint32_t rdtsc_low ()
+{
+    uint32_t lo, hi;
+    asm volatile ("rdtsc" : "=a"(lo), "=d"(hi));
+    return lo;
+}
+
+static void print_time (const uint8_t* name, const ece391_timespec_t* ts)
+{
+    uint8_t buf[BUFSIZE];
+    uint32_t len, i;
+
+    ece391_fdputs (1, name);
+    ece391_itoa (ts->tv_sec, buf, 10);
+    ece391_fdputs (1, buf);
+    ece391_fdputs (1, (uint8_t*)".");
+    ece391_itoa (ts->tv_nsec, buf, 10);
+    for (len = ece391_strlen (buf), i = len; i < 9; i++)
+        ece391_fdputs (1, (uint8_t*)"0");
+    ece391_fdputs (1, buf);
+    ece391_fdputs (1, (uint8_t*)"\n");
+}
+
+int main ()
+{
+    ece391_timespec_t ts;
+    uint8_t buf[BUFSIZE];
+    uint32_t i, start;
+
+    if (0 != ece391_clock_gettime (ECE391_CLOCK_REALTIME, &ts)) {
+        ece391_fdputs (1, (uint8_t*)"no clock\n");
+        return 2;
+    }
+    print_time ((uint8_t*)"realtime:  ", &ts);
+    ece391_clock_gettime (ECE391_CLOCK_MONOTONIC, &ts);
+    print_time ((uint8_t*)"monotonic: ", &ts);
+
+    start = rdtsc_low ();
+    for (i = 0; i < CALLS; i++) {
+        ece391_clock_gettime (ECE391_CLOCK_MONOTONIC, &ts);
+    }
+    ece391_itoa ((rdtsc_low () - start) / CALLS, buf, 10);
+    ece391_fdputs (1, buf);
+    ece391_fdputs (1, (uint8_t*)" cycles per clock_gettime\n");
+
+    return 0;
+}
@@ -0,0 +1,46 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define BUFSIZE 32
+#define ROUNDS 20000000
+
+/*
+ * Adds the seed up on the x87 stack and keeps it in xmm1 for long enough to
+ * be preempted many times. Run it on two terminals at once with different
+ * seeds: if the kernel mixed up their fpu registers, the sums come out wrong.
+ */
+int main ()
+{
+    uint8_t buf[BUFSIZE];
+    uint32_t seed = 0, i, xmm_out;
+    volatile double sum = 0.0;
+    double step;
+
+    if (ece391_getargs (buf, BUFSIZE) == 0) {
+        for (i = 0; buf[i] >= '0' && buf[i] <= '9'; i++) {
+            seed = seed * 10 + (buf[i] - '0');
+        }
+    }
+    if (seed == 0) {
+        seed = 3;
+    }
+
+    asm volatile ("movd %0, %%xmm1" : : "r"(seed));
+    step = seed;
+    for (i = 0; i < ROUNDS; i++) {
+        sum += step;
+    }
+    asm volatile ("movd %%xmm1, %0" : "=r"(xmm_out));
+
+    if (sum != (double)seed * ROUNDS || xmm_out != seed) {
+        ece391_fdputs (1, (uint8_t*)"fpu state corrupted\n");
+        return 1;
+    }
+    ece391_fdputs (1, (uint8_t*)"fpu state ok, seed ");
+    ece391_itoa (seed, buf, 10);
+    ece391_fdputs (1, buf);
+    ece391_fdputs (1, (uint8_t*)"\n");
+    return 0;
+}
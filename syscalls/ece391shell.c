@@ -4,6 +4,85 @@
 #include "ece391syscall.h"
 
 #define BUFSIZE 1024
+#define MAX_STAGES 6
+
+/* does the command line have a '|' in it */
+static int32_t is_pipeline (const uint8_t* s)
+{
+    for (; '\0' != *s; s++)
+        if ('|' == *s)
+            return 1;
+    return 0;
+}
+
+/* drop the spaces around a pipeline stage */
+static uint8_t* trim (uint8_t* s)
+{
+    uint32_t len;
+
+    while (' ' == *s)
+        s++;
+    for (len = ece391_strlen (s); len > 0 && ' ' == s[len - 1]; len--)
+        s[len - 1] = '\0';
+    return s;
+}
+
+/*
+ * Run "a | b | c". Every stage is spawned at once with its stdin on the
+ * pipe from the stage before it. The last one writes into a pipe too, and
+ * the shell copies that to the screen until the pipe reads empty, which is
+ * when the last stage has halted. An earlier stage that is still running
+ * then finishes on its own, its writes fail once nobody reads them.
+ */
+static int32_t run_pipeline (uint8_t* buf)
+{
+    uint8_t* stages[MAX_STAGES];
+    int32_t fds[2];
+    int32_t in = -1, cnt, i, n = 1;
+    uint8_t* p;
+
+    stages[0] = buf;
+    for (p = buf; '\0' != *p; p++) {
+        if ('|' != *p)
+            continue;
+        if (MAX_STAGES == n) {
+            ece391_fdputs (1, (uint8_t*)"pipeline too long\n");
+            return -1;
+        }
+        *p = '\0';
+        stages[n++] = p + 1;
+    }
+
+    for (i = 0; i < n; i++) {
+        stages[i] = trim (stages[i]);
+        if ('\0' == stages[i][0] || -1 == ece391_pipe (fds)) {
+            ece391_fdputs (1, (uint8_t*)"bad pipeline\n");
+            break;
+        }
+        if (-1 == ece391_spawn (stages[i], in, fds[1])) {
+            ece391_fdputs (1, (uint8_t*)"no such command\n");
+            ece391_close (fds[0]);
+            ece391_close (fds[1]);
+            break;
+        }
+        ece391_close (fds[1]);
+        if (-1 != in)
+            ece391_close (in);
+        in = fds[0];
+    }
+    if (i < n) {
+        /* the stages already running see their reader go away and halt */
+        if (-1 != in)
+            ece391_close (in);
+        return -1;
+    }
+
+    /* the arguments are in the children now, buf is free again */
+    while (0 < (cnt = ece391_read (in, buf, BUFSIZE)))
+        ece391_write (1, buf, cnt);
+    ece391_close (in);
+    return 0;
+}
 
 int main ()
 {
@@ -24,6 +103,10 @@ int main ()
 	    return 0;
 	if ('\0' == buf[0])
 	    continue;
+	if (is_pipeline (buf)) {
+	    run_pipeline (buf);
+	    continue;
+	}
 	rval = ece391_execute (buf);
 	if (-1 == rval)
 	    ece391_fdputs (1, (uint8_t*)"no such command\n");
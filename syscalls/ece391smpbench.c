@@ -0,0 +1,152 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define BUFSIZE 256
+#define MAX_WORKERS 8
+#define WORK_BLOCKS 20000        /* of 1000 iterations each, per worker */
+#define TICK_LINE_LEN 20         /* same as the kernel's ticks file */
+
+/* the cpu bound part, a worker spins through WORK_BLOCKS blocks and writes one byte */
+static int32_t worker ()
+{
+    uint32_t i, j, x = 1;
+    uint8_t c;
+
+    for (i = 0; i < WORK_BLOCKS; i++) {
+        for (j = 0; j < 1000; j++) {
+            x = x * 1103515245 + 12345;
+        }
+    }
+    c = (uint8_t)x;
+    ece391_write (1, &c, 1);
+    return 0;
+}
+
+/* value of the line of the ticks file that starts with name, 0 if it is missing */
+static uint32_t ticks_value (const uint8_t* name)
+{
+    uint8_t buf[BUFSIZE];
+    int32_t fd, cnt, pos;
+    uint32_t value = 0;
+    uint8_t* p;
+
+    if (-1 == (fd = ece391_open ((uint8_t*)"ticks"))) {
+        return 0;
+    }
+    cnt = ece391_read (fd, buf, BUFSIZE);
+    ece391_close (fd);
+    for (pos = 0; pos + TICK_LINE_LEN <= cnt; pos += TICK_LINE_LEN) {
+        if (0 != ece391_strncmp (buf + pos, name, ece391_strlen (name))) {
+            continue;
+        }
+        for (p = buf + pos + 8; ' ' == *p; p++);
+        for (; *p >= '0' && *p <= '9'; p++) {
+            value = value * 10 + (*p - '0');
+        }
+    }
+    return value;
+}
+
+/* milliseconds on the monotonic clock */
+static uint32_t now_ms ()
+{
+    ece391_timespec_t ts;
+
+    ece391_clock_gettime (ECE391_CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* runs n workers at once, returns the milliseconds until the last one halted */
+static int32_t run (uint32_t n)
+{
+    int32_t fds[2];
+    uint8_t buf[MAX_WORKERS];
+    uint32_t i, start, done = 0;
+    int32_t cnt;
+
+    if (-1 == ece391_pipe (fds)) {
+        return -1;
+    }
+    start = now_ms ();
+    for (i = 0; i < n; i++) {
+        if (-1 == ece391_spawn ((uint8_t*)"smpbench -w", -1, fds[1])) {
+            break;
+        }
+    }
+    ece391_close (fds[1]);
+    /* the pipe reads empty once every worker has halted */
+    while (0 < (cnt = ece391_read (fds[0], buf, MAX_WORKERS))) {
+        done += cnt;
+    }
+    ece391_close (fds[0]);
+    return (done == n) ? (int32_t)(now_ms () - start) : -1;
+}
+
+static void put (uint32_t value, const uint8_t* after)
+{
+    uint8_t buf[BUFSIZE];
+
+    ece391_itoa (value, buf, 10);
+    ece391_fdputs (1, buf);
+    ece391_fdputs (1, after);
+}
+
+/*
+ * smpbench [n]: runs 1, 2, ... n copies of a cpu bound loop at the same time
+ * and prints the aggregate throughput of each run next to the number of cpus,
+ * with the speedup over a single copy. n defaults to twice the cpus.
+ */
+int main ()
+{
+    uint8_t args[BUFSIZE];
+    uint32_t cpus, steals, max = 0, n, tput, base = 0;
+    int32_t ms;
+    uint8_t* p;
+
+    if (0 == ece391_getargs (args, BUFSIZE)) {
+        if (0 == ece391_strcmp (args, (uint8_t*)"-w")) {
+            return worker ();
+        }
+        for (p = args; *p >= '0' && *p <= '9'; p++) {
+            max = max * 10 + (*p - '0');
+        }
+    }
+
+    cpus = ticks_value ((uint8_t*)"cpus");
+    if (0 == cpus) {
+        cpus = 1;
+    }
+    if (0 == max) {
+        max = 2 * cpus;
+    }
+    if (max > MAX_WORKERS) {
+        max = MAX_WORKERS;
+    }
+    put (cpus, (uint8_t*)" cpus\n");
+
+    steals = ticks_value ((uint8_t*)"steals");
+    for (n = 1; n <= max; n++) {
+        if (0 > (ms = run (n))) {
+            ece391_fdputs (1, (uint8_t*)"could not start the workers\n");
+            return 2;
+        }
+        if (0 == ms) {
+            ms = 1;
+        }
+        /* thousands of iterations per second */
+        tput = n * WORK_BLOCKS / ms * 1000 + n * WORK_BLOCKS % ms * 1000 / ms;
+        if (1 == n) {
+            base = (0 != tput) ? tput : 1;
+        }
+        put (n, (uint8_t*)" workers: ");
+        put (ms, (uint8_t*)" ms, ");
+        put (tput, (uint8_t*)"K iterations/s, speedup ");
+        put (tput / base, (uint8_t*)".");
+        put (tput * 10 / base % 10, (uint8_t*)"\n");
+    }
+    put (ticks_value ((uint8_t*)"steals") - steals, (uint8_t*)" tasks stolen between cpus\n");
+
+    return 0;
+}
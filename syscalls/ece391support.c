@@ -102,3 +102,37 @@ uint8_t* ece391_strrev(uint8_t* s)
    return s;
 }
 
+
+/*
+ * Converts the time stamp counter with the scale the kernel left in the
+ * time page, a rdtsc and one divide.
+ */
+int32_t ece391_clock_gettime(int32_t clock, ece391_timespec_t* ts)
+{
+    const ece391_time_page_t* page = (const ece391_time_page_t*)ECE391_TIME_PAGE;
+    uint32_t lo, hi, sec, rem;
+    uint64_t cycles;
+
+    if (0 == ts || 0 == page->cycles_per_sec)
+        return -1;
+    asm volatile ("rdtsc" : "=a"(lo), "=d"(hi));
+    cycles = ((uint64_t)hi << 32) | lo;
+    if (ECE391_CLOCK_REALTIME == clock)
+        cycles -= ((uint64_t)page->base_tsc_hi << 32) | page->base_tsc_lo;
+    else if (ECE391_CLOCK_MONOTONIC != clock)
+        return -1;
+
+    cycles >>= page->cycle_shift;
+    if ((uint32_t)(cycles >> 32) >= page->cycles_per_sec)
+        return -1;
+    asm ("divl %4"
+         : "=a"(sec), "=d"(rem)
+         : "a"((uint32_t)cycles), "d"((uint32_t)(cycles >> 32)), "rm"(page->cycles_per_sec)
+         : "cc");
+
+    ts->tv_sec = sec;
+    if (ECE391_CLOCK_REALTIME == clock)
+        ts->tv_sec += page->base_sec;
+    ts->tv_nsec = (uint32_t)(((uint64_t)rem * page->mult) >> page->shift);
+    return 0;
+}
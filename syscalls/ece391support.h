@@ -9,5 +9,28 @@ extern int32_t ece391_strncmp(const uint8_t* s1, const uint8_t* s2, uint32_t n);
 extern uint8_t *ece391_itoa(uint32_t value, uint8_t* buf, int32_t radix);
 extern uint8_t *ece391_strrev(uint8_t* s);
 
+/* Clocks read straight from the kernel's time page, no system call. */
+#define ECE391_CLOCK_REALTIME  0    /* seconds since 1970-01-01 UTC */
+#define ECE391_CLOCK_MONOTONIC 1    /* seconds since the machine started */
+#define ECE391_TIME_PAGE 0x08401000 /* right above the vidmap page */
+
+typedef struct ece391_timespec {
+    uint32_t tv_sec;
+    uint32_t tv_nsec;
+} ece391_timespec_t;
+
+/* Layout of the time page, the kernel's time_page_t. */
+typedef struct __attribute__((packed)) ece391_time_page {
+    uint32_t base_tsc_lo;
+    uint32_t base_tsc_hi;
+    uint32_t base_sec;
+    uint32_t cycle_shift;
+    uint32_t cycles_per_sec;
+    uint32_t mult;
+    uint32_t shift;
+} ece391_time_page_t;
+
+extern int32_t ece391_clock_gettime(int32_t clock, ece391_timespec_t* ts);
+
 #endif /* ECE391SUPPORT_H */
 
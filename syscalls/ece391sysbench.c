@@ -0,0 +1,46 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define BUFSIZE 32
+#define CALLS 100000
+
+static uint32_t rdtsc_low ()
+{
+    uint32_t lo, hi;
+    asm volatile ("rdtsc" : "=a"(lo), "=d"(hi));
+    return lo;
+}
+
+static void report (const uint8_t* name, uint32_t cycles)
+{
+    uint8_t buf[BUFSIZE];
+
+    ece391_fdputs (1, name);
+    ece391_itoa (cycles / CALLS, buf, 10);
+    ece391_fdputs (1, buf);
+    ece391_fdputs (1, (uint8_t*)" cycles per null call\n");
+}
+
+int main ()
+{
+    uint32_t i, start, int80, fast;
+
+    start = rdtsc_low ();
+    for (i = 0; i < CALLS; i++) {
+        ece391_null_int80 ();
+    }
+    int80 = rdtsc_low () - start;
+
+    start = rdtsc_low ();
+    for (i = 0; i < CALLS; i++) {
+        ece391_null ();
+    }
+    fast = rdtsc_low () - start;
+
+    report ((uint8_t*)"int $0x80: ", int80);
+    report ((uint8_t*)"sysenter:  ", fast);
+
+    return 0;
+}
@@ -22,6 +22,29 @@ extern int32_t ece391_vidmap (uint8_t** screen_start);
 extern int32_t ece391_set_handler (int32_t signum, void* handler);
 extern int32_t ece391_sigreturn (void);
 
+/* Open with flags, O_CREATE makes a missing file. */
+#define O_CREATE 0x1
+#define O_TRUNC  0x2
+#define O_APPEND 0x4
+extern int32_t ece391_open_flags (const uint8_t* filename, int32_t flags);
+
+/* fds[0] reads what is written to fds[1]. */
+extern int32_t ece391_pipe (int32_t* fds);
+
+/*
+ * Start a program that runs alongside the caller, with fd_in and fd_out of
+ * the caller as its stdin and stdout (-1 keeps the terminal). Returns its
+ * pid, nothing waits for it to halt.
+ */
+extern int32_t ece391_spawn (const uint8_t* command, int32_t fd_in, int32_t fd_out);
+
+/* Sleep for sec seconds and nsec nanoseconds, nsec below one second. */
+extern int32_t ece391_nanosleep (uint32_t sec, uint32_t nsec);
+
+/* Return -1 without doing anything, through sysenter and int $0x80. */
+extern int32_t ece391_null (void);
+extern int32_t ece391_null_int80 (void);
+
 enum signums {
 	DIV_ZERO = 0,
 	SEGFAULT,
@@ -11,5 +11,11 @@
 #define SYS_VIDMAP  8
 #define SYS_SET_HANDLER  9
 #define SYS_SIGRETURN  10
+#define SYS_OPEN_FLAGS 11
+#define SYS_PIPE 12
+#define SYS_SPAWN 13
+#define SYS_NANOSLEEP 14
+
+#define SYS_NULL    0       /* not a system call, the kernel returns -1 right away */
 
 #endif /* ECE391SYSNUM_H */
@@ -0,0 +1,136 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define BUFSIZE 32
+
+/* same layout as sysstat_t in student-distrib/sysstat.h */
+#define SYSSTAT_CALLS 14
+#define SYSSTAT_FILETYPES 6
+#define SYSSTAT_ROWS (SYSSTAT_CALLS + 2 * SYSSTAT_FILETYPES)
+#define SYSSTAT_BUCKETS 40
+#define SYSSTAT_PIDS 64
+
+typedef struct __attribute__((packed)) {
+    uint32_t calls;
+    uint64_t cycles;
+    uint32_t buckets[SYSSTAT_BUCKETS];
+} row_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t calls;
+    uint64_t cycles;
+} pid_row_t;
+
+typedef struct __attribute__((packed)) {
+    row_t rows[SYSSTAT_ROWS];
+    pid_row_t pids[SYSSTAT_PIDS];
+} sysstat_t;
+
+static sysstat_t stats;
+
+static const char* row_names[SYSSTAT_ROWS] = {
+    "halt", "execute", "read", "write", "open", "close", "getargs", "vidmap", "set_handler", "sigreturn",
+    "open_flags", "pipe", "spawn", "nanosleep",
+    " read rtc", " read dir", " read file", " read kfile", " read term", " read pipe",
+    " write rtc", " write dir", " write file", " write kfile", " write term", " write pipe"
+};
+
+/* print a number right aligned in width columns */
+static void put_num (uint32_t value, uint32_t width)
+{
+    uint8_t buf[BUFSIZE];
+    uint32_t len;
+
+    ece391_itoa (value, buf, 10);
+    for (len = ece391_strlen (buf); len < width; len++) {
+        ece391_fdputs (1, (uint8_t*)" ");
+    }
+    ece391_fdputs (1, buf);
+}
+
+/* print a string left aligned in width columns */
+static void put_str (const char* s, uint32_t width)
+{
+    uint32_t len;
+
+    ece391_fdputs (1, (uint8_t*)s);
+    for (len = ece391_strlen ((uint8_t*)s); len < width; len++) {
+        ece391_fdputs (1, (uint8_t*)" ");
+    }
+}
+
+/* 64 by 32 bit division without libgcc, accurate to the top 32 bits of total */
+static uint32_t average (uint64_t total, uint32_t calls)
+{
+    uint32_t shift = 0;
+
+    while ((total >> shift) > 0xFFFFFFFFULL) {
+        shift++;
+    }
+    return ((uint32_t)(total >> shift) / calls) << shift;
+}
+
+/* log2 bucket holding the call at fraction num/den of the distribution */
+static uint32_t percentile (const row_t* row, uint32_t num, uint32_t den)
+{
+    uint32_t i, seen = 0;
+    uint32_t want = row->calls / den * num;
+
+    for (i = 0; i < SYSSTAT_BUCKETS; i++) {
+        seen += row->buckets[i];
+        if (seen > want) {
+            break;
+        }
+    }
+    return i;
+}
+
+int main ()
+{
+    int32_t fd, cnt, got = 0;
+    uint32_t i;
+    uint8_t buf[BUFSIZE];
+
+    if (-1 == (fd = ece391_open ((uint8_t*)"sysstat"))) {
+        ece391_fdputs (1, (uint8_t*)"Can't open the sysstat file.\n");
+        return 2;
+    }
+    if (0 == ece391_getargs (buf, BUFSIZE) && 0 == ece391_strcmp (buf, (uint8_t*)"clear")) {
+        ece391_write (fd, "c", 1);
+        ece391_close (fd);
+        return 0;
+    }
+    while (got < sizeof (stats) && 0 < (cnt = ece391_read (fd, (uint8_t*)&stats + got, sizeof (stats) - got))) {
+        got += cnt;
+    }
+    ece391_close (fd);
+
+    ece391_fdputs (1, (uint8_t*)"call             calls  Mcycles  avg cycles  p50  p99 (log2 cycles)\n");
+    for (i = 0; i < SYSSTAT_ROWS; i++) {
+        if (stats.rows[i].calls == 0) {
+            continue;
+        }
+        put_str (row_names[i], 14);
+        put_num (stats.rows[i].calls, 8);
+        put_num ((uint32_t)(stats.rows[i].cycles >> 20), 9);
+        put_num (average (stats.rows[i].cycles, stats.rows[i].calls), 12);
+        put_num (percentile (&stats.rows[i], 1, 2), 5);
+        put_num (percentile (&stats.rows[i], 99, 100), 5);
+        ece391_fdputs (1, (uint8_t*)"\n");
+    }
+
+    ece391_fdputs (1, (uint8_t*)"\npid    calls  Mcycles\n");
+    for (i = 0; i < SYSSTAT_PIDS; i++) {
+        if (stats.pids[i].calls == 0) {
+            continue;
+        }
+        put_num (i, 3);
+        put_num (stats.pids[i].calls, 9);
+        put_num ((uint32_t)(stats.pids[i].cycles >> 20), 9);
+        ece391_fdputs (1, (uint8_t*)"\n");
+    }
+
+    return 0;
+}
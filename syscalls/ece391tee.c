@@ -0,0 +1,48 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define BUFSIZE 1024
+
+/*
+ * tee [-a] file: copies standard input to the screen and to file, which is
+ * created if needed and emptied first unless -a is given. An empty line
+ * typed at the terminal ends the input.
+ */
+int main ()
+{
+    int32_t fd, cnt, flags = O_CREATE | O_TRUNC;
+    uint8_t args[BUFSIZE];
+    uint8_t buf[BUFSIZE];
+    uint8_t* name = args;
+
+    if (0 != ece391_getargs (args, BUFSIZE)) {
+        ece391_fdputs (1, (uint8_t*)"usage: tee [-a] file\n");
+        return 3;
+    }
+    if (name[0] == '-' && name[1] == 'a' && name[2] == ' ') {
+        flags = O_CREATE | O_APPEND;
+        name += 3;
+    }
+
+    if (-1 == (fd = ece391_open_flags (name, flags))) {
+        ece391_fdputs (1, (uint8_t*)"could not open file\n");
+        return 2;
+    }
+
+    while (0 < (cnt = ece391_read (0, buf, BUFSIZE))) {
+        if (cnt == 1 && buf[0] == '\n') {
+            break;
+        }
+        if (cnt != ece391_write (fd, buf, cnt)) {
+            ece391_fdputs (1, (uint8_t*)"file system full\n");
+            ece391_close (fd);
+            return 1;
+        }
+        ece391_write (1, buf, cnt);
+    }
+
+    ece391_close (fd);
+    return 0;
+}
@@ -0,0 +1,37 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define BUFSIZE 32
+
+/* tracectl on|off|clear: controls the kernel event trace, read it with "cat trace" */
+int main ()
+{
+    int32_t fd;
+    uint8_t buf[BUFSIZE];
+    uint8_t cmd;
+
+    if (0 != ece391_getargs (buf, BUFSIZE)) {
+        ece391_fdputs (1, (uint8_t*)"usage: tracectl on|off|clear\n");
+        return 3;
+    }
+    if (0 == ece391_strcmp (buf, (uint8_t*)"on")) {
+        cmd = '1';
+    } else if (0 == ece391_strcmp (buf, (uint8_t*)"off")) {
+        cmd = '0';
+    } else if (0 == ece391_strcmp (buf, (uint8_t*)"clear")) {
+        cmd = 'c';
+    } else {
+        ece391_fdputs (1, (uint8_t*)"usage: tracectl on|off|clear\n");
+        return 3;
+    }
+
+    if (-1 == (fd = ece391_open ((uint8_t*)"trace")) || -1 == ece391_write (fd, &cmd, 1)) {
+        ece391_fdputs (1, (uint8_t*)"Can't control the trace.\n");
+        return 2;
+    }
+    ece391_close (fd);
+
+    return 0;
+}